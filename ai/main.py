@@ -5,7 +5,7 @@ Lightweight AI inference using only ONNX Runtime.
 No PyTorch dependency required.
 """
 
-import os, time, json, numpy as np, cv2, requests, logging, glob
+import os, time, json, numpy as np, cv2, requests, logging, glob, mmap, socket, struct, threading
 try:
     import onnxruntime as ort
 except: ort = None
@@ -17,6 +17,12 @@ DATA_DIR, MODELS_DIR = "/app/data", "/app/models"
 AI_REQUESTS_DIR, AI_RESULTS_DIR = f"{DATA_DIR}/ai_requests", f"{DATA_DIR}/ai_results"
 MIDAS_ONNX = f"{MODELS_DIR}/midas_small.onnx"
 MIDAS_URL = "https://github.com/isl-org/MiDaS/releases/download/v3_1/model-small.onnx"
+# Frames handed over in shared memory by the C++ service (cpp/include/ai_frame_channel.hpp)
+IPC_SOCKET = os.environ.get("AI_IPC_SOCKET", f"{DATA_DIR}/ai.sock")
+RING_MAGIC = 0x52465650
+RING_HEADER = struct.Struct("<IIIIQQ")    # magic, version, slot_count, reserved, slot_bytes, generation
+SLOT_SEQ = struct.Struct("<Q")
+SLOT_HEADER_BYTES = 64
 
 class AIModelManager:
     def __init__(self):
@@ -50,10 +56,67 @@ class AIModelManager:
             return (depth - mn) / (mx - mn) if mx > mn else np.zeros_like(depth)
         except: return None
 
+def analyze(mgr, req, img):
+    result = {"success": bool(img is not None), "request_id": req.get('request_id')}
+    if img is not None and req.get('depth_analysis_required'):
+        depth = mgr.run_depth_inference(img)
+        if depth is not None:
+            depth_cm = 10 + 90 * (1 - depth)
+            result['depth_analysis'] = {"success": True, "mean_depth_cm": float(depth_cm.mean())}
+    return result
+
+class FrameRing:
+    """Maps the C++ frame ring; remapped whenever the writer regrows it"""
+    def __init__(self): self.name, self.generation, self.mm = None, None, None
+
+    def view(self, req):
+        if (req['shm'], req['generation']) != (self.name, self.generation):
+            if self.mm is not None: self.mm.close()
+            with open(f"/dev/shm/{req['shm'].lstrip('/')}", "r+b") as f: self.mm = mmap.mmap(f.fileno(), 0)
+            magic, _, _, _, _, generation = RING_HEADER.unpack_from(self.mm, 0)
+            if magic != RING_MAGIC: raise ValueError("not a PlantVision frame ring")
+            self.name, self.generation = req['shm'], generation
+        h, w, c, stride = req['height'], req['width'], req['channels'], req['stride']
+        pixels = np.frombuffer(self.mm, dtype=np.uint8, count=h * stride, offset=req['offset'] + SLOT_HEADER_BYTES)
+        return pixels.reshape(h, stride)[:, :w * c].reshape(h, w, c)
+
+    def unchanged(self, req):
+        return SLOT_SEQ.unpack_from(self.mm, req['offset'])[0] == req['seq']
+
+def serve_connection(mgr, conn):
+    ring = FrameRing()
+    with conn, conn.makefile('rb') as reader:
+        for line in reader:
+            req, img = {}, None
+            try:
+                req = json.loads(line)
+                img = ring.view(req)
+                result = analyze(mgr, req, img)
+                # The writer reused the slot mid-analysis; the numbers no longer describe one frame
+                if not ring.unchanged(req): result = {"success": False, "request_id": req.get('request_id'), "error": "frame overwritten"}
+            except Exception as e:
+                result = {"success": False, "request_id": req.get('request_id'), "error": str(e)}
+            finally:
+                img = None    # the ring cannot be remapped while a view into it is alive
+            conn.sendall((json.dumps(result) + "\n").encode())
+
+def serve_ipc(mgr):
+    if os.path.exists(IPC_SOCKET): os.remove(IPC_SOCKET)
+    server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    server.bind(IPC_SOCKET)
+    os.chmod(IPC_SOCKET, 0o660)
+    server.listen(4)
+    logger.info(f"Shared-memory frame channel listening on {IPC_SOCKET}")
+    while True:
+        conn, _ = server.accept()
+        threading.Thread(target=serve_connection, args=(mgr, conn), daemon=True).start()
+
 def main():
     logger.info("AI Module Started (ONNX Only)")
     mgr = AIModelManager()
     mgr.load_depth_model()
+    threading.Thread(target=serve_ipc, args=(mgr,), daemon=True).start()
+    # Signal files remain for AI_TRANSPORT=file and whenever the C++ side is not connected
     while True:
         try:
             for sig in glob.glob(f"{DATA_DIR}/ai_analysis_*.signal"):
@@ -63,12 +126,7 @@ def main():
                     if os.path.exists(req_file):
                         with open(req_file) as f: req = json.load(f)
                         img = cv2.imread(req.get('image_path', ''))
-                        result = {"success": bool(img is not None), "request_id": req_id}
-                        if img is not None and req.get('depth_analysis_required'):
-                            depth = mgr.run_depth_inference(img)
-                            if depth is not None:
-                                depth_cm = 10 + 90 * (1 - depth)
-                                result['depth_analysis'] = {"success": True, "mean_depth_cm": float(depth_cm.mean())}
+                        result = analyze(mgr, dict(req, request_id=req_id), img)
                         with open(f"{AI_RESULTS_DIR}/{req_id}.json", 'w') as f: json.dump(result, f)
                     os.remove(sig)
                 except: pass
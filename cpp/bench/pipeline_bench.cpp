@@ -0,0 +1,448 @@
+// Replays the sample images and synthetic dense trays through the vision
+// pipeline and times each stage on its own, so a performance change can be
+// checked on the target hardware and a regression caught before it ships.
+//
+//   plantvision_bench [--iterations N] [--warmup N] [--threads N] [--pyramid N]
+//                     [--no-synthetic] [--output results.json]
+//                     [--baseline previous.json] [--tolerance 0.10] [image ...]
+//
+// Without images it looks for garden.jpg, plant.jpg and plant3.jpg under
+// ../samples and ../../samples (run it from the build directory). Results are
+// printed as a table on stderr and as JSON on stdout (or --output). With
+// --baseline the run exits with status 2 when any stage's p50 is more than
+// --tolerance slower than in the baseline file.
+
+#include <opencv2/opencv.hpp>
+#include <nlohmann/json.hpp>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "change_detector.hpp"
+#include "frame_context.hpp"
+#include "leaf_area.hpp"
+#include "morphology_analysis.hpp"
+#include "scratch_pool.hpp"
+#include "stage_metrics.hpp"
+#include "telemetry_encoding.hpp"
+#include "vision_processor.hpp"
+
+using json = nlohmann::json;
+using PlantVision::Morphology::MorphologyAnalyzer;
+
+namespace {
+
+struct BenchOptions {
+    int iterations = 10;
+    int warmup = 1;
+    int threads = 0;
+    int pyramid = 1;
+    bool synthetic = true;
+    int thresholdValue = 100;
+    double scalePxPerCm = 28.0;
+    std::string output;
+    std::string baseline;
+    double tolerance = 0.10;
+    std::vector<std::string> images;
+};
+
+struct BenchCase {
+    std::string name;
+    cv::Mat frame;
+};
+
+struct Timing {
+    std::vector<double> samples;
+
+    json toJson() const {
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        auto quantile = [&](double q) {
+            if (sorted.empty()) return 0.0;
+            const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5));
+            return sorted[index];
+        };
+        double sum = 0.0;
+        for (double value : sorted) sum += value;
+        const double mean = sorted.empty() ? 0.0 : sum / static_cast<double>(sorted.size());
+        return {
+            {"iterations", sorted.size()},
+            {"mean_ms", mean},
+            {"p50_ms", quantile(0.50)},
+            {"p95_ms", quantile(0.95)},
+            {"min_ms", sorted.empty() ? 0.0 : sorted.front()},
+            {"max_ms", sorted.empty() ? 0.0 : sorted.back()},
+            {"per_second", mean > 0.0 ? 1000.0 / mean : 0.0}
+        };
+    }
+};
+
+template <typename Fn>
+Timing timeStage(const BenchOptions &options, Fn &&fn) {
+    for (int i = 0; i < options.warmup; ++i) fn();
+    Timing timing;
+    timing.samples.reserve(static_cast<size_t>(options.iterations));
+    for (int i = 0; i < options.iterations; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        timing.samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return timing;
+}
+
+// Resident high-water mark of the whole process since it started, so it only ever grows across cases
+long processPeakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;     // kilobytes on Linux
+}
+
+// A "Vm...:" line of /proc/self/status in kilobytes, -1 when unavailable
+long procStatusKb(const std::string &key) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, key.size(), key) == 0 && line.size() > key.size() && line[key.size()] == ':') {
+            return std::atol(line.c_str() + key.size() + 1);
+        }
+    }
+    return -1;
+}
+
+// Lowers VmHWM to the current RSS so the next reading covers one case only (Linux 4.0+)
+bool resetPeakRss() {
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+    return static_cast<bool>(clearRefs);
+}
+
+std::vector<std::string> defaultSamples() {
+    std::vector<std::string> found;
+    for (const char *dir : {"../samples/", "../../samples/", "samples/"}) {
+        for (const char *name : {"garden.jpg", "plant.jpg", "plant3.jpg"}) {
+            std::string path = std::string(dir) + name;
+            if (!cv::imread(path, cv::IMREAD_REDUCED_COLOR_8).empty()) found.push_back(path);
+        }
+        if (!found.empty()) break;
+    }
+    return found;
+}
+
+// A seedling tray: soil-coloured cells, each holding a rosette of leaves.
+// Seeded, so every run and every machine sees the same pixels.
+cv::Mat syntheticTray(int width, int height, uint64_t seed) {
+    cv::RNG rng(seed);
+    cv::Mat tray(height, width, CV_8UC3, cv::Scalar(38, 52, 70));
+    const int cellSize = std::max(48, std::min(width, height) / 6);
+    for (int y = 0; y + cellSize <= height; y += cellSize) {
+        for (int x = 0; x + cellSize <= width; x += cellSize) {
+            const cv::Rect cell(x + 2, y + 2, cellSize - 4, cellSize - 4);
+            cv::rectangle(tray, cell, cv::Scalar(30 + rng.uniform(0, 10), 45 + rng.uniform(0, 10), 62 + rng.uniform(0, 12)), cv::FILLED);
+            if (rng.uniform(0.0, 1.0) < 0.1) continue;     // the odd empty cell
+
+            const cv::Point centre(cell.x + cell.width / 2 + rng.uniform(-cellSize / 10, cellSize / 10 + 1),
+                                   cell.y + cell.height / 2 + rng.uniform(-cellSize / 10, cellSize / 10 + 1));
+            const int leaves = rng.uniform(2, 8);
+            const double reach = cellSize * rng.uniform(0.15, 0.42);
+            const double phase = rng.uniform(0.0, CV_PI);
+            for (int leaf = 0; leaf < leaves; ++leaf) {
+                const double angle = phase + leaf * 2.0 * CV_PI / leaves;
+                const cv::Point tip(centre.x + static_cast<int>(std::cos(angle) * reach * 0.55),
+                                    centre.y + static_cast<int>(std::sin(angle) * reach * 0.55));
+                const cv::Scalar green(rng.uniform(20, 60), rng.uniform(110, 200), rng.uniform(30, 90));
+                cv::ellipse(tray, tip, cv::Size(static_cast<int>(reach * 0.5), std::max(2, static_cast<int>(reach * 0.2))),
+                            angle * 180.0 / CV_PI, 0, 360, green, cv::FILLED, cv::LINE_AA);
+            }
+            // A few lesions for the spot and yellowing detectors
+            if (rng.uniform(0.0, 1.0) < 0.3) {
+                cv::circle(tray, centre, std::max(2, cellSize / 40), cv::Scalar(30, 70, 110), cv::FILLED);
+            }
+            if (rng.uniform(0.0, 1.0) < 0.2) {
+                cv::circle(tray, cv::Point(centre.x + static_cast<int>(reach * 0.3), centre.y),
+                           std::max(2, cellSize / 30), cv::Scalar(40, 200, 210), cv::FILLED);
+            }
+        }
+    }
+    cv::Mat noise(tray.size(), tray.type());
+    rng.fill(noise, cv::RNG::NORMAL, cv::Scalar::all(0), cv::Scalar::all(4));
+    tray += noise;
+    return tray;
+}
+
+// Field for field what CameraChannel::publish sends per instance, minus the crop
+json instanceJson(const PlantInstance &instance, size_t index) {
+    const auto &bb = instance.boundingBox;
+    return {
+        {"id", instance.trackId >= 0 ? instance.trackId : static_cast<int>(index)},
+        {"type", instance.type == PlantType::SPROUT ? "sprout" : "plant"},
+        {"classification", instance.classification},
+        {"bbox", {bb.x, bb.y, bb.width, bb.height}},
+        {"area_pixels", instance.areaPixels},
+        {"area_cm2", instance.areaCm2},
+        {"height_cm", instance.heightCm},
+        {"width_cm", instance.widthCm},
+        {"label", "unknown"},
+        {"mean_bgr", {instance.meanColor[0], instance.meanColor[1], instance.meanColor[2]}},
+        {"leaf_count", instance.leafCount},
+        {"petal_count", instance.petalCount},
+        {"bud_count", instance.budCount},
+        {"fruit_count", instance.fruitCount},
+        {"health_score", instance.healthScore},
+        {"growth_stage", static_cast<int>(instance.stage)},
+        {"analysis_reused", instance.analysisReused},
+        {"image_format", "jpg"},
+        {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch()).count()}
+    };
+}
+
+json framePayload(const PlantAnalysisResult &result) {
+    json instances = json::array();
+    for (size_t i = 0; i < result.instances.size(); ++i) {
+        instances.push_back(instanceJson(result.instances[i], i));
+    }
+    return {
+        {"total_instances", result.totalInstanceCount},
+        {"sprout_count", result.sproutCount},
+        {"plant_count", result.plantCount},
+        {"total_area_pixels", result.totalAreaPixels},
+        {"total_area_cm2", result.totalAreaCm2},
+        {"average_health", result.averageHealth},
+        {"instances", std::move(instances)}
+    };
+}
+
+json runCase(const BenchCase &benchCase, const BenchOptions &options) {
+    AnalysisOptions analysisOptions;
+    analysisOptions.workerThreads = options.threads;
+    analysisOptions.pyramidFactor = options.pyramid;
+
+    json stages = json::object();
+    const bool perCaseRss = resetPeakRss();
+    const long rssAtStartKb = procStatusKb("VmRSS");
+
+    PlantAnalysisResult result;
+    stages["analyze_plants"] = timeStage(options, [&]() {
+        FrameContext context(benchCase.frame);
+        result = analyzePlants(context, options.thresholdValue, options.scalePxPerCm, analysisOptions);
+    }).toJson();
+
+    // Scratch buffers a further warmed-up frame still had to allocate; 0 once the pools have settled
+    const uint64_t allocationsBefore = ScratchPool::allocations();
+    {
+        FrameContext context(benchCase.frame);
+        result = analyzePlants(context, options.thresholdValue, options.scalePxPerCm, analysisOptions);
+    }
+    const uint64_t steadyAllocations = ScratchPool::allocations() - allocationsBefore;
+
+    VisionProcessor processor;
+    processor.setAnalysisScale(options.pyramid);
+    stages["basic_metrics"] = timeStage(options, [&]() {
+        FrameContext context(benchCase.frame);
+        processor.processBasicMetrics(context);
+    }).toJson();
+
+    // Masks are cut once so only the analyzer itself is timed
+    std::vector<std::pair<cv::Mat, cv::Mat>> regions;
+    const cv::Rect bounds(0, 0, benchCase.frame.cols, benchCase.frame.rows);
+    for (const auto &instance : result.instances) {
+        const cv::Rect roi = instance.boundingBox & bounds;
+        if (roi.area() <= 0 || instance.contour.empty()) continue;
+        cv::Mat mask = cv::Mat::zeros(roi.size(), CV_8UC1);
+        std::vector<std::vector<cv::Point>> contours{instance.contour};
+        cv::drawContours(mask, contours, 0, cv::Scalar(255), cv::FILLED, cv::LINE_8, cv::noArray(), INT_MAX, -roi.tl());
+        regions.emplace_back(mask, benchCase.frame(roi));
+    }
+    MorphologyAnalyzer analyzer;
+    stages["morphology"] = timeStage(options, [&]() {
+        for (const auto &[mask, image] : regions) analyzer.analyzeMorphology(mask, image);
+    }).toJson();
+
+    ChangeDetector detector;
+    detector.updateBaseline(result.metrics);
+    stages["change_detector"] = timeStage(options, [&]() {
+        detector.analyzeFrame(result.metrics);
+    }).toJson();
+
+    json payload;
+    stages["json_build"] = timeStage(options, [&]() { payload = framePayload(result); }).toJson();
+
+    // Payload serialization only; PUBLISH framing and the socket write are not part of these stages
+    json encodedSizes = json::object();
+    std::string wire;
+    for (TelemetryFormat format : {TelemetryFormat::JSON, TelemetryFormat::CBOR, TelemetryFormat::MSGPACK}) {
+        const std::string name = std::string("serialize_") + telemetryFormatName(format);
+        stages[name] = timeStage(options, [&]() { encodeTelemetry(payload, format, wire); }).toJson();
+        encodedSizes[telemetryFormatName(format)] = wire.size();
+    }
+
+    json report = {
+        {"case", benchCase.name},
+        {"width", benchCase.frame.cols},
+        {"height", benchCase.frame.rows},
+        {"instances", result.instances.size()},
+        {"payload_bytes", std::move(encodedSizes)},
+        {"stages", std::move(stages)},
+        {"scratch_allocations_per_frame", steadyAllocations}
+    };
+    const long casePeakKb = perCaseRss ? procStatusKb("VmHWM") : -1;
+    if (casePeakKb >= 0 && rssAtStartKb >= 0) {
+        // Highest RSS while this case ran, and how far it rose above the RSS the case started at
+        report["peak_rss_kb"] = casePeakKb;
+        report["rss_growth_kb"] = std::max(0L, casePeakKb - rssAtStartKb);
+    } else {
+        // No per-case reset here; the process-wide mark includes every earlier case
+        report["process_peak_rss_kb"] = processPeakRssKb();
+    }
+    return report;
+}
+
+// Stages whose p50 grew by more than the tolerance against a previous run
+std::vector<std::string> findRegressions(const json &current, const json &baseline, double tolerance) {
+    std::map<std::string, const json *> previousCases;
+    for (const auto &entry : baseline.value("cases", json::array())) {
+        previousCases[entry.value("case", std::string())] = &entry;
+    }
+    std::vector<std::string> regressions;
+    for (const auto &entry : current["cases"]) {
+        auto it = previousCases.find(entry["case"].get<std::string>());
+        if (it == previousCases.end() || !it->second->contains("stages")) continue;
+        const json &previousStages = (*it->second)["stages"];
+        for (const auto &[stage, timing] : entry["stages"].items()) {
+            if (!previousStages.contains(stage)) continue;
+            const double before = previousStages[stage].value("p50_ms", 0.0);
+            const double now = timing.value("p50_ms", 0.0);
+            if (before > 0.0 && now > before * (1.0 + tolerance)) {
+                std::ostringstream line;
+                line << entry["case"].get<std::string>() << "/" << stage << ": p50 "
+                     << before << " ms -> " << now << " ms";
+                regressions.push_back(line.str());
+            }
+        }
+    }
+    return regressions;
+}
+
+bool parseArgs(int argc, char **argv, BenchOptions &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&]() -> const char * { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char *value = nullptr;
+        if (arg == "--iterations" && (value = next())) options.iterations = std::max(1, std::atoi(value));
+        else if (arg == "--warmup" && (value = next())) options.warmup = std::max(0, std::atoi(value));
+        else if (arg == "--threads" && (value = next())) options.threads = std::max(0, std::atoi(value));
+        else if (arg == "--pyramid" && (value = next())) options.pyramid = std::max(1, std::atoi(value));
+        else if (arg == "--threshold" && (value = next())) options.thresholdValue = std::atoi(value);
+        else if (arg == "--scale" && (value = next())) options.scalePxPerCm = std::atof(value);
+        else if (arg == "--output" && (value = next())) options.output = value;
+        else if (arg == "--baseline" && (value = next())) options.baseline = value;
+        else if (arg == "--tolerance" && (value = next())) options.tolerance = std::atof(value);
+        else if (arg == "--no-synthetic") options.synthetic = false;
+        else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown or incomplete option " << arg << std::endl;
+            return false;
+        } else {
+            options.images.push_back(arg);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    if (!parseArgs(argc, argv, options)) return 1;
+    if (options.images.empty()) options.images = defaultSamples();
+
+    std::vector<BenchCase> cases;
+    for (const auto &path : options.images) {
+        cv::Mat frame = cv::imread(path);
+        if (frame.empty()) {
+            std::cerr << "Cannot read " << path << std::endl;
+            continue;
+        }
+        cases.push_back({path.substr(path.find_last_of('/') + 1), frame});
+    }
+    if (options.synthetic) {
+        cases.push_back({"tray_720p", syntheticTray(1280, 720, 720)});
+        cases.push_back({"tray_1080p", syntheticTray(1920, 1080, 1080)});
+        cases.push_back({"tray_4k", syntheticTray(3840, 2160, 2160)});
+    }
+    if (cases.empty()) {
+        std::cerr << "Nothing to run: no readable images and --no-synthetic" << std::endl;
+        return 1;
+    }
+
+    json report = {
+        {"benchmark", "plantvision_bench"},
+        {"opencv", CV_VERSION},
+        {"opencv_threads", cv::getNumThreads()},
+        {"iterations", options.iterations},
+        {"warmup", options.warmup},
+        {"analysis_threads", options.threads},
+        {"pyramid_factor", options.pyramid},
+        {"cases", json::array()}
+    };
+
+    std::cerr << std::left << std::setw(16) << "case" << std::setw(18) << "stage"
+              << std::right << std::setw(10) << "p50_ms" << std::setw(10) << "p95_ms"
+              << std::setw(12) << "per_second" << std::endl;
+    for (const auto &benchCase : cases) {
+        json result = runCase(benchCase, options);
+        for (const auto &[stage, timing] : result["stages"].items()) {
+            std::cerr << std::left << std::setw(16) << benchCase.name << std::setw(18) << stage << std::right
+                      << std::fixed << std::setprecision(3)
+                      << std::setw(10) << timing["p50_ms"].get<double>()
+                      << std::setw(10) << timing["p95_ms"].get<double>()
+                      << std::setprecision(1) << std::setw(12) << timing["per_second"].get<double>() << std::endl;
+        }
+        report["cases"].push_back(std::move(result));
+    }
+
+    // The helpers' own stage timers, accumulated over every case
+    json innerStages = json::object();
+    for (const auto &[name, snap] : snapshotStages()) {
+        const StageSummary summary = summarizeHistogram(name, snap);
+        innerStages[name] = {{"count", summary.count}, {"mean_ms", summary.mean_ms},
+                             {"p50_ms", summary.p50_ms}, {"p95_ms", summary.p95_ms},
+                             {"p99_ms", summary.p99_ms}, {"max_ms", summary.max_ms}};
+    }
+    report["inner_stages"] = std::move(innerStages);
+    // Cumulative over every case and the sample loading
+    report["process_peak_rss_kb"] = processPeakRssKb();
+
+    int status = 0;
+    if (!options.baseline.empty()) {
+        std::ifstream in(options.baseline);
+        json baseline = json::parse(in, nullptr, false);
+        if (baseline.is_discarded()) {
+            std::cerr << "Cannot parse baseline " << options.baseline << std::endl;
+            return 1;
+        }
+        const std::vector<std::string> regressions = findRegressions(report, baseline, options.tolerance);
+        report["regressions"] = regressions;
+        for (const auto &line : regressions) std::cerr << "REGRESSION " << line << std::endl;
+        if (!regressions.empty()) status = 2;
+    }
+
+    const std::string text = report.dump(2);
+    if (options.output.empty()) {
+        std::cout << text << std::endl;
+    } else {
+        std::ofstream out(options.output);
+        out << text << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,75 @@
+// Compares the skeleton engines on the green masks of the sample images and
+// times the graph extraction pass on the thinned result.
+//
+//   skeleton_bench [iterations] [image ...]
+//
+// Without images it looks for garden.jpg, plant.jpg and plant3.jpg under
+// ../samples and ../../samples (run it from the build directory).
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "frame_context.hpp"
+#include "skeleton.hpp"
+
+using namespace PlantVision::Morphology;
+
+static std::vector<std::string> defaultSamples() {
+    std::vector<std::string> found;
+    for (const char* dir : {"../samples/", "../../samples/", "samples/"}) {
+        for (const char* name : {"garden.jpg", "plant.jpg", "plant3.jpg"}) {
+            std::string path = std::string(dir) + name;
+            if (!cv::imread(path, cv::IMREAD_REDUCED_COLOR_8).empty()) found.push_back(path);
+        }
+        if (!found.empty()) break;
+    }
+    return found;
+}
+
+template <typename Fn>
+static double timeMs(int iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 5;
+    std::vector<std::string> images(argv + std::min(argc, 2), argv + argc);
+    if (images.empty()) images = defaultSamples();
+    if (images.empty()) {
+        std::cerr << "No sample images found; pass paths explicitly" << std::endl;
+        return 1;
+    }
+
+    std::cout << "image, size, mask_px, morphological_ms, zhang_suen_ms, speedup, morph_px, zs_px, graph_ms, tips, branches" << std::endl;
+    for (const auto& path : images) {
+        cv::Mat frame = cv::imread(path);
+        if (frame.empty()) {
+            std::cerr << "Cannot read " << path << std::endl;
+            continue;
+        }
+
+        FrameContext context(frame);
+        const cv::Mat& mask = context.greenMask();
+
+        cv::Mat morph, thin;
+        double morphMs = timeMs(iterations, [&]() { morph = morphologicalSkeleton(mask); });
+        double thinMs = timeMs(iterations, [&]() { thinZhangSuen(mask, thin); });
+        SkeletonGraph graph;
+        double graphMs = timeMs(iterations, [&]() { graph = extractSkeletonGraph(thin, 6); });
+
+        std::cout << path << ", " << frame.cols << "x" << frame.rows << ", "
+                  << cv::countNonZero(mask) << ", "
+                  << morphMs << ", " << thinMs << ", "
+                  << (thinMs > 0.0 ? morphMs / thinMs : 0.0) << ", "
+                  << cv::countNonZero(morph) << ", " << cv::countNonZero(thin) << ", "
+                  << graphMs << ", " << graph.tipPoints.size() << ", " << graph.branchPoints.size() << std::endl;
+    }
+    return 0;
+}
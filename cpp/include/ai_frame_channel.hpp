@@ -0,0 +1,90 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct AIChannelOptions {
+    // Unix-domain socket ai/main.py listens on
+    std::string socketPath = "/app/data/ai.sock";
+    // POSIX shared-memory object holding the frame ring (lives under /dev/shm)
+    std::string shmName = "/plantvision_frames";
+    int slots = 4;
+    // How long an answer is awaited before the request is given up
+    int timeoutMs = 1000;
+};
+
+/**
+ * @brief Frame handoff to the Python AI service through shared memory
+ *
+ * Frames are copied as raw BGR into a ring of slots in a POSIX shared-memory
+ * object, and a one-line JSON request naming the slot goes over a Unix-domain
+ * socket. The service maps the slot without decoding anything and answers on
+ * the same socket, so neither side touches the disk or polls for files.
+ *
+ * Layout (little-endian, all offsets from the start of the object):
+ *   0   ring header, 64 bytes: magic 'PVFR', version, slot_count, reserved,
+ *       slot_bytes (u64), generation (u64)
+ *   64  slot i at 64 + i * (64 + slot_bytes): a 64-byte slot header
+ *       (seq, frame_id, width, height, channels, stride, roi x/y/w/h,
+ *       timestamp_ms) followed by slot_bytes of pixels
+ * seq is odd while a slot is being written. A reader compares the seq from
+ * the request with the slot's after using the pixels, to detect a slot that
+ * was overwritten in the meantime. The object is regrown, and generation
+ * bumped, when a frame larger than slot_bytes arrives.
+ */
+class AIFrameChannel {
+public:
+    explicit AIFrameChannel(AIChannelOptions options);
+    ~AIFrameChannel();
+
+    AIFrameChannel(const AIFrameChannel&) = delete;
+    AIFrameChannel& operator=(const AIFrameChannel&) = delete;
+
+    // Connects when the service is listening; retried at most every few seconds
+    bool ready();
+
+    /**
+     * @brief Copy frame into the next slot and send request (extended with the slot fields)
+     * @return false when the service is unreachable, so the caller can use the file handoff
+     */
+    bool submit(const cv::Mat& frame, const std::string& request_id, nlohmann::json request);
+
+    // The service's answer to request_id if it has arrived, otherwise null; never blocks
+    nlohmann::json takeResult(const std::string& request_id);
+
+    int timeoutMs() const { return options_.timeoutMs; }
+
+private:
+    bool connectLocked();
+    void disconnectLocked();
+    bool ensureRingLocked(size_t frame_bytes);
+    void readLoop();
+
+    AIChannelOptions options_;
+
+    std::mutex mutex_;                  // socket and ring
+    int socket_fd_ = -1;
+    std::chrono::steady_clock::time_point next_connect_{};
+    int shm_fd_ = -1;
+    uint8_t* ring_ = nullptr;
+    size_t ring_bytes_ = 0;
+    uint64_t slot_bytes_ = 0;
+    uint64_t generation_ = 0;
+    uint32_t next_slot_ = 0;
+    uint64_t frame_id_ = 0;
+
+    std::mutex results_mutex_;
+    std::map<std::string, nlohmann::json> results_;
+    std::deque<std::string> result_order_;  // oldest first, results nobody waited for are dropped
+
+    std::atomic<bool> running_{true};
+    std::thread reader_;
+};
@@ -5,14 +5,76 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <map>
 
 #ifdef HAVE_ONNXRUNTIME
 #include <onnxruntime_cxx_api.h>
 #endif
 
+// Session-level tuning shared by every model an AIInferenceEngine loads
+struct InferenceOptions {
+    // Threads used inside a single operator (0 = ONNX Runtime default, one per core)
+    int intraOpThreads = 1;
+    // Threads running independent graph nodes concurrently (0 = default)
+    int interOpThreads = 1;
+    // Graph rewrites applied at load time: "disabled", "basic", "extended" or "all"
+    std::string graphOptimization = "all";
+    // Accelerators tried in order before the CPU provider: "cuda", "tensorrt", "openvino".
+    // A provider missing from the ONNX Runtime build is skipped with a warning.
+    std::vector<std::string> executionProviders;
+    int deviceId = 0;
+    // Zero-input Run() calls at load time so the first real request skips lazy kernel setup
+    int warmupRuns = 1;
+    // Map model files instead of reading them into a heap buffer before session creation
+    bool memoryMapModels = true;
+    // AIModelManager cache consulted for models loaded without an explicit path
+    std::string modelsDir = "/app/models";
+};
+
+/**
+ * Model Manager - handles downloading and caching of ONNX models
+ */
+class AIModelManager {
+public:
+    struct ModelInfo {
+        std::string name;
+        std::string url;
+        std::string localPath;
+        size_t expectedSize;
+        std::string checksum;
+    };
+
+    AIModelManager(const std::string& modelsDir = "/app/models");
+
+    // Download and verify models
+    bool downloadModel(const ModelInfo& modelInfo);
+    bool verifyModel(const ModelInfo& modelInfo);
+    std::string getModelPath(const std::string& modelName);
+    
+    // Progress callback for downloads
+    using ProgressCallback = std::function<void(const std::string&, int, const std::string&)>;
+    void setProgressCallback(ProgressCallback callback);
+
+    // Pre-configured model definitions
+    static ModelInfo getMiDaSSmallModel();
+    static ModelInfo getPlantDetectionModel();
+
+private:
+    std::string modelsDir_;
+    ProgressCallback progressCallback_;
+    
+    bool downloadFile(const std::string& url, const std::string& filepath);
+    std::string calculateChecksum(const std::string& filepath);
+};
+
 /**
  * AI Inference Engine for PlantVision
  * Provides C++ ONNX runtime integration for plant analysis models
+ *
+ * Keeps one session per ModelType resident, so depth estimation, plant
+ * detection and disease classification can all be loaded at once. Every
+ * session in the process shares a single Ort::Env and its global intra/inter
+ * op thread pools, created by the first engine from its InferenceOptions.
  */
 class AIInferenceEngine {
 public:
@@ -31,6 +93,27 @@ public:
         bool preprocessNormalization = true;
         float meanValue = 127.5f;
         float scaleValue = 1.0f / 127.5f;
+        // Detection models (YOLOv5-style [1, N, 5 + classes] output)
+        float scoreThreshold = 0.25f;
+        float nmsThreshold = 0.45f;
+        std::vector<int> classFilter;   // Empty = keep every class
+        // Classification models ([N, classes] output)
+        std::vector<std::string> classLabels;
+        bool applySoftmax = true;
+        // Images per Run() when the model's batch dimension is dynamic
+        int maxBatchSize = 16;
+    };
+
+    struct Detection {
+        cv::Rect box;
+        float score = 0.0f;
+        int classId = -1;
+    };
+
+    struct Classification {
+        int classId = -1;
+        float score = 0.0f;
+        std::string label;
     };
 
     struct DepthResult {
@@ -40,17 +123,27 @@ public:
         bool success = false;
     };
 
-    AIInferenceEngine();
+    explicit AIInferenceEngine(const InferenceOptions& options = InferenceOptions());
     ~AIInferenceEngine();
 
-    // Model management
+    // Model management; an empty config.modelPath resolves to the model manager's cache path
     bool loadModel(ModelType type, const ModelConfig& config);
+    static std::string defaultModelName(ModelType type);
     bool isModelLoaded(ModelType type) const;
     void unloadModel(ModelType type);
 
-    // Inference methods
+    /**
+     * Inference methods
+     *
+     * Input and static-shape output tensors are allocated once at load time
+     * and bound through Ort::IoBinding. Each image or ROI is resized, swapped
+     * to RGB, normalised and written planar straight into the input tensor.
+     */
     DepthResult runDepthInference(const cv::Mat& image);
+    std::vector<Detection> runDetection(const cv::Mat& image);
     std::vector<cv::Rect> runPlantDetection(const cv::Mat& image);
+    // One result per ROI; ROIs are packed into as few Run() calls as the batch size allows
+    std::vector<Classification> runClassification(const cv::Mat& image, const std::vector<cv::Rect>& rois);
     
     // Utility methods
     bool isOnnxRuntimeAvailable() const;
@@ -62,49 +155,12 @@ public:
 
 private:
     struct ModelInstance;
-    std::unique_ptr<ModelInstance> impl_;
+    std::map<ModelType, std::unique_ptr<ModelInstance>> models_;
+    InferenceOptions options_;
+    AIModelManager modelManager_;
+
+    ModelInstance* findModel(ModelType type) const;
     
     std::string lastError_;
     std::function<void(const std::string&, const std::string&)> pythonCallback_;
-    
-    // Helper methods
-    cv::Mat preprocessImage(const cv::Mat& input, const ModelConfig& config);
-    std::vector<float> matToVector(const cv::Mat& mat);
-    cv::Mat vectorToMat(const std::vector<float>& vec, int height, int width);
-};
-
-/**
- * Model Manager - handles downloading and caching of ONNX models
- */
-class AIModelManager {
-public:
-    struct ModelInfo {
-        std::string name;
-        std::string url;
-        std::string localPath;
-        size_t expectedSize;
-        std::string checksum;
-    };
-
-    AIModelManager(const std::string& modelsDir = "/app/models");
-
-    // Download and verify models
-    bool downloadModel(const ModelInfo& modelInfo);
-    bool verifyModel(const ModelInfo& modelInfo);
-    std::string getModelPath(const std::string& modelName);
-    
-    // Progress callback for downloads
-    using ProgressCallback = std::function<void(const std::string&, int, const std::string&)>;
-    void setProgressCallback(ProgressCallback callback);
-
-    // Pre-configured model definitions
-    static ModelInfo getMiDaSSmallModel();
-    static ModelInfo getPlantDetectionModel();
-
-private:
-    std::string modelsDir_;
-    ProgressCallback progressCallback_;
-    
-    bool downloadFile(const std::string& url, const std::string& filepath);
-    std::string calculateChecksum(const std::string& filepath);
 };
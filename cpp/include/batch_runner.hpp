@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "leaf_area.hpp"
+
+// Tuning knobs for runBatch
+struct BatchOptions {
+    // A directory (searched recursively) or a glob such as /archive/2024-*/cam0/*.jpg
+    std::string input;
+    // JSON Lines file, one record per image; appended to when resuming
+    std::string output = "/app/data/batch_results.jsonl";
+    // Frames analysed at once, each decoded and analysed on its own thread (0 = one per core)
+    int threads = 0;
+    // Decode at 1/2, 1/4 or 1/8 size via IMREAD_REDUCED_*; scale_px_per_cm is divided to match
+    int decodeScale = 1;
+    // Skip images that already have a record in output
+    bool resume = true;
+    int thresholdValue = 100;
+    double scalePxPerCm = 0.0;
+    AnalysisOptions analysis;
+    // Write a progress line after this many frames (0 = never)
+    size_t progressEvery = 500;
+};
+
+struct BatchSummary {
+    size_t discovered = 0;
+    size_t skipped = 0;     // already in the output
+    size_t processed = 0;
+    size_t failed = 0;      // unreadable images, recorded with an "error" field
+    double elapsedMs = 0.0;
+};
+
+// Image files under a directory or matching a glob, sorted by path
+std::vector<std::string> listBatchInputs(const std::string& input);
+
+/**
+ * @brief Analyse every image in options.input and stream one JSON line per image
+ *
+ * Workers pull the next path from a shared index, decode it and run
+ * analyzePlants serially, so the cores are spread over frames instead of over
+ * the handful of instances inside one frame. Each record is written as one
+ * line and flushed; a torn last line from an interrupted run is cut off on
+ * resume, and images already recorded are skipped. onRecord (optional) sees
+ * every serialized record, e.g. to publish it, and may block to apply
+ * backpressure.
+ */
+BatchSummary runBatch(const BatchOptions& options,
+                      const std::function<void(const std::string& record)>& onRecord = nullptr);
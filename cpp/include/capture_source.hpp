@@ -0,0 +1,58 @@
+#pragma once
+
+#include <opencv2/videoio.hpp>
+#include <string>
+
+/**
+ * @brief How a camera or stream is opened
+ *
+ * The defaults reproduce a plain cv::VideoCapture open. Setting hw_decoder
+ * (or backend = "gstreamer") builds a GStreamer pipeline that decodes on the
+ * SoC/GPU and hands OpenCV BGR frames through an appsink that keeps only the
+ * newest one, which takes H.264/H.265 decode off the CPU cores the analysis
+ * runs on.
+ */
+struct CaptureOptions {
+    // auto, ffmpeg, gstreamer or v4l2
+    std::string backend = "auto";
+    // none, auto, v4l2m2m (Raspberry Pi), nvdec (Jetson) or vaapi (Intel/AMD); GStreamer only
+    std::string hw_decoder = "none";
+    // CAP_PROP_HW_ACCELERATION for the FFmpeg backend: none, any, vaapi, d3d11 or mfx
+    std::string hw_acceleration = "none";
+    // Stream codec for the GStreamer depayloader/decoder: h264 or h265
+    std::string codec = "h264";
+    // Requested pixel format of a local camera, e.g. MJPG or YUYV (empty = driver default)
+    std::string fourcc;
+    int width = 0;          // 0 = driver default
+    int height = 0;
+    int fps = 0;
+    // RTSP jitter buffer in ms for the GStreamer source (0 = hand frames over as they arrive)
+    int latency_ms = 0;
+    // Complete GStreamer pipeline ending in appsink; overrides everything above
+    std::string pipeline;
+};
+
+// Resolves hw_decoder = "auto" from the devices present (Jetson, V4L2 M2M, DRI render node)
+std::string detectHardwareDecoder();
+
+/**
+ * @brief GStreamer pipeline for a device index (url empty) or a stream URL
+ * @return empty when the options do not call for GStreamer
+ */
+std::string buildCapturePipeline(int device_id, const std::string& url, const CaptureOptions& options);
+
+/**
+ * @brief Process-wide FFmpeg capture options for low-latency network streams
+ *
+ * Call once from main before any FrameGrabber starts: it sets an environment
+ * variable, and setenv races with the getenv of capture threads.
+ */
+void configureCaptureEnvironment();
+
+/**
+ * @brief Open device_id, or url when it is not empty, as the options describe
+ *
+ * Falls back to a default open when the hardware path is unavailable, so a
+ * misconfigured decoder costs CPU rather than the camera.
+ */
+bool openCapture(cv::VideoCapture& capture, int device_id, const std::string& url, const CaptureOptions& options);
@@ -7,11 +7,41 @@
 
 // Forward declaration
 struct PlantInstance;
+struct PlantMetricsTable;
 
 #include <opencv2/core.hpp>
 #include <vector>
 #include <string>
 #include <chrono>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+
+enum class ChangeDetectionMode {
+    BASELINE,   // Compare frame averages against the baseline frozen by updateBaseline
+    DRIFT       // Running averages for the frame and for every tracked plant
+};
+
+struct ChangeDetectorOptions {
+    ChangeDetectionMode mode = ChangeDetectionMode::BASELINE;
+    // Weight of the newest frame in the running averages (DRIFT)
+    double emaAlpha = 0.1;
+    // Hellinger distance between a plant's colour histogram and its running histogram, 0..1
+    double histogramThreshold = 0.2;
+    // Relative area change of a plant against its running area
+    double areaThreshold = 0.15;
+    // Plant state is forgotten after this many frames without its track id
+    int maxMissedFrames = 30;
+};
+
+// One row of PlantMetricsTable as seen by the DRIFT mode
+struct InstanceChange {
+    size_t row = 0;
+    int trackId = -1;
+    double colorDistance = 0.0;
+    double areaChange = 0.0;
+    bool isNew = false;         // first sighting: changed by definition
+    bool changed = false;
+};
 
 struct ChangeDetectionMetrics {
     double totalAreaChange = 0.0;
@@ -21,7 +51,10 @@ struct ChangeDetectionMetrics {
     double avgColorChangeV = 0.0;
     double morphologyChange = 0.0;  // Based on shape descriptor changes
     bool significantChange = false;
-    std::chrono::steady_clock::time_point timestamp;
+    std::chrono::system_clock::time_point timestamp;   // wall clock, like the rest of the payload
+    // DRIFT only; rows without a track id are not followed and not listed
+    std::vector<InstanceChange> instanceChanges;
+    int changedInstanceCount = 0;
 };
 
 class ChangeDetector {
@@ -36,8 +69,18 @@ private:
         bool isValid = false;
     };
     
+    // Running state of one tracked plant
+    struct PlantState {
+        double area = 0.0;
+        std::vector<float> histogram;
+        uint64_t lastSeen = 0;
+    };
+
+    ChangeDetectorOptions options_;
     BaselineData baseline_;
     std::chrono::steady_clock::time_point lastUpdate_;
+    std::unordered_map<int, PlantState> plants_;
+    uint64_t frameNumber_ = 0;
     
     // Change detection thresholds
     static constexpr double AREA_CHANGE_THRESHOLD = 0.10;  // 10% area change
@@ -48,13 +91,17 @@ private:
     static constexpr double MORPHOLOGY_CHANGE_THRESHOLD = 0.08;
 
 public:
-    ChangeDetector() : lastUpdate_(std::chrono::steady_clock::now()) {}
+    explicit ChangeDetector(ChangeDetectorOptions options = ChangeDetectorOptions())
+        : options_(options), lastUpdate_(std::chrono::steady_clock::now()) {}
     
     // Analyze current frame and detect significant changes
     ChangeDetectionMetrics analyzeFrame(const std::vector<PlantInstance>& instances);
+    // Same, reading the metric columns of PlantAnalysisResult directly
+    ChangeDetectionMetrics analyzeFrame(const PlantMetricsTable& metrics);
     
     // Force update baseline (e.g., after significant changes)
     void updateBaseline(const std::vector<PlantInstance>& instances);
+    void updateBaseline(const PlantMetricsTable& metrics);
     
     // Reset detector (e.g., when system restarts)
     void reset();
@@ -62,10 +109,15 @@ public:
     // Check if baseline is established
     bool hasBaseline() const { return baseline_.isValid; }
     
+    // The change signal as JSON, for the frame payload; writeChangeSignal stores the same document
+    nlohmann::json changeSignal(const ChangeDetectionMetrics& metrics) const;
+
     // Write change detection results to file for AI component
     bool writeChangeSignal(const ChangeDetectionMetrics& metrics, const std::string& filePath = "/app/data/change_signal.json") const;
 
 private:
-    BaselineData computeBaseline(const std::vector<PlantInstance>& instances) const;
-    double calculateMorphologyScore(const std::vector<PlantInstance>& instances) const;
+    BaselineData computeBaseline(const PlantMetricsTable& metrics) const;
+    double calculateMorphologyScore(const PlantMetricsTable& metrics) const;
+    void trackPlants(const PlantMetricsTable& metrics, ChangeDetectionMetrics& result);
+    void blendBaseline(const BaselineData& current);
 };
@@ -4,10 +4,13 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <unordered_map>
 #include <memory>
 #include <opencv2/opencv.hpp>
 #include <nlohmann/json.hpp>
 
+#include "capture_source.hpp"
+
 struct PlantTypeDefinition {
     struct Characteristics {
         double max_area_pixels;
@@ -56,23 +59,25 @@ struct CameraConfig {
     } location;
     
     struct Input {
-        enum Mode { IMAGE, CAMERA, URL } mode;
+        enum Mode { IMAGE, CAMERA, URL } mode = IMAGE;
         std::string path;
         std::string url;
-        int device_id;
+        int device_id = 0;
+        CaptureOptions capture;     // "input.capture", defaulting to the top-level "capture" section
     } input;
     
     struct ProcessingOverrides {
-        int threshold;
-        double scale_px_per_cm;
-        bool sprout_focus;
+        int threshold = 100;
+        double scale_px_per_cm = 0.0;
+        int publish_interval_ms = 30000;
+        bool sprout_focus = false;
         cv::Rect focus_area;
     } processing_overrides;
     
     struct Output {
-        bool save_images;
-        int image_quality;
-        bool enable_base64;
+        bool save_images = true;
+        int image_quality = 90;
+        bool enable_base64 = true;
     } output;
 };
 
@@ -98,6 +103,17 @@ struct MQTTConfig {
     std::map<std::string, bool> retain;
 };
 
+// Manual labels from classes_overrides.json ({"3": {"label": "basil"}}), keyed by instance id
+struct ClassOverrides {
+    std::unordered_map<int, std::string> labels;
+
+    // nullptr when the instance has no override
+    const std::string* label(int instance_id) const;
+};
+
+// A missing file yields empty overrides; false (out untouched) when the file is not valid JSON yet
+bool loadClassOverrides(const std::string& path, ClassOverrides& out);
+
 class ConfigManager {
 private:
     nlohmann::json config_json;
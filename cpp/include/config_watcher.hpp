@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief RCU-style holder for parsed configuration
+ *
+ * Readers take a shared_ptr snapshot and keep using it for the rest of their
+ * cycle; the writer builds a complete replacement off to the side and swaps
+ * it in. Neither side ever sees a half-updated value or waits on the other.
+ */
+template <typename T>
+class ConfigSnapshot {
+public:
+    ConfigSnapshot() : value_(std::make_shared<const T>()) {}
+    explicit ConfigSnapshot(T initial) : value_(std::make_shared<const T>(std::move(initial))) {}
+
+    std::shared_ptr<const T> load() const { return std::atomic_load(&value_); }
+    void store(T value) {
+        std::shared_ptr<const T> next = std::make_shared<const T>(std::move(value));
+        std::atomic_store(&value_, std::move(next));
+    }
+
+private:
+    std::shared_ptr<const T> value_;
+};
+
+/**
+ * @brief Runs a callback on a background thread whenever a watched file changes
+ *
+ * Changes are detected by polling modification time and size rather than with
+ * inotify, which misses edits on bind-mounted volumes and files replaced by
+ * rename. A callback returning false (e.g. it caught a half-written file) is
+ * retried on the next poll.
+ */
+class FileWatcher {
+public:
+    explicit FileWatcher(std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Register before start(); the current state of the file counts as seen
+    void watch(const std::string& path, std::function<bool()> onChange);
+    void start();
+    void stop();
+
+private:
+    struct Entry {
+        std::string path;
+        std::function<bool()> onChange;
+        bool exists = false;
+        std::filesystem::file_time_type mtime;
+        std::uintmax_t size = 0;
+    };
+
+    static bool stat(const std::string& path, std::filesystem::file_time_type& mtime, std::uintmax_t& size);
+    void run();
+
+    std::chrono::milliseconds interval_;
+    std::vector<Entry> entries_;
+    std::atomic<bool> running_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
+/**
+ * @brief Per-frame cache of derived colour planes
+ *
+ * Every stage that looks at the same frame (plant segmentation, basic metrics,
+ * AI request generation and the per-instance helpers) used to run its own
+ * cvtColor/inRange passes. A FrameContext computes each plane lazily on first
+ * use and hands out the cached result afterwards. Accessors are thread-safe so
+ * the parallel per-instance workers can share one context; callers must treat
+ * the returned planes as read-only. Planes are backed by ScratchPool buffers,
+ * so a steady stream of same-sized frames stops allocating them.
+ */
+class FrameContext {
+public:
+    // Default green segmentation range shared by analyzePlants and VisionProcessor
+    static const cv::Scalar GREEN_HSV_LOWER;
+    static const cv::Scalar GREEN_HSV_UPPER;
+
+    explicit FrameContext(const cv::Mat& bgr);
+
+    FrameContext(const FrameContext&) = delete;
+    FrameContext& operator=(const FrameContext&) = delete;
+
+    const cv::Mat& bgr() const { return bgr_; }
+    bool empty() const { return bgr_.empty(); }
+    cv::Size size() const { return bgr_.size(); }
+
+    const cv::Mat& hsv() const;
+    const cv::Mat& lab() const;
+    const cv::Mat& gray() const;
+
+    /**
+     * @brief Green vegetation mask: HSV in-range, opened 3x3 and closed 5x5 (elliptical)
+     */
+    const cv::Mat& greenMask() const;
+
+    /**
+     * @brief The frame shrunk by factor (INTER_AREA) as a context of its own
+     *
+     * Built once per factor and shared; factor <= 1 returns this context.
+     * Coordinates on a level are the full-frame ones divided by factor.
+     */
+    const FrameContext& level(int factor) const;
+
+    /**
+     * @brief A region of a plane, clipped to the frame
+     *
+     * A view into the cached plane when it has already been computed for the
+     * whole frame, otherwise only the region is converted. Lets per-instance
+     * work on a large frame skip the full-frame conversions entirely.
+     */
+    cv::Mat hsvRegion(const cv::Rect& roi) const;
+    cv::Mat grayRegion(const cv::Rect& roi) const;
+    cv::Mat greenMaskRegion(const cv::Rect& roi) const;
+
+private:
+    cv::Mat bgr_;
+
+    mutable cv::Mat hsv_;
+    mutable cv::Mat lab_;
+    mutable cv::Mat gray_;
+    mutable cv::Mat green_mask_;
+
+    mutable std::once_flag hsv_once_;
+    mutable std::once_flag lab_once_;
+    mutable std::once_flag gray_once_;
+    mutable std::once_flag green_mask_once_;
+
+    mutable std::atomic<bool> hsv_ready_{false};
+    mutable std::atomic<bool> gray_ready_{false};
+    mutable std::atomic<bool> green_mask_ready_{false};
+
+    mutable std::mutex levels_mutex_;
+    mutable std::map<int, std::unique_ptr<FrameContext>> levels_;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+// Tuning knobs for FrameGate
+struct FrameGateOptions {
+    // Width of the thumbnail the check runs on (height keeps the aspect ratio)
+    int downscaleWidth = 160;
+    // Mean absolute grey difference (0-255) that counts as motion
+    double motionThreshold = 3.0;
+    // Fraction of thumbnail pixels that changed by more than pixelDelta
+    double changedPixelThreshold = 0.02;
+    int pixelDelta = 25;
+    // Absolute change in the fraction of green pixels
+    double greenRatioThreshold = 0.01;
+    // Force a full analysis after this many gated frames (0 = never)
+    int refreshInterval = 10;
+};
+
+/**
+ * @brief Cheap pre-check deciding whether a frame needs the full analysis
+ *
+ * The frame is shrunk to a small thumbnail and compared, in grey level and
+ * green coverage, with the thumbnail of the last frame that was fully
+ * analysed. Comparing against that reference rather than the previous frame
+ * lets slow drift accumulate until it crosses a threshold.
+ */
+class FrameGate {
+public:
+    struct Decision {
+        bool analyze = true;
+        std::string reason;
+        double motion = 0.0;
+        double changedFraction = 0.0;
+        double greenRatioDelta = 0.0;
+        int framesSinceAnalysis = 0;
+    };
+
+    explicit FrameGate(const FrameGateOptions& options = FrameGateOptions());
+
+    /**
+     * @brief Compare frame with the reference; call markAnalyzed() once a full analysis succeeded
+     */
+    Decision evaluate(const cv::Mat& frame);
+
+    /**
+     * @brief Make the last evaluated frame the new reference
+     */
+    void markAnalyzed();
+
+    void reset();
+
+private:
+    FrameGateOptions options_;
+
+    cv::Mat reference_gray_;
+    double reference_green_ratio_ = 0.0;
+    bool has_reference_ = false;
+
+    cv::Mat pending_gray_;
+    double pending_green_ratio_ = 0.0;
+    int frames_since_analysis_ = 0;
+
+    cv::Mat small_;
+    cv::Mat small_hsv_;
+    cv::Mat green_;
+    cv::Mat diff_;
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "capture_source.hpp"
+
+/**
+ * @brief Bounded lock-free single-producer / single-consumer ring
+ *
+ * The producer only advances tail_ and the consumer only advances head_, so
+ * neither side takes a lock. Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side; leaves value untouched and returns false when full
+    bool tryPush(T& value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool tryPop(T& value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots_[head & mask_]);
+        slots_[head & mask_] = T();     // Release Mats and buffers held by the slot now
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+/**
+ * @brief One pipeline stage: a worker thread running handler on each queued job
+ *
+ * Jobs cross threads through an SpscQueue, so push() must always be called
+ * from the same thread. When the queue is full push() backs off until the
+ * stage catches up, which bounds the pipeline by its slowest stage instead
+ * of letting work pile up. The destructor finishes queued jobs before joining.
+ */
+template <typename Job>
+class PipelineStage {
+public:
+    PipelineStage(size_t capacity, std::function<void(Job&)> handler)
+        : queue_(capacity), handler_(std::move(handler)), worker_([this]() { run(); }) {}
+
+    ~PipelineStage() {
+        stopping_.store(true, std::memory_order_release);
+        wake_cv_.notify_one();
+        worker_.join();
+    }
+
+    PipelineStage(const PipelineStage&) = delete;
+    PipelineStage& operator=(const PipelineStage&) = delete;
+
+    void push(Job job) {
+        while (!queue_.tryPush(job)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        // Only parks the idle worker; the hand-off itself is the lock-free push above
+        wake_cv_.notify_one();
+    }
+
+    size_t pending() const { return queue_.size(); }
+    double lastJobMs() const { return last_job_us_.load(std::memory_order_relaxed) / 1000.0; }
+
+private:
+    void run() {
+        Job job;
+        while (true) {
+            if (queue_.tryPop(job)) {
+                const auto start = std::chrono::steady_clock::now();
+                handler_(job);
+                job = Job();
+                last_job_us_.store(std::chrono::duration_cast<std::chrono::microseconds>(
+                                       std::chrono::steady_clock::now() - start).count(),
+                                   std::memory_order_relaxed);
+                continue;
+            }
+            if (stopping_.load(std::memory_order_acquire)) {
+                break;
+            }
+            // A notify racing this wait is caught by the timeout
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_cv_.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+                return queue_.size() > 0 || stopping_.load(std::memory_order_acquire);
+            });
+        }
+    }
+
+    SpscQueue<Job> queue_;
+    std::function<void(Job&)> handler_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<int64_t> last_job_us_{0};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::thread worker_;
+};
+
+/**
+ * @brief Capture thread that always holds the newest frame
+ *
+ * Reading as fast as the source delivers keeps the driver and network
+ * buffers empty, so an RTSP stream never hands the analysis a frame that is
+ * seconds old. Frames that arrive before the previous one was taken are
+ * dropped and counted. The source is reopened after repeated read failures.
+ */
+class FrameGrabber {
+public:
+    struct Stats {
+        uint64_t grabbed = 0;
+        uint64_t dropped = 0;       // Replaced before anyone took them
+        uint64_t read_errors = 0;
+        uint64_t reopens = 0;
+        double frame_age_ms = 0.0;  // Age of the frame most recently taken
+    };
+
+    FrameGrabber() = default;
+    ~FrameGrabber();
+
+    FrameGrabber(const FrameGrabber&) = delete;
+    FrameGrabber& operator=(const FrameGrabber&) = delete;
+
+    // Open a local camera or a stream URL and start the capture thread
+    bool start(int camera_id, const CaptureOptions& options = CaptureOptions());
+    bool start(const std::string& url, const CaptureOptions& options = CaptureOptions());
+    void stop();
+    bool isRunning() const { return running_.load(); }
+
+    /**
+     * @brief Take the newest frame if it is newer than sequence
+     *
+     * Waits up to timeout for one to arrive. On success frame shares the
+     * grabber's buffer (treat it as read-only) and sequence is updated.
+     */
+    bool latest(cv::Mat& frame, uint64_t& sequence, std::chrono::milliseconds timeout);
+
+    Stats stats() const;
+
+private:
+    bool open();
+    void captureLoop();
+
+    int camera_id_ = -1;
+    std::string url_;
+    CaptureOptions options_;
+    cv::VideoCapture capture_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    mutable std::mutex mutex_;
+    std::condition_variable frame_cv_;
+    cv::Mat latest_;
+    uint64_t sequence_ = 0;
+    bool taken_ = true;
+    std::chrono::steady_clock::time_point captured_at_;
+    Stats stats_;
+};
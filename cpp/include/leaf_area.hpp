@@ -1,10 +1,15 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <array>
 #include <vector>
 #include <string>
 #include <chrono>
 
+#include "frame_context.hpp"
+
+class PlantTracker;
+
 enum class PlantType {
     SPROUT,
     PLANT
@@ -20,6 +25,11 @@ enum class GrowthStage {
     DORMANT
 };
 
+// Per-plant colour signature: hue x saturation bins over the plant pixels
+constexpr int PLANT_HISTOGRAM_HUE_BINS = 16;
+constexpr int PLANT_HISTOGRAM_SAT_BINS = 4;
+constexpr int PLANT_HISTOGRAM_BINS = PLANT_HISTOGRAM_HUE_BINS * PLANT_HISTOGRAM_SAT_BINS;
+
 struct PlantInstance {
     PlantType type;
     GrowthStage stage;
@@ -68,24 +78,97 @@ struct PlantInstance {
     int yellowAreaCount = 0;
     std::vector<cv::Point> brownSpotLocations;
     std::vector<cv::Point> yellowAreaLocations;
+
+    // Hue-major HSV histogram of the plant mask, summing to 1 (all zero without plant pixels)
+    std::array<float, PLANT_HISTOGRAM_BINS> colorHistogram{};
+
+    // Frame-to-frame identity (-1 when tracking is disabled)
+    int trackId = -1;
+    bool analysisReused = false;
+};
+
+/**
+ * @brief Column view of the scalar metrics of a frame's instances
+ *
+ * A copy, not a different storage layout: PlantInstance still owns every
+ * field, including its contour, point lists and images, and stays the record
+ * the tracker, publisher and batch output work with. Row i repeats the scalar
+ * fields of result.instances[i] one contiguous column per field, so the frame
+ * totals and the change detector scan plain arrays. Rebuild it with from()
+ * after changing instances.
+ */
+struct PlantMetricsTable {
+    std::vector<PlantType> type;
+    std::vector<GrowthStage> stage;
+    std::vector<int> trackId;
+    std::vector<char> analysisReused;
+    std::vector<double> areaPixels;
+    std::vector<double> areaCm2;
+    std::vector<double> heightCm;
+    std::vector<double> widthCm;
+    std::vector<int> leafCount;
+    std::vector<double> healthScore;
+    std::vector<double> solidity;
+    std::vector<double> circularity;
+    std::vector<double> eccentricity;
+    std::vector<double> compactness;
+    std::vector<double> ndvi;
+    std::vector<double> exg;
+    std::vector<int> brownSpotCount;
+    std::vector<int> yellowAreaCount;
+    // Mean crop colour, BGR
+    std::vector<double> meanB;
+    std::vector<double> meanG;
+    std::vector<double> meanR;
+    // PLANT_HISTOGRAM_BINS floats per row, rows back to back
+    std::vector<float> colorHistogram;
+
+    size_t size() const { return areaPixels.size(); }
+    bool empty() const { return areaPixels.empty(); }
+    void reserve(size_t count);
+    void append(const PlantInstance &instance);
+    const float *histogram(size_t row) const { return colorHistogram.data() + row * PLANT_HISTOGRAM_BINS; }
+
+    static PlantMetricsTable from(const std::vector<PlantInstance> &instances);
 };
 
 struct PlantAnalysisResult {
-    double scalePxPerCm;
-    int totalInstanceCount;
-    int sproutCount;
-    int plantCount;
-    double totalAreaPixels;
-    double totalAreaCm2;
+    double scalePxPerCm = 0.0;
+    int totalInstanceCount = 0;
+    int sproutCount = 0;
+    int plantCount = 0;
+    double totalAreaPixels = 0.0;
+    double totalAreaCm2 = 0.0;
     std::vector<PlantInstance> instances;
+    // Scalar copy of instances, filled alongside it
+    PlantMetricsTable metrics;
     cv::Mat annotatedFrame;
     std::string analysisTimestamp;
     double averageHealth = 0.0;
     double processingTimeMs = 0.0;
+    int reusedInstanceCount = 0;
+};
+
+// Tuning knobs for analyzePlants
+struct AnalysisOptions {
+    // Upper bound on concurrently analysed instances: 0 = use OpenCV's worker pool, 1 = serial
+    int workerThreads = 0;
+    // Split touching plants with a watershed over the green mask instead of plain external contours
+    bool separateTouching = true;
+    // Segment on the frame reduced by this factor (2, 4, 8) and trace each plant again at full
+    // resolution inside its scaled-up box; 1 = segment the full frame
+    int pyramidFactor = 1;
+    // Optional tracker giving stable ids and reusing the analysis of unchanged plants
+    PlantTracker *tracker = nullptr;
 };
 
 // Main analysis function that classifies and processes both sprouts and plants
 PlantAnalysisResult analyzePlants(const cv::Mat &frameBgr, int thresholdValue, double scalePxPerCm);
+PlantAnalysisResult analyzePlants(const cv::Mat &frameBgr, int thresholdValue, double scalePxPerCm,
+                                  const AnalysisOptions &options);
+// Same as above, reusing the colour planes cached in a shared per-frame context
+PlantAnalysisResult analyzePlants(const FrameContext &frame, int thresholdValue, double scalePxPerCm,
+                                  const AnalysisOptions &options = AnalysisOptions());
 
 // Classification functions
 PlantType classifyPlantType(const cv::Mat &roi, const cv::Rect &bbox, double areaPixels, double scalePxPerCm);
@@ -94,6 +177,8 @@ GrowthStage determineGrowthStage(PlantType type, const cv::Mat &roi, double area
 // Specialized processing pipelines
 PlantInstance processSprout(const cv::Mat &frame, const cv::Rect &bbox, const std::vector<cv::Point> &contour, double scalePxPerCm);
 PlantInstance processPlant(const cv::Mat &frame, const cv::Rect &bbox, const std::vector<cv::Point> &contour, double scalePxPerCm);
+PlantInstance processSprout(const FrameContext &frame, const cv::Rect &bbox, const std::vector<cv::Point> &contour, double scalePxPerCm);
+PlantInstance processPlant(const FrameContext &frame, const cv::Rect &bbox, const std::vector<cv::Point> &contour, double scalePxPerCm);
 
 // Legacy compatibility function
 struct LeafAreaResult {
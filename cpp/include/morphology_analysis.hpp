@@ -4,6 +4,8 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 
+#include "skeleton.hpp"
+
 namespace PlantVision {
 namespace Morphology {
 
@@ -29,6 +31,8 @@ struct MorphologyMetrics {
     int tip_points;
     std::vector<double> segment_lengths;
     std::vector<double> segment_angles;
+    std::vector<cv::Point> branch_locations;
+    std::vector<cv::Point> tip_locations;
     
     // Bounding measurements
     cv::Rect bounding_box;
@@ -45,12 +49,15 @@ struct MorphologyMetrics {
 class MorphologyAnalyzer {
 public:
     MorphologyAnalyzer();
+    explicit MorphologyAnalyzer(SkeletonEngine skeleton_engine);
     ~MorphologyAnalyzer();
     
     // Core analysis functions (adapted from PlantCV concepts)
     MorphologyMetrics analyzeMorphology(const cv::Mat& mask, const cv::Mat& original_img);
     
     // Skeleton analysis (inspired by PlantCV morphology module)
+    void setSkeletonEngine(SkeletonEngine engine) { skeleton_engine_ = engine; }
+    SkeletonEngine getSkeletonEngine() const { return skeleton_engine_; }
     cv::Mat skeletonize(const cv::Mat& binary_mask);
     std::vector<cv::Point> findBranchPoints(const cv::Mat& skeleton);
     std::vector<cv::Point> findTipPoints(const cv::Mat& skeleton);
@@ -68,6 +75,8 @@ public:
     double calculateLeafAngle(const std::vector<cv::Point>& contour);
     
 private:
+    SkeletonEngine skeleton_engine_;
+
     void prunesSkeleton(cv::Mat& skeleton, int iterations = 1);
     std::vector<double> calculateSegmentAngles(const std::vector<std::vector<cv::Point>>& segments);
     double calculatePathLength(const std::vector<cv::Point>& path);
@@ -1,19 +1,147 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include <sys/uio.h>
+
+// One outbound message; the payload is shared, never copied, on its way to the socket
+struct MqttMessage {
+    std::string topic;
+    std::shared_ptr<const std::string> payload;
+    int qos = 0;
+    bool retain = false;
+
+    static MqttMessage make(std::string topic, std::string payload, int qos = 0, bool retain = false) {
+        return {std::move(topic), std::make_shared<const std::string>(std::move(payload)), qos, retain};
+    }
+};
+
+struct MqttClientOptions {
+    std::string client_id = "plantvision-client";
+    int keepalive_sec = 60;
+    // Messages held while the broker is unreachable; the oldest is dropped beyond this
+    size_t max_queued_messages = 1000;
+    // Unacknowledged QoS 1 messages on the wire at once
+    size_t max_inflight = 64;
+    int reconnect_min_ms = 500;
+    int reconnect_max_ms = 30000;
+    int connect_timeout_ms = 5000;
+};
+
+/**
+ * @brief Minimal MQTT 3.1.1 client with a background network thread
+ *
+ * publish() only enqueues; a network thread owns the socket, keeps the
+ * session alive with PINGREQ, reconnects with exponential backoff and flushes
+ * the bounded outbound queue once the broker is back. QoS 1 messages keep
+ * their packet id until the PUBACK arrives and are re-sent with DUP set after
+ * a reconnect.
+ *
+ * The network thread drains the queue in batches: fixed and variable headers
+ * are encoded back to back into one reusable buffer and handed to sendmsg()
+ * together with the payload buffers as an iovec list, so a frame's worth of
+ * messages leaves in one or a few syscalls and payloads are never copied.
+ */
 class MqttClient {
 public:
-    MqttClient(const std::string &host, int port);
+    struct Stats {
+        bool connected = false;
+        size_t queued = 0;
+        size_t inflight = 0;
+        uint64_t sent = 0;
+        uint64_t acked = 0;
+        uint64_t dropped = 0;
+        uint64_t reconnects = 0;
+    };
+
+    MqttClient(const std::string &host, int port, const MqttClientOptions &options = MqttClientOptions());
     ~MqttClient();
 
+    MqttClient(const MqttClient &) = delete;
+    MqttClient &operator=(const MqttClient &) = delete;
+
+    /**
+     * @brief Start the network thread and wait up to connect_timeout_ms for the first CONNACK
+     * @return true if connected; on false the thread keeps retrying in the background
+     */
     bool connect();
+
+    /**
+     * @brief Queue a message for delivery; never blocks on the network
+     * @return false if an older message had to be dropped to make room
+     */
     bool publish(const std::string &topic, const std::string &payload, int qos = 0, bool retain = false);
+    bool publish(const std::string &topic, std::shared_ptr<const std::string> payload, int qos = 0, bool retain = false);
+
+    /**
+     * @brief Queue several messages under one lock and one wake-up of the network thread
+     * @return false if older messages had to be dropped to make room
+     */
+    bool publishBatch(const std::vector<MqttMessage> &messages);
+
+    /**
+     * @brief Flush what can be sent within a short grace period, send DISCONNECT and stop
+     */
     void disconnect();
 
+    bool isConnected() const;
+    Stats stats() const;
+
 private:
+    struct Message {
+        MqttMessage message;
+        uint16_t packet_id = 0;
+        bool dup = false;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    void networkLoop();
+    bool openSession();
+    void closeSocket();
+    size_t sendBatch(const std::vector<Message> &batch);
+    bool enqueueLocked(const MqttMessage &message);
+    bool sendPacket(const std::string &packet);
+    bool readPackets();
+    void requeueInflight();
+    void wake();
+    uint16_t nextPacketId();
+
     std::string host_;
     int port_;
-    int sock_;
-};
+    MqttClientOptions options_;
+
+    int sock_ = -1;
+    int wake_pipe_[2] = {-1, -1};
+    std::string rx_buffer_;
 
+    // Reused by sendBatch
+    std::vector<Message> batch_;
+    std::string header_buffer_;
+    std::vector<size_t> header_offsets_;
+    std::vector<size_t> message_ends_;
+    std::vector<struct iovec> iov_;
+    Clock::time_point last_sent_;
+    Clock::time_point ping_sent_;
+    bool ping_outstanding_ = false;
+    uint16_t last_packet_id_ = 0;
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable state_cv_;
+    std::deque<Message> queue_;
+    std::map<uint16_t, Message> inflight_;
+    bool running_ = false;
+    bool stopping_ = false;
+    bool connected_ = false;
+    Stats stats_;
+};
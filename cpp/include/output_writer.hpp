@@ -0,0 +1,110 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Asynchronous disk output stage for per-frame images and JSON
+ *
+ * The analysis loop hands each frame's outputs over as one batch of
+ * ref-counted Mats and serialized documents and returns immediately. Writer
+ * threads do the JPEG encoding, create directories with std::filesystem and
+ * write every file to a temporary name before renaming it into place, so
+ * readers never observe a half-written file. When the bounded queue is full
+ * the oldest pending batch is dropped rather than stalling capture.
+ */
+class OutputWriter {
+public:
+    struct Item {
+        std::string path;
+        cv::Mat image;              // Encoded according to the path extension when set
+        std::vector<int> params;    // cv::imencode parameters
+        std::string text;           // Written verbatim when no image is set
+        std::shared_ptr<const std::string> shared_text;  // Takes precedence over text when set
+        cv::Mat patch;              // Pasted over image(patch_roi) before encoding
+        cv::Rect patch_roi;
+    };
+
+    struct Batch {
+        int frame_number = 0;
+        std::vector<Item> items;
+        std::chrono::steady_clock::time_point submitted;
+
+        void addImage(const std::string& path, const cv::Mat& image, const std::vector<int>& params = {});
+        void addText(const std::string& path, std::string text);
+        // Write a buffer that other consumers (e.g. MQTT) hold too, without copying it
+        void addText(const std::string& path, std::shared_ptr<const std::string> text);
+        /**
+         * @brief Queue base with patch pasted at roi, without copying base
+         *
+         * Items sharing the same base are composed in one reusable per-thread
+         * canvas, so N highlights of a frame cost one full-frame copy in total.
+         */
+        void addComposite(const std::string& path, const cv::Mat& base, const cv::Mat& patch,
+                          const cv::Rect& roi, const std::vector<int>& params = {});
+    };
+
+    struct Stats {
+        size_t queue_depth = 0;
+        uint64_t batches_written = 0;
+        uint64_t batches_dropped = 0;
+        uint64_t write_errors = 0;
+        double last_write_latency_ms = 0.0;   // Submit to last file renamed, for the latest batch
+        double last_io_time_ms = 0.0;         // Encode + write time of the latest batch
+    };
+
+    /**
+     * @param max_queue_depth Batches held before the oldest is dropped
+     * @param worker_threads Writer threads; with more than one, consecutive
+     *        batches may land out of order for files they share
+     */
+    explicit OutputWriter(size_t max_queue_depth = 4, int worker_threads = 1);
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    /**
+     * @brief Queue a batch for writing; never blocks on disk I/O
+     * @return false if an older batch had to be dropped to make room
+     */
+    bool submit(Batch batch);
+
+    /**
+     * @brief Block until every queued batch has been written
+     */
+    void flush();
+
+    Stats stats() const;
+
+private:
+    void workerLoop(int worker);
+    void writeBatch(const Batch& batch, int worker);
+    bool writeItem(const Item& item, std::vector<uchar>& encode_buffer, int worker);
+    static bool encodeComposite(const Item& item, const std::string& ext, std::vector<uchar>& encode_buffer);
+    bool ensureDirectory(const std::filesystem::path& dir);
+
+    size_t max_queue_depth_;
+    std::vector<std::thread> workers_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable queue_cv_;
+    std::condition_variable idle_cv_;
+    std::deque<Batch> queue_;
+    int active_batches_ = 0;
+    bool stopping_ = false;
+    Stats stats_;
+
+    std::mutex dirs_mutex_;
+    std::set<std::string> known_dirs_;
+};
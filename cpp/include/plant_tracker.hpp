@@ -0,0 +1,89 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <vector>
+
+#include "frame_context.hpp"
+#include "leaf_area.hpp"
+
+// Tuning knobs for PlantTracker
+struct TrackerOptions {
+    // A candidate matches a track when the boxes overlap this much...
+    double minIoU = 0.3;
+    // ...or, failing that, when the centroids are closer than this
+    double maxCentroidDistancePx = 40.0;
+    // Cached analysis is reused when the ROI thumbnail changed less than this (mean abs diff, 0-255)
+    double maxAppearanceDelta = 3.0;
+    // ...and the contour area changed by less than this fraction
+    double maxAreaDelta = 0.05;
+    // Frames a track survives without a match
+    int maxMissedFrames = 3;
+    // Force a full re-analysis after this many consecutive reuses (0 = never)
+    int refreshInterval = 20;
+};
+
+/**
+ * @brief Matches plant contours across frames and caches their analysis
+ *
+ * Tracks are matched greedily by bounding-box IoU, with centroid distance as a
+ * fallback for small or fast-growing plants, and keep a stable id for as long
+ * as they are seen. Each track remembers a small grey thumbnail of its ROI;
+ * when a new contour looks the same, analyzePlants reuses the cached
+ * PlantInstance instead of re-running the morphology and disease pipeline.
+ *
+ * Usage per frame: assign() before analysis, commit() with the results. The
+ * cached instances returned by assign() stay valid until commit().
+ */
+class PlantTracker {
+public:
+    struct Assignment {
+        int trackId = -1;
+        const PlantInstance* cached = nullptr;  // Non-null when the analysis can be reused
+    };
+
+    explicit PlantTracker(const TrackerOptions& options = TrackerOptions());
+
+    /**
+     * @brief Assign a track id to every candidate contour of the frame
+     */
+    std::vector<Assignment> assign(const FrameContext& frame, const std::vector<std::vector<cv::Point>>& contours);
+
+    /**
+     * @brief Store this frame's instances; entries with ok[k] == 0 are treated as unmatched
+     */
+    void commit(const std::vector<Assignment>& assignments, const std::vector<PlantInstance>& instances,
+                const std::vector<char>& ok);
+
+    // Drops every track; ids are not reused, so history keyed by id stays unambiguous
+    void reset();
+    // Continue numbering at least from first_id, e.g. after the ids already in a time-series store
+    void seedIds(int first_id) { next_id_ = std::max(next_id_, first_id); }
+    size_t trackCount() const { return tracks_.size(); }
+
+private:
+    struct Track {
+        int id = -1;
+        cv::Rect bbox;
+        cv::Point2f centroid;
+        double area = 0.0;
+        cv::Mat thumbnail;
+        PlantInstance instance;
+        bool hasInstance = false;
+        int missed = 0;
+        int reuseCount = 0;
+    };
+
+    struct Observation {
+        cv::Rect bbox;
+        cv::Point2f centroid;
+        double area = 0.0;
+        cv::Mat thumbnail;
+        int track = -1;   // Index into tracks_
+    };
+
+    TrackerOptions options_;
+    std::vector<Track> tracks_;
+    std::vector<Observation> pending_;
+    int next_id_ = 0;
+};
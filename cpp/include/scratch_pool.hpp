@@ -0,0 +1,61 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Recycled pixel buffers for the per-frame hot path
+ *
+ * Every frame used to allocate its colour planes, the annotated copy and a
+ * dozen ROI-sized masks per plant, and free them again a few milliseconds
+ * later. A ScratchPool keeps those buffers instead. acquire() hands out an
+ * ordinary reference-counted cv::Mat backed by a pooled buffer; the buffer
+ * goes back into circulation by itself once every Mat sharing it has been
+ * released, so results that outlive the frame (crops kept by the tracker, an
+ * annotated frame queued for writing) simply keep their buffer busy.
+ *
+ * Only 8-bit types are pooled; anything else is allocated as usual. Contents
+ * of an acquired Mat are undefined unless zeros() is used. Passing the Mat as
+ * the destination of an OpenCV call with the same size and type writes into
+ * the pooled buffer; a mismatching call reallocates and only loses the reuse.
+ */
+class ScratchPool {
+public:
+    struct Stats {
+        uint64_t hits = 0;          // acquisitions served from a free buffer
+        uint64_t misses = 0;        // acquisitions that allocated
+        size_t buffers = 0;         // buffers currently held
+        size_t bytes = 0;           // capacity of the held buffers
+    };
+
+    explicit ScratchPool(size_t max_bytes);
+
+    ScratchPool(const ScratchPool&) = delete;
+    ScratchPool& operator=(const ScratchPool&) = delete;
+
+    // Process-wide pool for full-frame planes, which are created and released on different threads
+    static ScratchPool& shared();
+    // The calling thread's pool for short-lived per-instance masks
+    static ScratchPool& local();
+
+    cv::Mat acquire(cv::Size size, int type);
+    cv::Mat zeros(cv::Size size, int type);
+
+    Stats stats() const;
+    // Buffers allocated by all pools since start; flat in steady state
+    static uint64_t allocations();
+
+private:
+    cv::Mat allocate(size_t capacity);
+
+    size_t max_bytes_;
+    size_t bytes_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    // Each buffer is a 1 x capacity CV_8U Mat; the pool's own reference keeps it alive
+    std::vector<cv::Mat> buffers_;
+    mutable std::mutex mutex_;
+};
@@ -0,0 +1,76 @@
+#ifndef SKELETON_HPP
+#define SKELETON_HPP
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+namespace PlantVision {
+namespace Morphology {
+
+enum class SkeletonEngine {
+    MORPHOLOGICAL,  // Iterative erode/open/subtract loop (legacy)
+    ZHANG_SUEN      // Lookup-table driven Zhang-Suen thinning
+};
+
+// Engine used by skeletonize() callers that do not pick one explicitly
+SkeletonEngine defaultSkeletonEngine();
+void setDefaultSkeletonEngine(SkeletonEngine engine);
+
+// "morphological" or "zhang-suen"/"zhang_suen"; anything else yields fallback
+SkeletonEngine parseSkeletonEngine(const std::string& name, SkeletonEngine fallback = SkeletonEngine::ZHANG_SUEN);
+const char* skeletonEngineName(SkeletonEngine engine);
+
+/**
+ * @brief Thin a binary mask (non-zero = foreground) to a one-pixel, 8-connected skeleton
+ *
+ * Neighbourhood decisions come from two 256-entry tables, and each pass only
+ * visits pixels that are still foreground, so the cost shrinks as the shape
+ * thins instead of rescanning the whole image. The padded work buffer is
+ * per-thread and reused; passing the same skeleton Mat again reuses its
+ * allocation too. Output is CV_8UC1 with values 0/255.
+ */
+void thinZhangSuen(const cv::Mat& binary, cv::Mat& skeleton);
+
+/**
+ * @brief Classic morphological skeleton (erode, open, subtract, OR until empty)
+ * @param max_iterations Stop after this many erosions (0 = until empty)
+ */
+cv::Mat morphologicalSkeleton(const cv::Mat& binary, int max_iterations = 0);
+
+cv::Mat skeletonize(const cv::Mat& binary, SkeletonEngine engine);
+
+struct SkeletonSegment {
+    std::vector<cv::Point> points;  // Ordered pixel chain, endpoints included
+    int startNode = -1;             // Index into SkeletonGraph::nodes, -1 for closed loops
+    int endNode = -1;               // -1 when the chain ends without reaching a node
+    double length = 0.0;            // 1 per orthogonal step, sqrt(2) per diagonal step
+    double angle = 0.0;             // Degrees, atan2 of the start-to-end chord
+};
+
+struct SkeletonGraph {
+    std::vector<cv::Point> nodes;         // Tips and branch points in scan order
+    std::vector<cv::Point> tipPoints;     // Exactly one 8-neighbour
+    std::vector<cv::Point> branchPoints;  // Three or more 8-neighbours
+    std::vector<SkeletonSegment> segments;
+    double totalLength = 0.0;             // Sum of the segment lengths kept
+    double longestPath = 0.0;             // Longest node-to-node route (exact on trees)
+};
+
+/**
+ * @brief Classify skeleton pixels and trace the node/segment graph in one pass
+ *
+ * A single row-pointer scan packs each pixel's 8-neighbourhood into a byte
+ * and classifies tips and branch points through a 256-entry table; segments
+ * are then walked from those nodes over the skeleton pixels only.
+ *
+ * @param min_segment_pixels Segments with fewer pixels are left out of
+ *        segments/totalLength (they still count towards longestPath)
+ */
+SkeletonGraph extractSkeletonGraph(const cv::Mat& skeleton, int min_segment_pixels = 0);
+inline cv::Mat skeletonize(const cv::Mat& binary) { return skeletonize(binary, defaultSkeletonEngine()); }
+
+} // namespace Morphology
+} // namespace PlantVision
+
+#endif // SKELETON_HPP
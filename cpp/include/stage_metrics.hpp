@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Lock-free latency histogram with quarter-octave buckets
+ *
+ * Bucket boundaries grow by 2^(1/4) from 1 µs, so any recorded value is
+ * reported within ~19% and the range reaches several minutes. record() is a
+ * handful of relaxed atomic adds and safe to call from any thread.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int BUCKETS = 128;
+
+    struct Snapshot {
+        std::array<uint64_t, BUCKETS> buckets{};
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+        uint64_t max_ns = 0;
+    };
+
+    void record(double ms);
+    Snapshot snapshot() const;
+
+    // Upper bound of a bucket in milliseconds
+    static double bucketUpperMs(int index);
+
+private:
+    static int bucketFor(uint64_t ns);
+
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+struct StageSummary {
+    std::string stage;
+    uint64_t count = 0;
+    double sum_ms = 0.0;
+    double mean_ms = 0.0;
+    double p50_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+};
+
+// Quantiles of `now`, or of what was recorded between `since` and `now`
+StageSummary summarizeHistogram(const std::string& stage, const LatencyHistogram::Snapshot& now,
+                                const LatencyHistogram::Snapshot* since = nullptr);
+
+// Process-wide histogram for a stage; the reference stays valid for the life of the process
+LatencyHistogram& stageHistogram(const std::string& name);
+
+// Every registered stage, sorted by name
+std::map<std::string, LatencyHistogram::Snapshot> snapshotStages();
+
+// Since-start quantiles as Prometheus summaries (plantvision_stage_latency_ms)
+std::string renderPrometheus();
+
+/**
+ * @brief Records the lifetime of a scope into a stage histogram
+ */
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(LatencyHistogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedStageTimer() { histogram_.record(elapsedMs()); }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+    double elapsedMs() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    LatencyHistogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define STAGE_TIMER_CONCAT_INNER(a, b) a##b
+#define STAGE_TIMER_CONCAT(a, b) STAGE_TIMER_CONCAT_INNER(a, b)
+
+// Time the rest of the enclosing scope; the histogram lookup happens once per call site
+#define STAGE_TIMER(name) \
+    static LatencyHistogram& STAGE_TIMER_CONCAT(stage_histogram_, __LINE__) = stageHistogram(name); \
+    ScopedStageTimer STAGE_TIMER_CONCAT(stage_timer_, __LINE__)(STAGE_TIMER_CONCAT(stage_histogram_, __LINE__))
+
+/**
+ * @brief Hands windowed per-stage summaries to a callback at a fixed interval
+ *
+ * Each report covers only what was recorded since the previous one, so a
+ * regression shows up in the next report instead of being averaged away.
+ */
+class MetricsReporter {
+public:
+    using Callback = std::function<void(const std::vector<StageSummary>& stages, double window_ms)>;
+
+    MetricsReporter(std::chrono::milliseconds interval, Callback callback);
+    ~MetricsReporter();
+
+    MetricsReporter(const MetricsReporter&) = delete;
+    MetricsReporter& operator=(const MetricsReporter&) = delete;
+
+private:
+    void run();
+
+    std::chrono::milliseconds interval_;
+    Callback callback_;
+    bool stopping_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+};
+
+/**
+ * @brief Serves renderPrometheus() over plain HTTP for a scraper
+ */
+class MetricsHttpServer {
+public:
+    MetricsHttpServer() = default;
+    ~MetricsHttpServer();
+
+    MetricsHttpServer(const MetricsHttpServer&) = delete;
+    MetricsHttpServer& operator=(const MetricsHttpServer&) = delete;
+
+    // false when the port cannot be bound
+    bool start(int port);
+    void stop();
+
+private:
+    void serveLoop();
+
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Wire format of telemetry published over MQTT
+enum class TelemetryFormat {
+    JSON,       // UTF-8 text, readable by every existing subscriber
+    CBOR,       // RFC 8949 binary, via nlohmann::json::to_cbor
+    MSGPACK     // MessagePack binary, via nlohmann::json::to_msgpack
+};
+
+// Accepts "json", "cbor", "msgpack"/"messagepack" (case-insensitive); anything else is JSON
+TelemetryFormat parseTelemetryFormat(const std::string &name);
+const char *telemetryFormatName(TelemetryFormat format);
+
+/**
+ * @brief Serialize value in the given format into out
+ *
+ * out is cleared first, so a caller can keep one buffer and reuse its
+ * capacity across frames. Binary formats skip JSON's number-to-text
+ * conversion and escaping, which dominates dump() on large payloads.
+ */
+void encodeTelemetry(const nlohmann::json &value, TelemetryFormat format, std::string &out);
+std::string encodeTelemetry(const nlohmann::json &value, TelemetryFormat format);
+
+// A document serialized once, shared by every consumer instead of re-dumped per use
+struct SerializedTelemetry {
+    std::shared_ptr<const std::string> json;    // Compact JSON text, used for files on disk; null unless requested
+    std::shared_ptr<const std::string> wire;    // MQTT payload; the same buffer as json for JSON
+};
+
+// Binary formats dump the JSON text too only with withJson, so a message that is not written to disk is encoded once
+SerializedTelemetry serializeTelemetry(const nlohmann::json &value, TelemetryFormat format, bool withJson = true);
+
+// Standard base64 with padding, written straight into a presized string
+std::string base64Encode(const unsigned char *data, size_t length);
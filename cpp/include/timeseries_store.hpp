@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One instance in one frame, as stored by TimeSeriesWriter
+ *
+ * Fixed 96 bytes, little-endian, no pointers, so a segment can be read as a
+ * plain array (numpy.memmap with a matching dtype works as well as the C++
+ * reader). trackId is the PlantTracker id, -1 for untracked instances.
+ */
+struct TimeSeriesRecord {
+    int64_t timestampMs = 0;        // wall clock, never decreasing within a store
+    uint32_t frameNumber = 0;
+    int32_t trackId = -1;
+    uint8_t type = 0;               // PlantType
+    uint8_t stage = 0;              // GrowthStage
+    uint8_t flags = 0;              // FLAG_* bits
+    uint8_t reserved0 = 0;
+    uint16_t leafCount = 0;
+    uint16_t brownSpotCount = 0;
+    uint16_t yellowAreaCount = 0;
+    uint16_t reserved1 = 0;
+    float areaPixels = 0.0f;
+    float areaCm2 = 0.0f;
+    float heightCm = 0.0f;
+    float widthCm = 0.0f;
+    float healthScore = 0.0f;
+    float solidity = 0.0f;
+    float circularity = 0.0f;
+    float eccentricity = 0.0f;
+    float compactness = 0.0f;
+    float ndvi = 0.0f;
+    float exg = 0.0f;
+    float meanB = 0.0f;
+    float meanG = 0.0f;
+    float meanR = 0.0f;
+    float reserved2[3] = {0.0f, 0.0f, 0.0f};
+
+    static constexpr uint8_t FLAG_REUSED = 1;   // metrics carried over by the tracker, not re-measured
+};
+
+static_assert(sizeof(TimeSeriesRecord) == 96, "TimeSeriesRecord is an on-disk format");
+
+struct TimeSeriesOptions {
+    std::string directory = "/app/data/timeseries";
+    // Records per segment file; 65536 records are 6 MB
+    uint32_t segmentRecords = 1u << 16;
+};
+
+/**
+ * @brief Append-only history of per-instance metrics in memory-mapped segments
+ *
+ * The directory holds segment_<first timestamp ms>.pvts files, preallocated
+ * to segmentRecords records and filled front to back:
+ *   0   64-byte header: magic 'PVTS', version (u16), record size (u16),
+ *       capacity (u32), reserved (u32), count (u64), sealed (u32)
+ *   64  capacity records of sizeof(TimeSeriesRecord)
+ * count is published after the records it covers, so a reader mapping the
+ * file concurrently only ever sees whole records. A full segment is sealed
+ * and gets segment_<ts>.idx beside it: magic 'PVTI', version, entry count
+ * (u64) in a 16-byte header, then (trackId i32, row u32) pairs sorted by
+ * track and row, which turns a per-plant range query into two binary
+ * searches per segment.
+ *
+ * One writer per directory, enforced with a lock file; any number of readers.
+ */
+class TimeSeriesWriter {
+public:
+    explicit TimeSeriesWriter(TimeSeriesOptions options);
+    ~TimeSeriesWriter();
+
+    TimeSeriesWriter(const TimeSeriesWriter&) = delete;
+    TimeSeriesWriter& operator=(const TimeSeriesWriter&) = delete;
+
+    // False when the directory is unusable or held by another writer; append() then does nothing
+    bool isOpen() const { return lock_fd_ >= 0; }
+
+    // Appends one frame's records; timestamps older than the newest stored one are raised to it
+    bool append(const TimeSeriesRecord* records, size_t count);
+    bool append(const std::vector<TimeSeriesRecord>& records) { return append(records.data(), records.size()); }
+
+    // Schedules dirty pages for writeback without waiting for them
+    void flush();
+
+    uint64_t recordsWritten() const { return records_written_; }
+
+    // Largest track id stored so far (-1 when none), so a restarted tracker can number on from it
+    int32_t maxTrackId() const { return max_track_id_; }
+
+private:
+    bool resumeLastSegment();
+    bool createSegment(int64_t firstTimestampMs);
+    void sealSegment();
+
+    TimeSeriesOptions options_;
+    int lock_fd_ = -1;
+    int segment_fd_ = -1;
+    uint8_t* segment_ = nullptr;
+    size_t segment_bytes_ = 0;
+    std::string segment_path_;
+    int64_t last_timestamp_ = std::numeric_limits<int64_t>::min();
+    uint64_t records_written_ = 0;
+    int32_t max_track_id_ = -1;
+};
+
+/**
+ * @brief Range queries over a TimeSeriesWriter directory, safe while it is being written
+ *
+ * Segments are mapped read-only once and pruned by their first and last
+ * timestamps, records are located by binary search on the (non-decreasing)
+ * timestamps, and sealed segments answer per-track queries from their index.
+ */
+class TimeSeriesReader {
+public:
+    static constexpr int32_t ANY_TRACK = std::numeric_limits<int32_t>::min();
+
+    struct TrackSummary {
+        int32_t trackId = -1;
+        uint64_t records = 0;
+        int64_t firstMs = 0;
+        int64_t lastMs = 0;
+    };
+
+    explicit TimeSeriesReader(std::string directory);
+    ~TimeSeriesReader();
+
+    TimeSeriesReader(const TimeSeriesReader&) = delete;
+    TimeSeriesReader& operator=(const TimeSeriesReader&) = delete;
+
+    // Maps segments and indexes created since the last call; the constructor calls it once
+    void refresh();
+
+    // Records of trackId (every track for ANY_TRACK) with fromMs <= timestamp <= toMs, oldest first
+    void forEach(int32_t trackId, int64_t fromMs, int64_t toMs,
+                 const std::function<void(const TimeSeriesRecord&)>& visit) const;
+    std::vector<TimeSeriesRecord> query(int32_t trackId, int64_t fromMs, int64_t toMs) const;
+
+    // Every track id seen, with its record count and time span
+    std::vector<TrackSummary> tracks() const;
+    // Largest track id in the store, -1 when there is none; sealed segments answer from their index
+    int32_t maxTrackId() const;
+
+    size_t segmentCount() const { return segments_.size(); }
+
+private:
+    struct Segment;
+
+    std::string directory_;
+    std::vector<std::unique_ptr<Segment>> segments_;   // oldest first
+};
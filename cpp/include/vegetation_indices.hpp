@@ -0,0 +1,17 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+// Masked colour statistics and vegetation indices gathered in a single pass
+struct VegetationStats {
+    int pixelCount = 0;   // Pixels inside the mask (every pixel when no mask is given)
+    double ndvi = 0.0;    // Mean (G - R) / (G + R), green channel used as NIR proxy
+    double exg = 0.0;     // Mean excess green 2G - R - B on [0, 1] normalised channels
+    cv::Scalar meanBgr = cv::Scalar(0, 0, 0);
+    cv::Scalar stdBgr = cv::Scalar(0, 0, 0);
+};
+
+// Fused, vectorised kernel over an 8-bit BGR image and optional 8-bit mask.
+// Reads each pixel once and accumulates everything in registers, replacing the
+// split/convertTo/mean sequences previously run once per index.
+VegetationStats computeVegetationStats(const cv::Mat &bgr, const cv::Mat &mask = cv::Mat());
@@ -5,6 +5,8 @@
 #include <string>
 #include <chrono>
 
+#include "frame_context.hpp"
+
 /**
  * @brief Consolidated OpenCV vision processing for PlantVision
  * 
@@ -21,21 +23,21 @@ public:
         cv::Scalar std_hsv;
         cv::Scalar std_lab;
         cv::Scalar std_bgr;
-        double green_ratio;
-        double ndvi;
-        double exg;
-        double health_indicator;
-        int total_green_pixels;
+        double green_ratio = 0.0;
+        double ndvi = 0.0;
+        double exg = 0.0;
+        double health_indicator = 0.0;
+        int total_green_pixels = 0;
     };
 
     struct ChangeDetectionResult {
-        bool significant_change;
-        double hue_change;
-        double saturation_change;
-        double green_ratio_change;
-        double total_area_change;
-        int plant_count_change;
-        double motion_magnitude;
+        bool significant_change = false;
+        double hue_change = 0.0;
+        double saturation_change = 0.0;
+        double green_ratio_change = 0.0;
+        double total_area_change = 0.0;
+        int plant_count_change = 0;
+        double motion_magnitude = 0.0;
         std::string change_reason;
     };
 
@@ -66,6 +68,11 @@ public:
      */
     BasicMetrics processBasicMetrics(const cv::Mat& frame);
 
+    /**
+     * @brief Same as above, reusing the colour planes cached in a shared per-frame context
+     */
+    BasicMetrics processBasicMetrics(const FrameContext& frame);
+
     /**
      * @brief Detect significant changes between frames for intelligent AI triggering
      * Replaces the change detection logic currently in Python
@@ -77,18 +84,27 @@ public:
      * Consolidates green masking logic from both Python and C++
      */
     cv::Mat createPlantMask(const cv::Mat& frame, bool enhanced_sensitivity = false);
+    cv::Mat createPlantMask(const FrameContext& frame, bool enhanced_sensitivity = false);
 
     /**
      * @brief Perform comprehensive color analysis using multiple color spaces
      * Replaces redundant color analysis in Python AI module
      */
     ColorAnalysis analyzeColors(const cv::Mat& frame, const cv::Mat& mask);
+    ColorAnalysis analyzeColors(const FrameContext& frame, const cv::Mat& mask);
 
     /**
      * @brief Generate AI analysis request when needed
-     * Creates structured request for Python AI module with minimal data
+     * Creates structured request for Python AI module with minimal data.
+     * save_frame = false skips the JPEG, for frames handed over in shared memory.
      */
     AIRequestData generateAIRequest(const cv::Mat& frame, const BasicMetrics& metrics);
+    AIRequestData generateAIRequest(const FrameContext& frame, const BasicMetrics& metrics, bool save_frame = true);
+
+    /**
+     * @brief The request as the JSON document ai/main.py reads
+     */
+    nlohmann::json serializeAIRequest(const AIRequestData& request, const std::string& request_id) const;
 
     /**
      * @brief Save processed data for AI module consumption
@@ -110,6 +126,14 @@ public:
                                  double green_ratio_threshold = 0.08,
                                  double area_change_threshold = 0.15);
 
+    /**
+     * @brief Compute basic metrics and motion on the frame reduced by factor (1 = full resolution)
+     *
+     * Pixel counts and motion magnitude are scaled back to full-frame units,
+     * so thresholds keep their meaning.
+     */
+    void setAnalysisScale(int factor);
+
     /**
      * @brief Enable/disable debug visualization and logging
      */
@@ -135,10 +159,14 @@ private:
         bool enable_motion_detection = true;
         bool enable_morphological_processing = true;
         int max_processing_time_ms = 100; // Fail-safe for real-time processing
+        int analysis_scale = 1;           // Pyramid level the metrics are computed on
     } config_;
 
-    // State management
-    cv::Mat previous_frame_;
+    // State management: only the previous frame's gray plane and colour analysis are
+    // needed for change detection, so the full BGR frame is not retained
+    cv::Mat previous_gray_;
+    ColorAnalysis previous_colors_;
+    bool has_previous_frame_;
     cv::Mat baseline_frame_;
     BasicMetrics baseline_metrics_;
     int frame_counter_;
@@ -152,11 +180,11 @@ private:
     // Internal processing methods
     cv::Mat preprocessFrame(const cv::Mat& frame);
     std::vector<std::vector<cv::Point>> findPlantContours(const cv::Mat& mask);
-    double calculateMotionMagnitude(const cv::Mat& current, const cv::Mat& previous);
-    cv::Scalar calculateColorMean(const cv::Mat& frame, const cv::Mat& mask, int color_space);
-    cv::Scalar calculateColorStd(const cv::Mat& frame, const cv::Mat& mask, int color_space);
-    double calculateNDVI(const cv::Mat& frame, const cv::Mat& mask);
-    double calculateEXG(const cv::Mat& frame, const cv::Mat& mask);
+    ChangeDetectionResult compareFrames(const ColorAnalysis& current_colors, const ColorAnalysis& previous_colors,
+                                        const cv::Mat& current_gray, const cv::Mat& previous_gray,
+                                        double pixel_weight = 1.0);
+    double calculateMotionMagnitude(const cv::Mat& current_gray, const cv::Mat& previous_gray);
+    void calculateColorStats(const cv::Mat& planes, const cv::Mat& mask, cv::Scalar& mean, cv::Scalar& stddev);
     bool establishBaseline(const cv::Mat& frame);
     void saveDebugImages(const cv::Mat& frame, const cv::Mat& mask, const std::string& suffix);
     void logMetrics(const BasicMetrics& metrics);
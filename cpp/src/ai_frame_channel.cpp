@@ -0,0 +1,290 @@
+#include "ai_frame_channel.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+using json = nlohmann::json;
+
+namespace {
+
+const uint32_t RING_MAGIC = 0x52465650;     // "PVFR" little-endian
+const uint32_t RING_VERSION = 1;
+const size_t RING_HEADER_BYTES = 64;
+const size_t SLOT_HEADER_BYTES = 64;
+const size_t MAX_PENDING_RESULTS = 32;
+const auto CONNECT_RETRY = std::chrono::seconds(5);
+
+struct RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t reserved;
+    uint64_t slot_bytes;
+    uint64_t generation;
+};
+
+struct SlotHeader {
+    uint64_t seq;
+    uint64_t frame_id;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t stride;
+    int32_t roi_x;
+    int32_t roi_y;
+    int32_t roi_width;
+    int32_t roi_height;
+    uint64_t timestamp_ms;
+};
+
+static_assert(sizeof(RingHeader) <= RING_HEADER_BYTES, "ring header outgrew its reserved space");
+static_assert(sizeof(SlotHeader) <= SLOT_HEADER_BYTES, "slot header outgrew its reserved space");
+
+size_t align64(size_t bytes) {
+    return (bytes + 63) & ~size_t(63);
+}
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int roiValue(const json& request, const char* key) {
+    if (!request.contains("roi") || !request["roi"].is_object()) return 0;
+    return request["roi"].value(key, 0);
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+AIFrameChannel::AIFrameChannel(AIChannelOptions options) : options_(std::move(options)) {
+    options_.slots = std::max(1, options_.slots);
+    reader_ = std::thread(&AIFrameChannel::readLoop, this);
+}
+
+AIFrameChannel::~AIFrameChannel() {
+    running_ = false;
+    if (reader_.joinable()) reader_.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socket_fd_ >= 0) ::close(socket_fd_);
+    if (ring_) ::munmap(ring_, ring_bytes_);
+    if (shm_fd_ >= 0) {
+        ::close(shm_fd_);
+        ::shm_unlink(options_.shmName.c_str());
+    }
+}
+
+bool AIFrameChannel::ready() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return socket_fd_ >= 0 || connectLocked();
+}
+
+bool AIFrameChannel::connectLocked() {
+    const auto now = std::chrono::steady_clock::now();
+    if (now < next_connect_) return false;
+    next_connect_ = now + CONNECT_RETRY;
+
+    sockaddr_un addr{};
+    if (options_.socketPath.size() >= sizeof(addr.sun_path)) return false;
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, options_.socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    socket_fd_ = fd;
+    std::cout << "AI channel: connected to " << options_.socketPath << std::endl;
+    return true;
+}
+
+// The reader thread owns closing: it sees the shutdown as end-of-stream
+void AIFrameChannel::disconnectLocked() {
+    if (socket_fd_ >= 0) ::shutdown(socket_fd_, SHUT_RDWR);
+}
+
+bool AIFrameChannel::ensureRingLocked(size_t frame_bytes) {
+    if (ring_ && frame_bytes <= slot_bytes_) return true;
+
+    if (shm_fd_ < 0) {
+        shm_fd_ = ::shm_open(options_.shmName.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0660);
+        if (shm_fd_ < 0) {
+            std::cerr << "AI channel: shm_open " << options_.shmName << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    if (ring_) {
+        ::munmap(ring_, ring_bytes_);
+        ring_ = nullptr;
+    }
+
+    const uint64_t slotBytes = align64(std::max<size_t>(frame_bytes, slot_bytes_));
+    const size_t total = RING_HEADER_BYTES + static_cast<size_t>(options_.slots) * (SLOT_HEADER_BYTES + slotBytes);
+    if (::ftruncate(shm_fd_, static_cast<off_t>(total)) != 0) {
+        std::cerr << "AI channel: cannot size " << options_.shmName << " to " << total << " bytes: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    void* mapped = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd_, 0);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "AI channel: mmap: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    ring_ = static_cast<uint8_t*>(mapped);
+    ring_bytes_ = total;
+    slot_bytes_ = slotBytes;
+    // Wall-clock generation, so a reader still mapping a previous run's ring notices too
+    generation_ = std::max<uint64_t>(generation_ + 1, static_cast<uint64_t>(nowMs()));
+
+    for (int slot = 0; slot < options_.slots; ++slot) {
+        std::memset(ring_ + RING_HEADER_BYTES + slot * (SLOT_HEADER_BYTES + slot_bytes_), 0, SLOT_HEADER_BYTES);
+    }
+    RingHeader* header = reinterpret_cast<RingHeader*>(ring_);
+    header->magic = RING_MAGIC;
+    header->version = RING_VERSION;
+    header->slot_count = static_cast<uint32_t>(options_.slots);
+    header->reserved = 0;
+    header->slot_bytes = slot_bytes_;
+    header->generation = generation_;
+    return true;
+}
+
+bool AIFrameChannel::submit(const cv::Mat& frame, const std::string& request_id, json request) {
+    if (frame.empty() || frame.depth() != CV_8U) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socket_fd_ < 0 && !connectLocked()) return false;
+
+    const size_t stride = frame.cols * frame.elemSize();
+    if (!ensureRingLocked(stride * frame.rows)) return false;
+
+    const uint32_t slot = next_slot_;
+    next_slot_ = (next_slot_ + 1) % static_cast<uint32_t>(options_.slots);
+    const size_t offset = RING_HEADER_BYTES + slot * (SLOT_HEADER_BYTES + slot_bytes_);
+    SlotHeader* header = reinterpret_cast<SlotHeader*>(ring_ + offset);
+    uint8_t* pixels = ring_ + offset + SLOT_HEADER_BYTES;
+
+    // Odd while writing; a reader holding the previous seq sees the slot change under it
+    const uint64_t writing = (__atomic_load_n(&header->seq, __ATOMIC_ACQUIRE) | 1) + 2;
+    __atomic_store_n(&header->seq, writing, __ATOMIC_RELEASE);
+    if (frame.isContinuous()) {
+        std::memcpy(pixels, frame.data, stride * frame.rows);
+    } else {
+        for (int y = 0; y < frame.rows; ++y) std::memcpy(pixels + y * stride, frame.ptr(y), stride);
+    }
+    header->frame_id = ++frame_id_;
+    header->width = static_cast<uint32_t>(frame.cols);
+    header->height = static_cast<uint32_t>(frame.rows);
+    header->channels = static_cast<uint32_t>(frame.channels());
+    header->stride = static_cast<uint32_t>(stride);
+    header->roi_x = roiValue(request, "x");
+    header->roi_y = roiValue(request, "y");
+    header->roi_width = roiValue(request, "width");
+    header->roi_height = roiValue(request, "height");
+    header->timestamp_ms = static_cast<uint64_t>(nowMs());
+    const uint64_t published = writing + 1;
+    __atomic_store_n(&header->seq, published, __ATOMIC_RELEASE);
+
+    request["type"] = "frame";
+    request["request_id"] = request_id;
+    request["shm"] = options_.shmName;
+    request["generation"] = generation_;
+    request["slot"] = slot;
+    request["offset"] = offset;
+    request["seq"] = published;
+    request["frame_id"] = frame_id_;
+    request["width"] = frame.cols;
+    request["height"] = frame.rows;
+    request["channels"] = frame.channels();
+    request["stride"] = stride;
+
+    {
+        // A result left over from an earlier request with the same id must not answer this one
+        std::lock_guard<std::mutex> resultsLock(results_mutex_);
+        results_.erase(request_id);
+    }
+    if (!sendAll(socket_fd_, request.dump() + "\n")) {
+        std::cerr << "AI channel: service went away, falling back to the file handoff" << std::endl;
+        disconnectLocked();
+        return false;
+    }
+    return true;
+}
+
+json AIFrameChannel::takeResult(const std::string& request_id) {
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    auto it = results_.find(request_id);
+    if (it == results_.end()) return json();
+    json result = std::move(it->second);
+    results_.erase(it);
+    return result;
+}
+
+void AIFrameChannel::readLoop() {
+    std::string pending;
+    char buffer[4096];
+    int fd = -1;
+    while (running_) {
+        if (fd < 0) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                fd = socket_fd_;
+            }
+            if (fd < 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            pending.clear();
+        }
+
+        pollfd pfd{fd, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0) continue;
+        const ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (socket_fd_ == fd) socket_fd_ = -1;
+            ::close(fd);
+            fd = -1;
+            std::cerr << "AI channel: disconnected from " << options_.socketPath << std::endl;
+            continue;
+        }
+        pending.append(buffer, static_cast<size_t>(n));
+
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos) {
+            json message = json::parse(pending.substr(0, newline), nullptr, false);
+            pending.erase(0, newline + 1);
+            if (message.is_discarded() || !message.is_object() || !message.contains("request_id")) continue;
+            const std::string id = message["request_id"].is_string() ? message["request_id"].get<std::string>() : message["request_id"].dump();
+
+            std::lock_guard<std::mutex> lock(results_mutex_);
+            results_[id] = std::move(message);
+            result_order_.push_back(id);
+            while (result_order_.size() > MAX_PENDING_RESULTS) {
+                results_.erase(result_order_.front());
+                result_order_.pop_front();
+            }
+        }
+    }
+}
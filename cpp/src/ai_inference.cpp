@@ -1,32 +1,278 @@
 #include "ai_inference.hpp"
+#include "stage_metrics.hpp"
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <numeric>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #ifdef HAVE_ONNXRUNTIME
 #include <onnxruntime_cxx_api.h>
 #endif
 
+// One resident model: its session, bindings and preallocated I/O
 struct AIInferenceEngine::ModelInstance {
 #ifdef HAVE_ONNXRUNTIME
     std::unique_ptr<Ort::Session> session;
-    std::unique_ptr<Ort::Env> env;
+    std::unique_ptr<Ort::IoBinding> binding;
     Ort::MemoryInfo memoryInfo{nullptr};
     ModelConfig config;
+    // Session::Run takes C strings; these point into config's name vectors
+    std::vector<const char*> inputNames;
+    std::vector<const char*> outputNames;
+
+    // Preallocated I/O. The input holds maxBatch images; outputs whose shape is
+    // fully known (up to the batch dimension) are bound to outputBuffers, the rest
+    // are left to ONNX Runtime's allocator.
+    int channels = 3;
+    int inputHeight = 0;
+    int inputWidth = 0;
+    int maxBatch = 1;
+    size_t imageSize = 0;
+    std::vector<float> inputBuffer;
+    std::vector<std::vector<int64_t>> outputShapes;     // Batch dimension as -1 when dynamic
+    std::vector<std::vector<float>> outputBuffers;
+    std::vector<Ort::Value> boundTensors;
+    int boundBatch = 0;
+
+    // Bilinear sampling tables reused across calls
+    std::vector<int> x0, x1;
+    std::vector<float> xWeight;
     
-    ModelInstance() : memoryInfo(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)) {
-        env = std::make_unique<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "PlantVisionAI");
-    }
+    ModelInstance() : memoryInfo(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)) {}
+
+    float* slot(int index) { return inputBuffer.data() + static_cast<size_t>(index) * imageSize; }
+    void fillSlot(const cv::Mat& image, const cv::Rect& roi, int index);
+    std::vector<Ort::Value> run(int batch);
 #endif
-    bool loaded = false;
     ModelType type = ModelType::NONE;
 };
 
-AIInferenceEngine::AIInferenceEngine() : impl_(std::make_unique<ModelInstance>()) {}
+#ifdef HAVE_ONNXRUNTIME
+namespace {
+
+
+GraphOptimizationLevel parseGraphOptimization(const std::string& level) {
+    if (level == "disabled") return GraphOptimizationLevel::ORT_DISABLE_ALL;
+    if (level == "basic") return GraphOptimizationLevel::ORT_ENABLE_BASIC;
+    if (level == "extended") return GraphOptimizationLevel::ORT_ENABLE_EXTENDED;
+    return GraphOptimizationLevel::ORT_ENABLE_ALL;
+}
+
+// Register the requested accelerators; ONNX Runtime falls back to CPU for unsupported nodes
+void appendExecutionProviders(Ort::SessionOptions& sessionOptions, const InferenceOptions& options) {
+    for (const auto& provider : options.executionProviders) {
+        try {
+            if (provider == "cuda") {
+                OrtCUDAProviderOptions cudaOptions;
+                cudaOptions.device_id = options.deviceId;
+                sessionOptions.AppendExecutionProvider_CUDA(cudaOptions);
+            } else if (provider == "tensorrt") {
+                OrtTensorRTProviderOptions tensorrtOptions{};
+                tensorrtOptions.device_id = options.deviceId;
+                tensorrtOptions.trt_max_workspace_size = 1 << 30;
+                tensorrtOptions.trt_max_partition_iterations = 1000;
+                tensorrtOptions.trt_min_subgraph_size = 1;
+                sessionOptions.AppendExecutionProvider_TensorRT(tensorrtOptions);
+            } else if (provider == "openvino") {
+                OrtOpenVINOProviderOptions openvinoOptions;
+                sessionOptions.AppendExecutionProvider_OpenVINO(openvinoOptions);
+            } else if (provider != "cpu") {
+                std::cerr << "Unknown execution provider '" << provider << "', ignored" << std::endl;
+                continue;
+            }
+            std::cout << "ONNX Runtime execution provider enabled: " << provider << std::endl;
+        } catch (const Ort::Exception& e) {
+            std::cerr << "Execution provider '" << provider << "' unavailable, skipping: " << e.what() << std::endl;
+        }
+    }
+}
+
+/**
+ * The process-wide environment shared by every session
+ *
+ * Created on first use with global intra/inter op thread pools, so N resident
+ * models run on one set of worker threads instead of N. Later InferenceOptions
+ * cannot resize the pools.
+ */
+Ort::Env& sharedEnvironment(const InferenceOptions& options) {
+    static std::once_flag once;
+    static std::unique_ptr<Ort::Env> env;
+    std::call_once(once, [&options]() {
+        const OrtApi& api = Ort::GetApi();
+        OrtThreadingOptions* threading = nullptr;
+        Ort::ThrowOnError(api.CreateThreadingOptions(&threading));
+        Ort::ThrowOnError(api.SetGlobalIntraOpNumThreads(threading, options.intraOpThreads));
+        Ort::ThrowOnError(api.SetGlobalInterOpNumThreads(threading, options.interOpThreads));
+        env = std::make_unique<Ort::Env>(threading, ORT_LOGGING_LEVEL_WARNING, "PlantVisionAI");
+        api.ReleaseThreadingOptions(threading);
+    });
+    return *env;
+}
+
+// Parse the model straight out of the page cache; the mapping is dropped once the session owns its graph
+std::unique_ptr<Ort::Session> createSession(Ort::Env& env, const std::string& path,
+                                            const Ort::SessionOptions& sessionOptions, bool memoryMap) {
+    if (memoryMap) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat info;
+        if (fd >= 0 && ::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (mapped != MAP_FAILED) {
+                ::madvise(mapped, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+                try {
+                    auto session = std::make_unique<Ort::Session>(env, mapped, static_cast<size_t>(info.st_size), sessionOptions);
+                    ::munmap(mapped, static_cast<size_t>(info.st_size));
+                    return session;
+                } catch (...) {
+                    ::munmap(mapped, static_cast<size_t>(info.st_size));
+                    throw;
+                }
+            }
+        } else if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    return std::make_unique<Ort::Session>(env, path.c_str(), sessionOptions);
+}
+
+size_t shapeElements(const std::vector<int64_t>& shape) {
+    return std::accumulate(shape.begin(), shape.end(), size_t{1},
+                           [](size_t total, int64_t dim) { return total * static_cast<size_t>(dim); });
+}
+
+/**
+ * Write roi of a BGR image into one planar RGB input slot
+ *
+ * Bilinear resize (half-pixel centres, as cv::INTER_LINEAR), channel swap,
+ * (v - mean) * scale and HWC to CHW happen in a single pass over the
+ * destination, with no intermediate Mats.
+ */
+void fillInputSlot(const cv::Mat& image, const cv::Rect& roi, const AIInferenceEngine::ModelConfig& config,
+                   int width, int height, std::vector<int>& x0, std::vector<int>& x1,
+                   std::vector<float>& xWeight, float* dst) {
+    const float mean = config.preprocessNormalization ? config.meanValue : 0.0f;
+    const float scale = config.preprocessNormalization ? config.scaleValue : 1.0f;
+    const float sx = static_cast<float>(roi.width) / width;
+    const float sy = static_cast<float>(roi.height) / height;
+
+    x0.resize(width);
+    x1.resize(width);
+    xWeight.resize(width);
+    for (int x = 0; x < width; ++x) {
+        float fx = std::min(std::max((x + 0.5f) * sx - 0.5f, 0.0f), static_cast<float>(roi.width - 1));
+        int ix = static_cast<int>(fx);
+        x0[x] = (roi.x + ix) * 3;
+        x1[x] = (roi.x + std::min(ix + 1, roi.width - 1)) * 3;
+        xWeight[x] = fx - ix;
+    }
+
+    const size_t plane = static_cast<size_t>(width) * height;
+    float* red = dst;
+    float* green = dst + plane;
+    float* blue = dst + 2 * plane;
+    for (int y = 0; y < height; ++y) {
+        float fy = std::min(std::max((y + 0.5f) * sy - 0.5f, 0.0f), static_cast<float>(roi.height - 1));
+        int iy = static_cast<int>(fy);
+        const float wy = fy - iy;
+        const uchar* top = image.ptr<uchar>(roi.y + iy);
+        const uchar* bottom = image.ptr<uchar>(roi.y + std::min(iy + 1, roi.height - 1));
+
+        for (int x = 0; x < width; ++x) {
+            const float wx = xWeight[x];
+            const uchar* a = top + x0[x];
+            const uchar* b = top + x1[x];
+            const uchar* c = bottom + x0[x];
+            const uchar* d = bottom + x1[x];
+            float value[3];
+            for (int k = 0; k < 3; ++k) {
+                const float upper = a[k] + (b[k] - a[k]) * wx;
+                const float lower = c[k] + (d[k] - c[k]) * wx;
+                value[k] = upper + (lower - upper) * wy;
+            }
+            blue[x] = (value[0] - mean) * scale;
+            green[x] = (value[1] - mean) * scale;
+            red[x] = (value[2] - mean) * scale;
+        }
+        red += width;
+        green += width;
+        blue += width;
+    }
+}
+
+} // namespace
+
+void AIInferenceEngine::ModelInstance::fillSlot(const cv::Mat& image, const cv::Rect& roi, int index) {
+    if (image.type() == CV_8UC3) {
+        fillInputSlot(image, roi, config, inputWidth, inputHeight, x0, x1, xWeight, slot(index));
+        return;
+    }
+    cv::Mat bgr;
+    cv::cvtColor(image(roi), bgr, image.channels() == 4 ? cv::COLOR_BGRA2BGR : cv::COLOR_GRAY2BGR);
+    fillInputSlot(bgr, cv::Rect(0, 0, bgr.cols, bgr.rows), config, inputWidth, inputHeight, x0, x1, xWeight, slot(index));
+}
+
+// Rebinding only happens when the batch size changes; the buffers themselves never move
+std::vector<Ort::Value> AIInferenceEngine::ModelInstance::run(int batch) {
+    if (batch != boundBatch) {
+        binding->ClearBoundInputs();
+        binding->ClearBoundOutputs();
+        boundTensors.clear();
+
+        std::vector<int64_t> shape = {batch, channels, inputHeight, inputWidth};
+        boundTensors.push_back(Ort::Value::CreateTensor<float>(
+            memoryInfo, inputBuffer.data(), static_cast<size_t>(batch) * imageSize, shape.data(), shape.size()));
+        binding->BindInput(inputNames[0], boundTensors.back());
+
+        for (size_t i = 0; i < outputNames.size(); ++i) {
+            std::vector<int64_t> outputShape = outputShapes[i];
+            if (!outputShape.empty() && outputShape[0] < 0) outputShape[0] = batch;
+            const bool known = std::all_of(outputShape.begin(), outputShape.end(), [](int64_t d) { return d > 0; });
+            if (known && shapeElements(outputShape) <= outputBuffers[i].size()) {
+                boundTensors.push_back(Ort::Value::CreateTensor<float>(
+                    memoryInfo, outputBuffers[i].data(), shapeElements(outputShape), outputShape.data(), outputShape.size()));
+                binding->BindOutput(outputNames[i], boundTensors.back());
+            } else {
+                binding->BindOutput(outputNames[i], memoryInfo);
+            }
+        }
+        boundBatch = batch;
+    }
+
+    session->Run(Ort::RunOptions{nullptr}, *binding);
+    return binding->GetOutputValues();
+}
+#endif
+
+AIInferenceEngine::AIInferenceEngine(const InferenceOptions& options)
+    : options_(options), modelManager_(options.modelsDir) {}
 
 AIInferenceEngine::~AIInferenceEngine() = default;
 
+std::string AIInferenceEngine::defaultModelName(ModelType type) {
+    switch (type) {
+        case ModelType::DEPTH_ESTIMATION: return AIModelManager::getMiDaSSmallModel().name;
+        case ModelType::PLANT_DETECTION: return AIModelManager::getPlantDetectionModel().name;
+        case ModelType::DISEASE_DETECTION: return "disease_classifier";
+        case ModelType::NONE: break;
+    }
+    return "";
+}
+
+AIInferenceEngine::ModelInstance* AIInferenceEngine::findModel(ModelType type) const {
+    auto it = models_.find(type);
+    return it == models_.end() ? nullptr : it->second.get();
+}
+
 bool AIInferenceEngine::isOnnxRuntimeAvailable() const {
 #ifdef HAVE_ONNXRUNTIME
     return true;
@@ -37,29 +283,85 @@ bool AIInferenceEngine::isOnnxRuntimeAvailable() const {
 
 bool AIInferenceEngine::loadModel(ModelType type, const ModelConfig& config) {
 #ifdef HAVE_ONNXRUNTIME
+    const std::string modelPath = config.modelPath.empty() ? modelManager_.getModelPath(defaultModelName(type))
+                                                           : config.modelPath;
     try {
-        if (!std::filesystem::exists(config.modelPath)) {
-            lastError_ = "Model file not found: " + config.modelPath;
+        if (!std::filesystem::exists(modelPath)) {
+            lastError_ = "Model file not found: " + modelPath;
             return false;
         }
 
-        // Create session options
+        // Sessions run on the shared environment's thread pools
         Ort::SessionOptions sessionOptions;
-        sessionOptions.SetIntraOpNumThreads(1);
-        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
+        sessionOptions.DisablePerSessionThreads();
+        sessionOptions.SetGraphOptimizationLevel(parseGraphOptimization(options_.graphOptimization));
+        appendExecutionProviders(sessionOptions, options_);
+
+        // Built on the side, so a failed load leaves the resident model of this type untouched
+        auto model = std::make_unique<ModelInstance>();
+        model->session = createSession(sharedEnvironment(options_), modelPath, sessionOptions, options_.memoryMapModels);
+        model->config = config;
+        model->config.modelPath = modelPath;
+        model->type = type;
+
+        // Names not given by the caller are read from the graph
+        Ort::AllocatorWithDefaultOptions allocator;
+        if (model->config.inputNames.empty()) {
+            for (size_t i = 0; i < model->session->GetInputCount(); ++i) {
+                model->config.inputNames.emplace_back(model->session->GetInputNameAllocated(i, allocator).get());
+            }
+        }
+        if (model->config.outputNames.empty()) {
+            for (size_t i = 0; i < model->session->GetOutputCount(); ++i) {
+                model->config.outputNames.emplace_back(model->session->GetOutputNameAllocated(i, allocator).get());
+            }
+        }
+        for (const auto& name : model->config.inputNames) model->inputNames.push_back(name.c_str());
+        for (const auto& name : model->config.outputNames) model->outputNames.push_back(name.c_str());
+
+        // NCHW input: spatial size from the config when given, batch limit from the graph
+        std::vector<int64_t> graphShape = model->session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        const std::vector<int64_t>& shape = model->config.inputShape.size() == 4 ? model->config.inputShape : graphShape;
+        if (shape.size() != 4 || shape[1] != 3 || shape[2] <= 0 || shape[3] <= 0) {
+            lastError_ = "Unsupported model input shape (expected [N, 3, H, W]): " + modelPath;
+            return false;
+        }
+        model->channels = static_cast<int>(shape[1]);
+        model->inputHeight = static_cast<int>(shape[2]);
+        model->inputWidth = static_cast<int>(shape[3]);
+        model->maxBatch = (graphShape.empty() || graphShape[0] <= 0) ? std::max(1, model->config.maxBatchSize)
+                                                                       : static_cast<int>(graphShape[0]);
+        model->imageSize = static_cast<size_t>(model->channels) * model->inputHeight * model->inputWidth;
+        model->inputBuffer.assign(model->imageSize * model->maxBatch, 0.0f);
+
+        for (size_t i = 0; i < model->outputNames.size(); ++i) {
+            std::vector<int64_t> outputShape = model->session->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+            std::vector<int64_t> fullBatch = outputShape;
+            if (!fullBatch.empty() && fullBatch[0] < 0) fullBatch[0] = model->maxBatch;
+            const bool known = std::all_of(fullBatch.begin(), fullBatch.end(), [](int64_t d) { return d > 0; });
+            model->outputBuffers.emplace_back(known ? shapeElements(fullBatch) : 0, 0.0f);
+            model->outputShapes.push_back(std::move(outputShape));
+        }
+        model->binding = std::make_unique<Ort::IoBinding>(*model->session);
+
+        // Warm-up at the batch sizes used later pays graph optimisation and kernel selection now
+        const auto warmupStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < options_.warmupRuns; ++i) {
+            model->run(1);
+            if (model->maxBatch > 1) {
+                model->run(model->maxBatch);
+            }
+        }
+        const double warmupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - warmupStart).count();
 
-        // Load model
-        impl_->session = std::make_unique<Ort::Session>(*impl_->env, config.modelPath.c_str(), sessionOptions);
-        impl_->config = config;
-        impl_->type = type;
-        impl_->loaded = true;
+        models_[type] = std::move(model);
 
-        std::cout << "Loaded ONNX model: " << config.modelPath << std::endl;
+        std::cout << "Loaded ONNX model: " << modelPath << " (batch up to " << models_[type]->maxBatch
+                  << ", warm-up " << warmupMs << " ms)" << std::endl;
         return true;
     }
     catch (const std::exception& e) {
         lastError_ = "Failed to load ONNX model: " + std::string(e.what());
-        impl_->loaded = false;
         return false;
     }
 #else
@@ -69,78 +371,49 @@ bool AIInferenceEngine::loadModel(ModelType type, const ModelConfig& config) {
 }
 
 bool AIInferenceEngine::isModelLoaded(ModelType type) const {
-    return impl_->loaded && impl_->type == type;
+    return findModel(type) != nullptr;
 }
 
 void AIInferenceEngine::unloadModel(ModelType type) {
-#ifdef HAVE_ONNXRUNTIME
-    if (impl_->type == type) {
-        impl_->session.reset();
-        impl_->loaded = false;
-        impl_->type = ModelType::NONE;
-    }
-#endif
+    models_.erase(type);
 }
 
 AIInferenceEngine::DepthResult AIInferenceEngine::runDepthInference(const cv::Mat& image) {
+    STAGE_TIMER("ai_depth");
     DepthResult result;
     
 #ifdef HAVE_ONNXRUNTIME
-    if (!impl_->loaded || impl_->type != ModelType::DEPTH_ESTIMATION) {
+    ModelInstance* model = findModel(ModelType::DEPTH_ESTIMATION);
+    if (!model) {
         lastError_ = "Depth estimation model not loaded";
         return result;
     }
+    if (image.empty()) {
+        lastError_ = "Empty image";
+        return result;
+    }
 
     try {
-        // Preprocess image
-        cv::Mat processedImage = preprocessImage(image, impl_->config);
-        
-        // Convert to float vector
-        std::vector<float> inputData = matToVector(processedImage);
+        model->fillSlot(image, cv::Rect(0, 0, image.cols, image.rows), 0);
+        std::vector<Ort::Value> outputs = model->run(1);
         
-        // Create input tensor
-        std::vector<int64_t> inputShape = impl_->config.inputShape;
-        Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
-            impl_->memoryInfo, 
-            inputData.data(), 
-            inputData.size(), 
-            inputShape.data(), 
-            inputShape.size()
-        );
-        
-        // Run inference
-        auto outputTensors = impl_->session->Run(
-            Ort::RunOptions{nullptr},
-            impl_->config.inputNames.data(),
-            &inputTensor,
-            1,
-            impl_->config.outputNames.data(),
-            impl_->config.outputNames.size()
-        );
-        
-        // Extract output
-        if (!outputTensors.empty() && outputTensors[0].IsTensor()) {
-            auto& outputTensor = outputTensors[0];
-            auto tensorInfo = outputTensor.GetTensorTypeAndShapeInfo();
-            auto shape = tensorInfo.GetShape();
-            
-            float* rawOutput = outputTensor.GetTensorMutableData<float>();
-            size_t outputSize = outputTensor.GetTensorTypeAndShapeInfo().GetElementCount();
-            
-            // Convert back to cv::Mat
+        if (!outputs.empty() && outputs[0].IsTensor()) {
+            auto shape = outputs[0].GetTensorTypeAndShapeInfo().GetShape();
             int height = shape.size() >= 2 ? static_cast<int>(shape[shape.size()-2]) : image.rows;
             int width = shape.size() >= 1 ? static_cast<int>(shape[shape.size()-1]) : image.cols;
-            
-            std::vector<float> depthVec(rawOutput, rawOutput + outputSize);
-            result.depthMap = vectorToMat(depthVec, height, width);
-            
-            // Resize to original image size if needed
-            if (result.depthMap.size() != image.size()) {
-                cv::resize(result.depthMap, result.depthMap, image.size(), 0, 0, cv::INTER_CUBIC);
+
+            // Wrap the output tensor and resize straight out of it
+            cv::Mat depth(height, width, CV_32F, const_cast<float*>(outputs[0].GetTensorData<float>()));
+            if (depth.size() != image.size()) {
+                cv::resize(depth, result.depthMap, image.size(), 0, 0, cv::INTER_LINEAR);
+            } else {
+                depth.copyTo(result.depthMap);
             }
             
-            // Calculate min/max depth
-            cv::minMaxLoc(result.depthMap, (double*)&result.minDepth, (double*)&result.maxDepth);
+            double minDepth = 0.0, maxDepth = 0.0;
+            cv::minMaxLoc(result.depthMap, &minDepth, &maxDepth);
+            result.minDepth = static_cast<float>(minDepth);
+            result.maxDepth = static_cast<float>(maxDepth);
             result.success = true;
         }
         
@@ -164,52 +437,163 @@ AIInferenceEngine::DepthResult AIInferenceEngine::runDepthInference(const cv::Ma
     return result;
 }
 
-std::vector<cv::Rect> AIInferenceEngine::runPlantDetection(const cv::Mat& image) {
-    std::vector<cv::Rect> detections;
-    
-    // TODO: Implement plant detection model inference
-    // For now, fall back to traditional OpenCV methods in the main processing pipeline
-    
-    return detections;
-}
+std::vector<AIInferenceEngine::Detection> AIInferenceEngine::runDetection(const cv::Mat& image) {
+    STAGE_TIMER("ai_detection");
+    std::vector<Detection> detections;
 
-cv::Mat AIInferenceEngine::preprocessImage(const cv::Mat& input, const ModelConfig& config) {
-    cv::Mat processed;
-    
-    // Resize to model input size
-    if (config.inputShape.size() >= 3) {
-        int height = static_cast<int>(config.inputShape[config.inputShape.size()-2]);
-        int width = static_cast<int>(config.inputShape[config.inputShape.size()-1]);
-        cv::resize(input, processed, cv::Size(width, height));
-    } else {
-        processed = input.clone();
+#ifdef HAVE_ONNXRUNTIME
+    ModelInstance* model = findModel(ModelType::PLANT_DETECTION);
+    if (!model) {
+        lastError_ = "Plant detection model not loaded";
+        return detections;
     }
-    
-    // Convert to RGB if needed (ONNX models typically expect RGB)
-    if (processed.channels() == 3) {
-        cv::cvtColor(processed, processed, cv::COLOR_BGR2RGB);
+    if (image.empty()) {
+        lastError_ = "Empty image";
+        return detections;
     }
-    
-    // Normalize
-    if (config.preprocessNormalization) {
-        processed.convertTo(processed, CV_32F);
-        processed = (processed - config.meanValue) * config.scaleValue;
+
+    try {
+        const ModelConfig& config = model->config;
+        model->fillSlot(image, cv::Rect(0, 0, image.cols, image.rows), 0);
+        std::vector<Ort::Value> outputs = model->run(1);
+        if (outputs.empty() || !outputs[0].IsTensor()) {
+            return detections;
+        }
+
+        // [1, N, 5 + classes]: cx, cy, w, h in input pixels, objectness, per-class scores
+        auto shape = outputs[0].GetTensorTypeAndShapeInfo().GetShape();
+        if (shape.size() < 2 || shape.back() < 6) {
+            lastError_ = "Unexpected detection output shape";
+            return detections;
+        }
+        const int64_t stride = shape.back();
+        const int64_t rows = static_cast<int64_t>(outputs[0].GetTensorTypeAndShapeInfo().GetElementCount()) / stride;
+        const float* output = outputs[0].GetTensorData<float>();
+
+        const float sx = static_cast<float>(image.cols) / static_cast<float>(model->inputWidth);
+        const float sy = static_cast<float>(image.rows) / static_cast<float>(model->inputHeight);
+        const cv::Rect frameRect(0, 0, image.cols, image.rows);
+
+        std::vector<Detection> candidates;
+        for (int64_t r = 0; r < rows; ++r) {
+            const float* row = output + r * stride;
+            const float objectness = row[4];
+            if (objectness < config.scoreThreshold) continue;
+
+            const float* classScores = row + 5;
+            const int classId = static_cast<int>(std::max_element(classScores, row + stride) - classScores);
+            const float score = objectness * classScores[classId];
+            if (score < config.scoreThreshold) continue;
+            if (!config.classFilter.empty() &&
+                std::find(config.classFilter.begin(), config.classFilter.end(), classId) == config.classFilter.end()) {
+                continue;
+            }
+
+            Detection detection;
+            detection.box = cv::Rect(cv::Point(cvRound((row[0] - row[2] * 0.5f) * sx), cvRound((row[1] - row[3] * 0.5f) * sy)),
+                                     cv::Point(cvRound((row[0] + row[2] * 0.5f) * sx), cvRound((row[1] + row[3] * 0.5f) * sy))) & frameRect;
+            detection.score = score;
+            detection.classId = classId;
+            if (detection.box.area() > 0) {
+                candidates.push_back(detection);
+            }
+        }
+
+        // Greedy non-maximum suppression, highest score first
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Detection& a, const Detection& b) { return a.score > b.score; });
+        for (const auto& candidate : candidates) {
+            bool suppressed = false;
+            for (const auto& kept : detections) {
+                const double overlap = (candidate.box & kept.box).area();
+                if (overlap / (candidate.box.area() + kept.box.area() - overlap) > config.nmsThreshold) {
+                    suppressed = true;
+                    break;
+                }
+            }
+            if (!suppressed) detections.push_back(candidate);
+        }
+    } catch (const std::exception& e) {
+        lastError_ = "Detection inference failed: " + std::string(e.what());
+        detections.clear();
     }
-    
-    return processed;
+#else
+    lastError_ = "ONNX Runtime not available - plant detection uses the OpenCV pipeline";
+#endif
+
+    return detections;
 }
 
-std::vector<float> AIInferenceEngine::matToVector(const cv::Mat& mat) {
-    cv::Mat flatMat = mat.reshape(1, 1);
-    std::vector<float> vec;
-    flatMat.copyTo(vec);
-    return vec;
+std::vector<cv::Rect> AIInferenceEngine::runPlantDetection(const cv::Mat& image) {
+    std::vector<cv::Rect> boxes;
+    for (const auto& detection : runDetection(image)) {
+        boxes.push_back(detection.box);
+    }
+    return boxes;
 }
 
-cv::Mat AIInferenceEngine::vectorToMat(const std::vector<float>& vec, int height, int width) {
-    cv::Mat mat(height, width, CV_32F);
-    std::memcpy(mat.data, vec.data(), vec.size() * sizeof(float));
-    return mat;
+std::vector<AIInferenceEngine::Classification> AIInferenceEngine::runClassification(const cv::Mat& image,
+                                                                                    const std::vector<cv::Rect>& rois) {
+    STAGE_TIMER("ai_classification");
+    std::vector<Classification> results(rois.size());
+
+#ifdef HAVE_ONNXRUNTIME
+    ModelInstance* instance = findModel(ModelType::DISEASE_DETECTION);
+    if (!instance) {
+        lastError_ = "Disease classification model not loaded";
+        return results;
+    }
+
+    try {
+        ModelInstance& model = *instance;
+        const cv::Rect frameRect(0, 0, image.cols, image.rows);
+
+        // Pack valid ROIs into batches; an empty ROI keeps its default (classId -1) result
+        std::vector<size_t> pending;
+        pending.reserve(std::min<size_t>(rois.size(), model.maxBatch));
+        size_t next = 0;
+        while (next < rois.size()) {
+            pending.clear();
+            for (; next < rois.size() && static_cast<int>(pending.size()) < model.maxBatch; ++next) {
+                const cv::Rect roi = rois[next] & frameRect;
+                if (roi.area() <= 0) continue;
+                model.fillSlot(image, roi, static_cast<int>(pending.size()));
+                pending.push_back(next);
+            }
+            if (pending.empty()) break;
+
+            std::vector<Ort::Value> outputs = model.run(static_cast<int>(pending.size()));
+            if (outputs.empty() || !outputs[0].IsTensor()) break;
+            auto shape = outputs[0].GetTensorTypeAndShapeInfo().GetShape();
+            const int64_t classes = shape.empty() ? 0 : shape.back();
+            if (classes <= 0) break;
+            const float* scores = outputs[0].GetTensorData<float>();
+
+            for (size_t k = 0; k < pending.size(); ++k) {
+                const float* row = scores + k * classes;
+                const int best = static_cast<int>(std::max_element(row, row + classes) - row);
+                float score = row[best];
+                if (model.config.applySoftmax) {
+                    float sum = 0.0f;
+                    for (int64_t c = 0; c < classes; ++c) sum += std::exp(row[c] - row[best]);
+                    score = 1.0f / sum;
+                }
+                Classification& result = results[pending[k]];
+                result.classId = best;
+                result.score = score;
+                if (best < static_cast<int>(model.config.classLabels.size())) {
+                    result.label = model.config.classLabels[best];
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        lastError_ = "Classification inference failed: " + std::string(e.what());
+    }
+#else
+    lastError_ = "ONNX Runtime not available - disease classification skipped";
+#endif
+
+    return results;
 }
 
 void AIInferenceEngine::setPythonFallback(std::function<void(const std::string&, const std::string&)> callback) {
@@ -217,7 +601,7 @@ void AIInferenceEngine::setPythonFallback(std::function<void(const std::string&,
 }
 
 bool AIInferenceEngine::usePythonFallback() const {
-    return !isOnnxRuntimeAvailable() || !impl_->loaded;
+    return !isOnnxRuntimeAvailable() || models_.empty();
 }
 
 std::string AIInferenceEngine::getLastError() const {
@@ -226,7 +610,8 @@ std::string AIInferenceEngine::getLastError() const {
 
 // AIModelManager implementation
 AIModelManager::AIModelManager(const std::string& modelsDir) : modelsDir_(modelsDir) {
-    std::filesystem::create_directories(modelsDir_);
+    std::error_code ec;
+    std::filesystem::create_directories(modelsDir_, ec);
 }
 
 AIModelManager::ModelInfo AIModelManager::getMiDaSSmallModel() {
@@ -0,0 +1,237 @@
+#include "batch_runner.hpp"
+#include "stage_metrics.hpp"
+
+#include <glob.h>
+#include <sys/stat.h>
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace {
+
+bool isImagePath(const std::string& path) {
+    std::string ext = fs::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".tif" || ext == ".tiff" || ext == ".webp";
+}
+
+int reducedReadFlag(int decodeScale) {
+    switch (decodeScale) {
+        case 2: return cv::IMREAD_REDUCED_COLOR_2;
+        case 4: return cv::IMREAD_REDUCED_COLOR_4;
+        case 8: return cv::IMREAD_REDUCED_COLOR_8;
+        default: return cv::IMREAD_COLOR;
+    }
+}
+
+// Paths already recorded in a previous run; cuts off a line torn by an interrupted write
+std::unordered_set<std::string> recordedInputs(const std::string& output) {
+    std::unordered_set<std::string> done;
+    std::ifstream in(output, std::ios::binary);
+    if (!in) return done;
+
+    // Streamed line by line: a night's output is far too large to slurp
+    std::string line;
+    std::uintmax_t complete = 0;
+    while (std::getline(in, line)) {
+        if (in.eof()) break;    // no trailing newline: the write was interrupted
+        complete += line.size() + 1;
+        json record = json::parse(line, nullptr, false);
+        // Failed records are retried: an image still being copied in reads as unreadable once
+        if (!record.is_discarded() && record.contains("file") && record["file"].is_string() && !record.contains("error")) {
+            done.insert(record["file"].get<std::string>());
+        }
+    }
+    in.close();
+
+    std::error_code ec;
+    if (fs::file_size(output, ec) > complete && !ec) {
+        fs::resize_file(output, complete, ec);
+        if (ec) {
+            std::cerr << "Batch: cannot trim partial record from " << output << ": " << ec.message() << std::endl;
+        }
+    }
+    return done;
+}
+
+int64_t fileMtimeMs(const std::string& path) {
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0) return 0;
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+}
+
+json instanceRecord(const PlantInstance& instance, size_t index, int decodeScale) {
+    const auto& bb = instance.boundingBox;
+    // Boxes are reported in the coordinates of the full-size archive image
+    return {
+        {"id", static_cast<int>(index)},
+        {"type", instance.type == PlantType::SPROUT ? "sprout" : "plant"},
+        {"classification", instance.classification},
+        {"bbox", {bb.x * decodeScale, bb.y * decodeScale, bb.width * decodeScale, bb.height * decodeScale}},
+        {"area_cm2", instance.areaCm2},
+        {"height_cm", instance.heightCm},
+        {"width_cm", instance.widthCm},
+        {"leaf_count", instance.leafCount},
+        {"health_score", instance.healthScore},
+        {"growth_stage", static_cast<int>(instance.stage)},
+        {"brown_spots", instance.brownSpotCount},
+        {"yellow_areas", instance.yellowAreaCount},
+        {"solidity", instance.solidity},
+        {"circularity", instance.circularity}
+    };
+}
+
+} // namespace
+
+std::vector<std::string> listBatchInputs(const std::string& input) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    if (fs::is_directory(input, ec)) {
+        for (fs::recursive_directory_iterator it(input, fs::directory_options::skip_permission_denied, ec), end;
+             it != end; it.increment(ec)) {
+            if (ec) break;
+            if (it->is_regular_file(ec) && isImagePath(it->path().string())) {
+                paths.push_back(it->path().string());
+            }
+        }
+    } else {
+        glob_t matches{};
+        if (::glob(input.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                const std::string path = matches.gl_pathv[i];
+                if (isImagePath(path) && fs::is_regular_file(path, ec)) paths.push_back(path);
+            }
+        }
+        ::globfree(&matches);
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+BatchSummary runBatch(const BatchOptions& options, const std::function<void(const std::string& record)>& onRecord) {
+    const auto started = std::chrono::steady_clock::now();
+    BatchSummary summary;
+
+    std::vector<std::string> inputs = listBatchInputs(options.input);
+    summary.discovered = inputs.size();
+    if (options.resume) {
+        const std::unordered_set<std::string> done = recordedInputs(options.output);
+        inputs.erase(std::remove_if(inputs.begin(), inputs.end(),
+                                    [&](const std::string& path) { return done.count(path) > 0; }),
+                     inputs.end());
+        summary.skipped = summary.discovered - inputs.size();
+    }
+    std::cout << "Batch: " << summary.discovered << " images in " << options.input
+              << ", " << summary.skipped << " already done, " << inputs.size() << " to process" << std::endl;
+    if (inputs.empty()) return summary;
+
+    if (!options.output.empty()) {
+        std::error_code ec;
+        const fs::path parent = fs::path(options.output).parent_path();
+        if (!parent.empty()) fs::create_directories(parent, ec);
+    }
+    std::ofstream out;
+    if (!options.output.empty()) {
+        out.open(options.output, options.resume ? std::ios::app : std::ios::trunc);
+        if (!out) {
+            std::cerr << "Batch: cannot open " << options.output << " for writing" << std::endl;
+            return summary;
+        }
+    }
+
+    const int decodeScale = (options.decodeScale == 2 || options.decodeScale == 4 || options.decodeScale == 8) ? options.decodeScale : 1;
+    const int readFlag = reducedReadFlag(decodeScale);
+    const double scalePxPerCm = options.scalePxPerCm / decodeScale;
+
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    const size_t workers = std::min(inputs.size(), static_cast<size_t>(options.threads > 0 ? options.threads : static_cast<int>(hardware)));
+
+    // Frames are the unit of parallelism; nested pools inside each frame would only oversubscribe
+    AnalysisOptions analysisOptions = options.analysis;
+    analysisOptions.workerThreads = 1;
+    analysisOptions.tracker = nullptr;      // frames of an archive are not a sequence the tracker can follow
+    const int previousCvThreads = cv::getNumThreads();
+    if (workers > 1) cv::setNumThreads(1);
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> processed{0};
+    std::atomic<size_t> failed{0};
+    std::mutex outputMutex;
+
+    auto worker = [&]() {
+        for (size_t index = next.fetch_add(1); index < inputs.size(); index = next.fetch_add(1)) {
+            const std::string& path = inputs[index];
+            json record = {{"file", path}, {"file_mtime_ms", fileMtimeMs(path)}};
+
+            cv::Mat frame;
+            {
+                STAGE_TIMER("batch_decode");
+                frame = cv::imread(path, readFlag);
+            }
+            if (frame.empty()) {
+                record["error"] = "unreadable image";
+                failed.fetch_add(1);
+            } else {
+                FrameContext context(frame);
+                PlantAnalysisResult result = analyzePlants(context, options.thresholdValue, scalePxPerCm, analysisOptions);
+                json instances = json::array();
+                for (size_t i = 0; i < result.instances.size(); ++i) {
+                    instances.push_back(instanceRecord(result.instances[i], i, decodeScale));
+                }
+                record["width"] = frame.cols * decodeScale;
+                record["height"] = frame.rows * decodeScale;
+                record["decode_scale"] = decodeScale;
+                record["total_instances"] = result.totalInstanceCount;
+                record["sprout_count"] = result.sproutCount;
+                record["plant_count"] = result.plantCount;
+                record["total_area_cm2"] = result.totalAreaCm2;
+                record["average_health"] = result.averageHealth;
+                record["processing_ms"] = result.processingTimeMs;
+                record["instances"] = std::move(instances);
+            }
+
+            const std::string line = record.dump();
+            {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                if (out.is_open()) {
+                    out << line << '\n';
+                    out.flush();
+                }
+            }
+            if (onRecord) onRecord(line);
+
+            const size_t done = processed.fetch_add(1) + 1;
+            if (options.progressEvery > 0 && done % options.progressEvery == 0) {
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+                const double rate = seconds > 0.0 ? static_cast<double>(done) / seconds : 0.0;
+                std::cout << "Batch: " << done << "/" << inputs.size() << " frames, " << rate << " frames/s, ETA "
+                          << (rate > 0.0 ? static_cast<double>(inputs.size() - done) / rate : 0.0) << " s" << std::endl;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) pool.emplace_back(worker);
+    for (auto& thread : pool) thread.join();
+    cv::setNumThreads(previousCvThreads);
+
+    summary.processed = processed.load();
+    summary.failed = failed.load();
+    summary.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "Batch: processed " << summary.processed << " images (" << summary.failed << " unreadable) in "
+              << summary.elapsedMs / 1000.0 << " s using " << workers << " workers" << std::endl;
+    return summary;
+}
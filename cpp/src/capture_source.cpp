@@ -0,0 +1,169 @@
+#include "capture_source.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+std::string lower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return std::tolower(c); });
+    return value;
+}
+
+bool exists(const char* path) {
+    std::error_code ec;
+    return std::filesystem::exists(path, ec);
+}
+
+// Newest-frame-only sink: no clock sync, one buffer, older buffers dropped
+const char* APPSINK = "appsink drop=true max-buffers=1 sync=false";
+
+std::string rawCaps(const CaptureOptions& options, const std::string& media) {
+    std::ostringstream caps;
+    caps << media;
+    if (options.width > 0 && options.height > 0) caps << ",width=" << options.width << ",height=" << options.height;
+    if (options.fps > 0) caps << ",framerate=" << options.fps << "/1";
+    return caps.str();
+}
+
+// Decoder, and any converter it needs, that ends in system-memory video for videoconvert
+std::string streamDecoder(const std::string& decoder, bool h265) {
+    if (decoder == "nvdec") return "nvv4l2decoder ! nvvidconv ! video/x-raw,format=BGRx";
+    if (decoder == "v4l2m2m") return h265 ? "v4l2slh265dec" : "v4l2h264dec";
+    if (decoder == "vaapi") return h265 ? "vaapih265dec" : "vaapih264dec";
+    return h265 ? "avdec_h265" : "avdec_h264";
+}
+
+std::string jpegDecoder(const std::string& decoder) {
+    if (decoder == "nvdec") return "nvv4l2decoder mjpeg=1 ! nvvidconv ! video/x-raw,format=BGRx";
+    if (decoder == "v4l2m2m") return "v4l2jpegdec";
+    if (decoder == "vaapi") return "vaapijpegdec";
+    return "jpegdec";
+}
+
+int accelerationFlag(const std::string& name) {
+    const std::string value = lower(name);
+    if (value == "any" || value == "auto") return cv::VIDEO_ACCELERATION_ANY;
+    if (value == "vaapi") return cv::VIDEO_ACCELERATION_VAAPI;
+    if (value == "d3d11") return cv::VIDEO_ACCELERATION_D3D11;
+    if (value == "mfx") return cv::VIDEO_ACCELERATION_MFX;
+    return cv::VIDEO_ACCELERATION_NONE;
+}
+
+int apiPreference(const std::string& backend) {
+    const std::string value = lower(backend);
+    if (value == "ffmpeg") return cv::CAP_FFMPEG;
+    if (value == "v4l2") return cv::CAP_V4L2;
+    if (value == "gstreamer") return cv::CAP_GSTREAMER;
+    return cv::CAP_ANY;
+}
+
+bool isNetworkUrl(const std::string& url) {
+    return url.rfind("rtsp://", 0) == 0 || url.rfind("rtsps://", 0) == 0;
+}
+
+// Format, size and rate are requested after opening; FOURCC first, V4L2 needs it before the size
+void applyFormat(cv::VideoCapture& capture, const CaptureOptions& options) {
+    if (options.fourcc.size() == 4) {
+        const std::string f = options.fourcc;
+        capture.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc(f[0], f[1], f[2], f[3]));
+    }
+    if (options.width > 0 && options.height > 0) {
+        capture.set(cv::CAP_PROP_FRAME_WIDTH, options.width);
+        capture.set(cv::CAP_PROP_FRAME_HEIGHT, options.height);
+    }
+    if (options.fps > 0) {
+        capture.set(cv::CAP_PROP_FPS, options.fps);
+    }
+    // Not every backend honours this; the grabber's continuous read drains regardless
+    capture.set(cv::CAP_PROP_BUFFERSIZE, 1);
+}
+
+} // namespace
+
+std::string detectHardwareDecoder() {
+    if (exists("/etc/nv_tegra_release") || exists("/dev/nvhost-nvdec")) return "nvdec";
+    // bcm2835-codec registers its stateful decoder at /dev/video10; the Pi 5 HEVC block lives under /dev/media*
+    if (exists("/dev/video10") || exists("/dev/video19")) return "v4l2m2m";
+    if (exists("/dev/dri/renderD128")) return "vaapi";
+    return "none";
+}
+
+std::string buildCapturePipeline(int device_id, const std::string& url, const CaptureOptions& options) {
+    if (!options.pipeline.empty()) return options.pipeline;
+
+    std::string decoder = lower(options.hw_decoder);
+    if (decoder == "auto") decoder = detectHardwareDecoder();
+    const bool wantGstreamer = lower(options.backend) == "gstreamer" || (!decoder.empty() && decoder != "none");
+    if (!wantGstreamer) return "";
+
+    const bool h265 = lower(options.codec) == "h265" || lower(options.codec) == "hevc";
+    std::ostringstream pipeline;
+    if (url.empty()) {
+        // Local camera: ask for MJPEG where possible, the USB link carries several times the frames
+        pipeline << "v4l2src device=/dev/video" << device_id << " ! ";
+        const std::string fourcc = lower(options.fourcc);
+        if (fourcc.empty() || fourcc == "mjpg") {
+            pipeline << rawCaps(options, "image/jpeg") << " ! " << jpegDecoder(decoder);
+        } else if (fourcc == "yuyv") {
+            pipeline << rawCaps(options, "video/x-raw,format=YUY2");
+        } else {
+            pipeline << rawCaps(options, "video/x-raw");
+        }
+    } else if (isNetworkUrl(url)) {
+        pipeline << "rtspsrc location=\"" << url << "\" latency=" << std::max(0, options.latency_ms)
+                 << " ! " << (h265 ? "rtph265depay ! h265parse" : "rtph264depay ! h264parse")
+                 << " ! " << streamDecoder(decoder, h265);
+    } else {
+        // HTTP, files and anything else: let decodebin pick, which prefers hardware decoders when installed
+        pipeline << "uridecodebin uri=\"" << url << "\"";
+    }
+    pipeline << " ! videoconvert ! video/x-raw,format=BGR ! " << APPSINK;
+    return pipeline.str();
+}
+
+void configureCaptureEnvironment() {
+    // Software RTSP decode: skip FFmpeg's input buffering unless the operator set their own options
+    ::setenv("OPENCV_FFMPEG_CAPTURE_OPTIONS", "rtsp_transport;tcp|fflags;nobuffer|flags;low_delay", 0);
+}
+
+bool openCapture(cv::VideoCapture& capture, int device_id, const std::string& url, const CaptureOptions& options) {
+    capture.release();
+
+    const std::string pipeline = buildCapturePipeline(device_id, url, options);
+    if (!pipeline.empty()) {
+        if (capture.open(pipeline, cv::CAP_GSTREAMER)) {
+            std::cout << "Capture: GStreamer pipeline " << pipeline << std::endl;
+            return true;
+        }
+        std::cerr << "Capture: GStreamer pipeline failed to open, falling back to the default backend: "
+                  << pipeline << std::endl;
+    }
+
+    const int api = pipeline.empty() ? apiPreference(options.backend) : cv::CAP_ANY;
+    std::vector<int> params;
+    const int acceleration = accelerationFlag(options.hw_acceleration);
+    if (acceleration != cv::VIDEO_ACCELERATION_NONE) {
+        params = {cv::CAP_PROP_HW_ACCELERATION, acceleration};
+    }
+
+    bool opened = url.empty() ? capture.open(device_id, api, params) : capture.open(url, api, params);
+    if (!opened && !params.empty()) {
+        std::cerr << "Capture: hardware acceleration '" << options.hw_acceleration << "' unavailable, opening without" << std::endl;
+        opened = url.empty() ? capture.open(device_id, api) : capture.open(url, api);
+    }
+    if (!opened) return false;
+
+    applyFormat(capture, options);
+    std::cout << "Capture: " << capture.getBackendName() << " backend";
+    if (!params.empty()) {
+        std::cout << ", hw acceleration " << capture.get(cv::CAP_PROP_HW_ACCELERATION);
+    }
+    std::cout << std::endl;
+    return true;
+}
@@ -4,12 +4,34 @@
 #include <fstream>
 #include <cmath>
 #include <algorithm>
+#include <numeric>
 
 using json = nlohmann::json;
 
+namespace {
+
+// Hellinger distance of two normalised histograms; a plant without coloured pixels compares as unchanged
+double hellingerDistance(const float* a, const float* b) {
+    float coefficient = 0.0f, massA = 0.0f, massB = 0.0f;
+    for (int i = 0; i < PLANT_HISTOGRAM_BINS; ++i) {
+        coefficient += std::sqrt(a[i] * b[i]);
+        massA += a[i];
+        massB += b[i];
+    }
+    if (massA <= 0.0f || massB <= 0.0f) return 0.0;
+    return std::sqrt(std::max(0.0f, 1.0f - coefficient));
+}
+
+} // namespace
+
 ChangeDetectionMetrics ChangeDetector::analyzeFrame(const std::vector<PlantInstance>& instances) {
+    return analyzeFrame(PlantMetricsTable::from(instances));
+}
+
+ChangeDetectionMetrics ChangeDetector::analyzeFrame(const PlantMetricsTable& instances) {
     ChangeDetectionMetrics metrics;
-    metrics.timestamp = std::chrono::steady_clock::now();
+    metrics.timestamp = std::chrono::system_clock::now();
+    const bool drift = options_.mode == ChangeDetectionMode::DRIFT;
     
     // Compute current frame baseline
     BaselineData current = computeBaseline(instances);
@@ -18,6 +40,7 @@ ChangeDetectionMetrics ChangeDetector::analyzeFrame(const std::vector<PlantInsta
     if (!baseline_.isValid) {
         baseline_ = current;
         baseline_.isValid = true;
+        if (drift) trackPlants(instances, metrics);  // every plant starts its history here
         return metrics; // No change on first frame
     }
     
@@ -35,7 +58,7 @@ ChangeDetectionMetrics ChangeDetector::analyzeFrame(const std::vector<PlantInsta
     
     // Morphology change (based on shape descriptors)
     metrics.morphologyChange = std::abs(calculateMorphologyScore(instances) - 
-                                       calculateMorphologyScore(std::vector<PlantInstance>()));
+                                       calculateMorphologyScore(PlantMetricsTable()));
     
     // Determine if change is significant
     metrics.significantChange = (
@@ -47,10 +70,21 @@ ChangeDetectionMetrics ChangeDetector::analyzeFrame(const std::vector<PlantInsta
         metrics.morphologyChange > MORPHOLOGY_CHANGE_THRESHOLD
     );
     
+    if (drift) {
+        // A single plant drifting is significant even when the frame averages barely move
+        trackPlants(instances, metrics);
+        metrics.significantChange = metrics.significantChange || metrics.changedInstanceCount > 0;
+        blendBaseline(current);
+    }
+    
     return metrics;
 }
 
 void ChangeDetector::updateBaseline(const std::vector<PlantInstance>& instances) {
+    updateBaseline(PlantMetricsTable::from(instances));
+}
+
+void ChangeDetector::updateBaseline(const PlantMetricsTable& instances) {
     baseline_ = computeBaseline(instances);
     baseline_.isValid = true;
     lastUpdate_ = std::chrono::steady_clock::now();
@@ -58,31 +92,57 @@ void ChangeDetector::updateBaseline(const std::vector<PlantInstance>& instances)
 
 void ChangeDetector::reset() {
     baseline_ = BaselineData();
+    plants_.clear();
+    frameNumber_ = 0;
     lastUpdate_ = std::chrono::steady_clock::now();
 }
 
+json ChangeDetector::changeSignal(const ChangeDetectionMetrics& metrics) const {
+    json changeData;
+    changeData["timestamp"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+        metrics.timestamp.time_since_epoch()).count();
+    changeData["mode"] = options_.mode == ChangeDetectionMode::DRIFT ? "drift" : "baseline";
+    changeData["significant_change"] = metrics.significantChange;
+    changeData["changes"] = {
+        {"total_area_change", metrics.totalAreaChange},
+        {"plant_count_change", metrics.plantCountChange},
+        {"avg_color_change_h", metrics.avgColorChangeH},
+        {"avg_color_change_s", metrics.avgColorChangeS},
+        {"avg_color_change_v", metrics.avgColorChangeV},
+        {"morphology_change", metrics.morphologyChange}
+    };
+    changeData["thresholds"] = {
+        {"area_threshold", AREA_CHANGE_THRESHOLD},
+        {"count_threshold", COUNT_CHANGE_THRESHOLD},
+        {"color_h_threshold", COLOR_CHANGE_THRESHOLD_H},
+        {"color_s_threshold", COLOR_CHANGE_THRESHOLD_S},
+        {"color_v_threshold", COLOR_CHANGE_THRESHOLD_V},
+        {"morphology_threshold", MORPHOLOGY_CHANGE_THRESHOLD}
+    };
+    
+    if (options_.mode == ChangeDetectionMode::DRIFT) {
+        changeData["thresholds"]["instance_histogram_threshold"] = options_.histogramThreshold;
+        changeData["thresholds"]["instance_area_threshold"] = options_.areaThreshold;
+        changeData["changed_instances"] = metrics.changedInstanceCount;
+        json instances = json::array();
+        for (const auto& change : metrics.instanceChanges) {
+            instances.push_back({
+                {"index", change.row},
+                {"track_id", change.trackId},
+                {"color_distance", change.colorDistance},
+                {"area_change", change.areaChange},
+                {"new", change.isNew},
+                {"changed", change.changed}
+            });
+        }
+        changeData["instances"] = std::move(instances);
+    }
+    return changeData;
+}
+
 bool ChangeDetector::writeChangeSignal(const ChangeDetectionMetrics& metrics, const std::string& filePath) const {
     try {
-        json changeData;
-        changeData["timestamp"] = std::chrono::duration_cast<std::chrono::milliseconds>(
-            metrics.timestamp.time_since_epoch()).count();
-        changeData["significant_change"] = metrics.significantChange;
-        changeData["changes"] = {
-            {"total_area_change", metrics.totalAreaChange},
-            {"plant_count_change", metrics.plantCountChange},
-            {"avg_color_change_h", metrics.avgColorChangeH},
-            {"avg_color_change_s", metrics.avgColorChangeS},
-            {"avg_color_change_v", metrics.avgColorChangeV},
-            {"morphology_change", metrics.morphologyChange}
-        };
-        changeData["thresholds"] = {
-            {"area_threshold", AREA_CHANGE_THRESHOLD},
-            {"count_threshold", COUNT_CHANGE_THRESHOLD},
-            {"color_h_threshold", COLOR_CHANGE_THRESHOLD_H},
-            {"color_s_threshold", COLOR_CHANGE_THRESHOLD_S},
-            {"color_v_threshold", COLOR_CHANGE_THRESHOLD_V},
-            {"morphology_threshold", MORPHOLOGY_CHANGE_THRESHOLD}
-        };
+        json changeData = changeSignal(metrics);
         
         std::ofstream file(filePath);
         if (!file.is_open()) return false;
@@ -94,65 +154,125 @@ bool ChangeDetector::writeChangeSignal(const ChangeDetectionMetrics& metrics, co
     }
 }
 
-ChangeDetector::BaselineData ChangeDetector::computeBaseline(const std::vector<PlantInstance>& instances) const {
+ChangeDetector::BaselineData ChangeDetector::computeBaseline(const PlantMetricsTable& metrics) const {
     BaselineData baseline;
-    if (instances.empty()) return baseline;
+    if (metrics.empty()) return baseline;
     
-    baseline.plantCount = static_cast<int>(instances.size());
-    baseline.totalArea = 0.0;
+    const int count = static_cast<int>(metrics.size());
+    baseline.plantCount = count;
+    baseline.totalArea = std::accumulate(metrics.areaPixels.begin(), metrics.areaPixels.end(), 0.0);
     
-    // Accumulate values for averaging
-    cv::Scalar colorSum(0, 0, 0);
-    double soliditySum = 0.0;
-    double circularitySum = 0.0;
-    double eccentricitySum = 0.0;
-    int validInstances = 0;
-    
-    for (const auto& instance : instances) {
-        baseline.totalArea += instance.areaPixels;
-        
-        // Convert BGR mean color to HSV for better change detection
-        cv::Mat colorMat(1, 1, CV_8UC3, cv::Scalar(instance.meanColor[0], instance.meanColor[1], instance.meanColor[2]));
-        cv::Mat hsvMat;
-        cv::cvtColor(colorMat, hsvMat, cv::COLOR_BGR2HSV);
-        cv::Scalar hsvColor = cv::mean(hsvMat);
-        
-        colorSum[0] += hsvColor[0];
-        colorSum[1] += hsvColor[1];
-        colorSum[2] += hsvColor[2];
-        
-        soliditySum += instance.solidity;
-        circularitySum += instance.circularity;
-        eccentricitySum += instance.eccentricity;
-        validInstances++;
+    // Mean colours go to HSV for better change detection, all instances in one conversion
+    cv::Mat colorRow(1, count, CV_8UC3);
+    for (int i = 0; i < count; ++i) {
+        colorRow.at<cv::Vec3b>(0, i) = cv::Vec3b(cv::saturate_cast<uchar>(metrics.meanB[i]),
+                                                 cv::saturate_cast<uchar>(metrics.meanG[i]),
+                                                 cv::saturate_cast<uchar>(metrics.meanR[i]));
     }
+    cv::Mat hsvRow;
+    cv::cvtColor(colorRow, hsvRow, cv::COLOR_BGR2HSV);
+    // Channel sums of the 8-bit HSV values, the same the per-instance conversion used to average
+    cv::Scalar colorSum = cv::sum(hsvRow);
     
-    if (validInstances > 0) {
-        baseline.avgColor = cv::Scalar(
-            colorSum[0] / validInstances,
-            colorSum[1] / validInstances,
-            colorSum[2] / validInstances
-        );
-        baseline.avgSolidity = soliditySum / validInstances;
-        baseline.avgCircularity = circularitySum / validInstances;
-        baseline.avgEccentricity = eccentricitySum / validInstances;
-        baseline.isValid = true;
-    }
+    baseline.avgColor = cv::Scalar(colorSum[0] / count, colorSum[1] / count, colorSum[2] / count);
+    baseline.avgSolidity = std::accumulate(metrics.solidity.begin(), metrics.solidity.end(), 0.0) / count;
+    baseline.avgCircularity = std::accumulate(metrics.circularity.begin(), metrics.circularity.end(), 0.0) / count;
+    baseline.avgEccentricity = std::accumulate(metrics.eccentricity.begin(), metrics.eccentricity.end(), 0.0) / count;
+    baseline.isValid = true;
     
     return baseline;
 }
 
-double ChangeDetector::calculateMorphologyScore(const std::vector<PlantInstance>& instances) const {
-    if (instances.empty()) return 0.0;
+double ChangeDetector::calculateMorphologyScore(const PlantMetricsTable& metrics) const {
+    if (metrics.empty()) return 0.0;
     
     double score = 0.0;
-    for (const auto& instance : instances) {
+    for (size_t i = 0; i < metrics.size(); ++i) {
         // Combine multiple morphological features into a single score
-        score += instance.solidity * 0.3 + 
-                 instance.circularity * 0.3 + 
-                 (1.0 - instance.eccentricity) * 0.2 +  // Lower eccentricity = more circular
-                 (instance.compactness * 0.2);
+        score += metrics.solidity[i] * 0.3 + 
+                 metrics.circularity[i] * 0.3 + 
+                 (1.0 - metrics.eccentricity[i]) * 0.2 +  // Lower eccentricity = more circular
+                 (metrics.compactness[i] * 0.2);
+    }
+    
+    return score / metrics.size();
+}
+
+void ChangeDetector::trackPlants(const PlantMetricsTable& metrics, ChangeDetectionMetrics& result) {
+    ++frameNumber_;
+    const float alpha = static_cast<float>(std::clamp(options_.emaAlpha, 0.0, 1.0));
+    const bool hasHistograms = metrics.colorHistogram.size() == metrics.size() * PLANT_HISTOGRAM_BINS;
+    
+    for (size_t row = 0; row < metrics.size(); ++row) {
+        const int trackId = metrics.trackId[row];
+        if (trackId < 0) continue;
+        
+        InstanceChange change;
+        change.row = row;
+        change.trackId = trackId;
+        const double area = metrics.areaPixels[row];
+        const float* histogram = hasHistograms ? metrics.histogram(row) : nullptr;
+        
+        auto it = plants_.find(trackId);
+        if (it == plants_.end()) {
+            PlantState state;
+            state.area = area;
+            if (histogram) state.histogram.assign(histogram, histogram + PLANT_HISTOGRAM_BINS);
+            state.lastSeen = frameNumber_;
+            plants_.emplace(trackId, std::move(state));
+            change.isNew = true;
+            change.changed = true;
+        } else {
+            PlantState& state = it->second;
+            if (state.area > 0) {
+                change.areaChange = std::abs(area - state.area) / state.area;
+            }
+            if (histogram && state.histogram.size() == PLANT_HISTOGRAM_BINS) {
+                change.colorDistance = hellingerDistance(histogram, state.histogram.data());
+            }
+            change.changed = change.colorDistance > options_.histogramThreshold ||
+                             change.areaChange > options_.areaThreshold;
+            
+            // Running averages follow slow growth, so only a departure from the recent trend flags the plant
+            state.area += alpha * (area - state.area);
+            if (histogram) {
+                if (state.histogram.size() != PLANT_HISTOGRAM_BINS) {
+                    state.histogram.assign(histogram, histogram + PLANT_HISTOGRAM_BINS);
+                } else {
+                    float* running = state.histogram.data();
+                    for (int i = 0; i < PLANT_HISTOGRAM_BINS; ++i) {
+                        running[i] += alpha * (histogram[i] - running[i]);
+                    }
+                }
+            }
+            state.lastSeen = frameNumber_;
+        }
+        
+        if (change.changed) result.changedInstanceCount++;
+        result.instanceChanges.push_back(change);
     }
     
-    return score / instances.size();
+    // Forget plants whose track has been gone long enough for the tracker to have dropped it too
+    const uint64_t maxMissed = static_cast<uint64_t>(std::max(0, options_.maxMissedFrames));
+    for (auto it = plants_.begin(); it != plants_.end();) {
+        if (frameNumber_ - it->second.lastSeen > maxMissed) {
+            it = plants_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ChangeDetector::blendBaseline(const BaselineData& current) {
+    const double alpha = std::clamp(options_.emaAlpha, 0.0, 1.0);
+    // Plant count is discrete; the latest count is the reference for the next frame
+    baseline_.plantCount = current.plantCount;
+    baseline_.totalArea += alpha * (current.totalArea - baseline_.totalArea);
+    for (int c = 0; c < 3; ++c) {
+        baseline_.avgColor[c] += alpha * (current.avgColor[c] - baseline_.avgColor[c]);
+    }
+    baseline_.avgSolidity += alpha * (current.avgSolidity - baseline_.avgSolidity);
+    baseline_.avgCircularity += alpha * (current.avgCircularity - baseline_.avgCircularity);
+    baseline_.avgEccentricity += alpha * (current.avgEccentricity - baseline_.avgEccentricity);
+    baseline_.isValid = true;
 }
@@ -3,6 +3,92 @@
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
+#include <iomanip>
+#include <type_traits>
+
+namespace {
+
+const nlohmann::json& sectionOf(const nlohmann::json& parent, const char* key) {
+    static const nlohmann::json empty = nlohmann::json::object();
+    if (!parent.is_object()) return empty;
+    auto it = parent.find(key);
+    return (it != parent.end() && it->is_object()) ? *it : empty;
+}
+
+// Like json::value(), but tolerant of the web UI storing numbers as strings
+template <typename T>
+T valueOr(const nlohmann::json& obj, const char* key, const T& def) {
+    if (!obj.is_object()) return def;
+    auto it = obj.find(key);
+    if (it == obj.end() || it->is_null()) return def;
+    try {
+        if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+            if (it->is_string()) return static_cast<T>(std::stod(it->template get<std::string>()));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            if (it->is_number()) return it->dump();
+        }
+        return it->template get<T>();
+    } catch (...) {
+        return def;
+    }
+}
+
+std::string valueOr(const nlohmann::json& obj, const char* key, const char* def) {
+    return valueOr<std::string>(obj, key, std::string(def));
+}
+
+cv::Scalar hueRangeOr(const nlohmann::json& obj, const char* key, const cv::Scalar& def) {
+    auto it = obj.find(key);
+    if (it == obj.end() || !it->is_array() || it->size() < 2) return def;
+    return cv::Scalar((*it)[0].get<double>(), (*it)[1].get<double>());
+}
+
+CaptureOptions captureOr(const nlohmann::json& obj, const CaptureOptions& def) {
+    CaptureOptions capture;
+    capture.backend = valueOr(obj, "backend", def.backend);
+    capture.hw_decoder = valueOr(obj, "hw_decoder", def.hw_decoder);
+    capture.hw_acceleration = valueOr(obj, "hw_acceleration", def.hw_acceleration);
+    capture.codec = valueOr(obj, "codec", def.codec);
+    capture.fourcc = valueOr(obj, "fourcc", def.fourcc);
+    capture.width = valueOr(obj, "width", def.width);
+    capture.height = valueOr(obj, "height", def.height);
+    capture.fps = valueOr(obj, "fps", def.fps);
+    capture.latency_ms = valueOr(obj, "latency_ms", def.latency_ms);
+    capture.pipeline = valueOr(obj, "pipeline", def.pipeline);
+    return capture;
+}
+
+} // namespace
+
+const std::string* ClassOverrides::label(int instance_id) const {
+    auto it = labels.find(instance_id);
+    return (it != labels.end()) ? &it->second : nullptr;
+}
+
+bool loadClassOverrides(const std::string& path, ClassOverrides& out) {
+    ClassOverrides overrides;
+    std::ifstream file(path);
+    if (file.is_open()) {
+        nlohmann::json json;
+        try {
+            file >> json;
+        } catch (const std::exception&) {
+            // Usually caught mid-write by the web UI
+            return false;
+        }
+        if (json.is_object()) {
+            for (const auto& [key, entry] : json.items()) {
+                const std::string label = valueOr(entry, "label", "");
+                if (label.empty()) continue;
+                try {
+                    overrides.labels[std::stoi(key)] = label;
+                } catch (const std::exception&) {}
+            }
+        }
+    }
+    out = std::move(overrides);
+    return true;
+}
 
 // Global configuration instance
 std::unique_ptr<ConfigManager> g_config_manager = std::make_unique<ConfigManager>();
@@ -93,99 +179,90 @@ void ConfigManager::parsePlantTypes() {
 }
 
 void ConfigManager::parseProcessingConfig() {
-    const auto& global = config_json["processing"]["global"];
-    const auto& sprout = config_json["processing"]["sprout_specific"];
-    const auto& plant = config_json["processing"]["plant_specific"];
+    const auto& processing = sectionOf(config_json, "processing");
+    // Structured configs nest the globals; the flat web UI format keeps them directly under "processing"
+    const auto& global = processing.contains("global") ? sectionOf(processing, "global") : processing;
+    const auto& sprout = sectionOf(processing, "sprout_specific");
+    const auto& plant = sectionOf(processing, "plant_specific");
     
     // Global settings
-    processing_config.threshold = global.value("threshold", 100);
-    processing_config.publish_interval_ms = global.value("publish_interval_ms", 30000);
-    processing_config.scale_px_per_cm = global.value("scale_px_per_cm", 4.2);
-    processing_config.enable_watershed = global.value("enable_watershed", true);
-    processing_config.enable_advanced_health = global.value("enable_advanced_health", true);
+    processing_config.threshold = valueOr(global, "threshold", 100);
+    processing_config.publish_interval_ms = valueOr(global, "publish_interval_ms", 30000);
+    processing_config.scale_px_per_cm = valueOr(global, "scale_px_per_cm", 4.2);
+    processing_config.enable_watershed = valueOr(global, "enable_watershed", true);
+    processing_config.enable_advanced_health = valueOr(global, "enable_advanced_health", true);
     
     // Sprout-specific settings
-    processing_config.sprout_sensitivity_multiplier = sprout.value("sensitivity_multiplier", 1.2);
-    processing_config.sprout_min_area = sprout.value("min_area_pixels", 50);
-    processing_config.sprout_max_area = sprout.value("max_area_pixels", 5000);
-    processing_config.sprout_morphology_kernel = sprout.value("morphology_kernel", 3);
-    
-    if (sprout.contains("hue_range")) {
-        auto hue_range = sprout["hue_range"];
-        processing_config.sprout_hue_range = cv::Scalar(hue_range[0], hue_range[1]);
-    }
+    processing_config.sprout_sensitivity_multiplier = valueOr(sprout, "sensitivity_multiplier", 1.2);
+    processing_config.sprout_min_area = valueOr(sprout, "min_area_pixels", 50);
+    processing_config.sprout_max_area = valueOr(sprout, "max_area_pixels", 5000);
+    processing_config.sprout_morphology_kernel = valueOr(sprout, "morphology_kernel", 3);
+    processing_config.sprout_hue_range = hueRangeOr(sprout, "hue_range", cv::Scalar(20, 90));
     
     // Plant-specific settings
-    processing_config.plant_min_area = plant.value("min_area_pixels", 100);
-    processing_config.enable_petal_detection = plant.value("enable_petal_detection", true);
-    processing_config.enable_fruit_detection = plant.value("enable_fruit_detection", true);
-    processing_config.enable_disease_detection = plant.value("disease_detection", true);
-    processing_config.plant_morphology_kernel = plant.value("morphology_kernel", 5);
+    processing_config.plant_min_area = valueOr(plant, "min_area_pixels", 100);
+    processing_config.enable_petal_detection = valueOr(plant, "enable_petal_detection", true);
+    processing_config.enable_fruit_detection = valueOr(plant, "enable_fruit_detection", true);
+    processing_config.enable_disease_detection = valueOr(plant, "disease_detection", true);
+    processing_config.plant_morphology_kernel = valueOr(plant, "morphology_kernel", 5);
 }
 
 void ConfigManager::parseCameras() {
     cameras.clear();
+    const CaptureOptions default_capture = captureOr(sectionOf(config_json, "capture"), CaptureOptions());
     
-    if (config_json.contains("cameras")) {
+    if (config_json.contains("cameras") && config_json["cameras"].is_array()) {
         for (const auto& cam_data : config_json["cameras"]) {
             CameraConfig config;
             
-            config.id = cam_data.value("id", "");
-            config.name = cam_data.value("name", "Unknown Camera");
+            // Both the structured layout and the flat one the web UI writes (camera_id, input_mode, room, ...)
+            config.id = valueOr(cam_data, "id", valueOr(cam_data, "camera_id", "").c_str());
+            config.name = valueOr(cam_data, "name", "Unknown Camera");
             
             // Location
-            if (cam_data.contains("location")) {
-                const auto& loc = cam_data["location"];
-                config.location.room = loc.value("room", "");
-                config.location.area = loc.value("area", "");
-                
-                if (loc.contains("position")) {
-                    auto pos = loc["position"];
-                    config.location.position.x = pos.value("x", 0.0);
-                    config.location.position.y = pos.value("y", 0.0);
-                    config.location.position.z = pos.value("height", 0.0);
-                }
-            }
+            const auto& loc = sectionOf(cam_data, "location");
+            config.location.room = valueOr(loc, "room", valueOr(cam_data, "room", "").c_str());
+            config.location.area = valueOr(loc, "area", valueOr(cam_data, "area", "").c_str());
+            const auto& pos = sectionOf(loc, "position");
+            config.location.position.x = valueOr(pos, "x", 0.0);
+            config.location.position.y = valueOr(pos, "y", 0.0);
+            config.location.position.z = valueOr(pos, "height", 0.0);
             
             // Input configuration
-            if (cam_data.contains("input")) {
-                const auto& input = cam_data["input"];
-                std::string mode_str = input.value("mode", "IMAGE");
-                
-                if (mode_str == "IMAGE") config.input.mode = CameraConfig::Input::IMAGE;
-                else if (mode_str == "CAMERA") config.input.mode = CameraConfig::Input::CAMERA;
-                else if (mode_str == "URL") config.input.mode = CameraConfig::Input::URL;
-                
-                config.input.path = input.value("path", "");
-                config.input.url = input.value("url", "");
-                config.input.device_id = input.value("device_id", 0);
-            }
+            const auto& input = sectionOf(cam_data, "input");
+            std::string mode_str = valueOr(input, "mode", valueOr(cam_data, "input_mode", "IMAGE").c_str());
+            if (mode_str == "CAMERA") config.input.mode = CameraConfig::Input::CAMERA;
+            else if (mode_str == "URL" || mode_str == "NETWORK") config.input.mode = CameraConfig::Input::URL;
+            else config.input.mode = CameraConfig::Input::IMAGE;
             
-            // Processing overrides
-            if (cam_data.contains("processing_overrides")) {
-                const auto& overrides = cam_data["processing_overrides"];
-                config.processing_overrides.threshold = overrides.value("threshold", processing_config.threshold);
-                config.processing_overrides.scale_px_per_cm = overrides.value("scale_px_per_cm", processing_config.scale_px_per_cm);
-                config.processing_overrides.sprout_focus = overrides.value("sprout_focus", false);
-                
-                if (overrides.contains("focus_area")) {
-                    const auto& focus = overrides["focus_area"];
-                    config.processing_overrides.focus_area = cv::Rect(
-                        focus.value("x", 0),
-                        focus.value("y", 0),
-                        focus.value("width", 640),
-                        focus.value("height", 480)
-                    );
-                }
+            config.input.path = valueOr(input, "path", valueOr(cam_data, "input_path", "").c_str());
+            config.input.url = valueOr(input, "url", valueOr(cam_data, "input_url", "").c_str());
+            // The flat layout uses the numeric camera id as the device index
+            config.input.device_id = valueOr(input, "device_id", valueOr(cam_data, "camera_id", 0));
+            config.input.capture = captureOr(sectionOf(input, "capture"), default_capture);
+            
+            // Processing overrides, defaulting to the global processing settings
+            const auto& overrides = sectionOf(cam_data, "processing_overrides");
+            config.processing_overrides.threshold = valueOr(overrides, "threshold", processing_config.threshold);
+            config.processing_overrides.scale_px_per_cm = valueOr(overrides, "scale_px_per_cm", processing_config.scale_px_per_cm);
+            config.processing_overrides.publish_interval_ms = valueOr(overrides, "publish_interval_ms", processing_config.publish_interval_ms);
+            config.processing_overrides.sprout_focus = valueOr(overrides, "sprout_focus", false);
+            
+            if (overrides.contains("focus_area")) {
+                const auto& focus = sectionOf(overrides, "focus_area");
+                config.processing_overrides.focus_area = cv::Rect(
+                    valueOr(focus, "x", 0),
+                    valueOr(focus, "y", 0),
+                    valueOr(focus, "width", 640),
+                    valueOr(focus, "height", 480)
+                );
             }
             
             // Output configuration
-            if (cam_data.contains("output")) {
-                const auto& output = cam_data["output"];
-                config.output.save_images = output.value("save_images", true);
-                config.output.image_quality = output.value("image_quality", 90);
-                config.output.enable_base64 = output.value("enable_base64", true);
-            }
+            const auto& output = sectionOf(cam_data, "output");
+            config.output.save_images = valueOr(output, "save_images", true);
+            config.output.image_quality = valueOr(output, "image_quality", 90);
+            config.output.enable_base64 = valueOr(output, "enable_base64", true);
             
             cameras.push_back(config);
         }
@@ -193,40 +270,33 @@ void ConfigManager::parseCameras() {
 }
 
 void ConfigManager::parseMQTTConfig() {
-    // Broker configuration
-    if (config_json.contains("mqtt") && config_json["mqtt"].contains("broker")) {
-        const auto& broker = config_json["mqtt"]["broker"];
-        mqtt_config.broker.host = broker.value("host", "localhost");
-        mqtt_config.broker.port = broker.value("port", 1883);
-        mqtt_config.broker.username = broker.value("username", "");
-        mqtt_config.broker.password = broker.value("password", "");
-        mqtt_config.broker.client_id = broker.value("client_id", "plantvision");
-    }
+    const auto& mqtt = sectionOf(config_json, "mqtt");
+    
+    // Broker configuration; the flat layout keeps host and port directly under "mqtt"
+    const auto& broker = mqtt.contains("broker") ? sectionOf(mqtt, "broker") : mqtt;
+    mqtt_config.broker.host = valueOr(broker, "host", "localhost");
+    mqtt_config.broker.port = valueOr(broker, "port", 1883);
+    mqtt_config.broker.username = valueOr(broker, "username", "");
+    mqtt_config.broker.password = valueOr(broker, "password", "");
+    mqtt_config.broker.client_id = valueOr(broker, "client_id", "plantvision");
     
     // Topic templates
-    if (config_json.contains("mqtt") && config_json["mqtt"].contains("topics")) {
-        const auto& topics = config_json["mqtt"]["topics"];
-        mqtt_config.topics.base = topics.value("base", "plantvision");
-        mqtt_config.topics.system_status = topics.value("system_status", "{base}/{room}/{area}/{camera_id}/system/status");
-        mqtt_config.topics.analysis_telemetry = topics.value("analysis_telemetry", "{base}/{room}/{area}/{camera_id}/analysis/telemetry");
-        mqtt_config.topics.sprout_telemetry = topics.value("sprout_telemetry", "{base}/{room}/{area}/{camera_id}/sprouts/{id}/telemetry");
-        mqtt_config.topics.plant_telemetry = topics.value("plant_telemetry", "{base}/{room}/{area}/{camera_id}/plants/{id}/telemetry");
-        mqtt_config.topics.alerts = topics.value("alerts", "{base}/{room}/{area}/{camera_id}/alerts");
-    }
+    const auto& topics = sectionOf(mqtt, "topics");
+    mqtt_config.topics.base = valueOr(topics, "base", "plantvision");
+    mqtt_config.topics.system_status = valueOr(topics, "system_status", "{base}/{room}/{area}/{camera_id}/system/status");
+    mqtt_config.topics.analysis_telemetry = valueOr(topics, "analysis_telemetry", "{base}/{room}/{area}/{camera_id}/analysis/telemetry");
+    mqtt_config.topics.sprout_telemetry = valueOr(topics, "sprout_telemetry", "{base}/{room}/{area}/{camera_id}/sprouts/{id}/telemetry");
+    mqtt_config.topics.plant_telemetry = valueOr(topics, "plant_telemetry", "{base}/{room}/{area}/{camera_id}/plants/{id}/telemetry");
+    mqtt_config.topics.alerts = valueOr(topics, "alerts", "{base}/{room}/{area}/{camera_id}/alerts");
     
     // QoS and retain settings
-    if (config_json.contains("mqtt")) {
-        if (config_json["mqtt"].contains("qos")) {
-            for (const auto& [key, value] : config_json["mqtt"]["qos"].items()) {
-                mqtt_config.qos[key] = value;
-            }
-        }
-        
-        if (config_json["mqtt"].contains("retain")) {
-            for (const auto& [key, value] : config_json["mqtt"]["retain"].items()) {
-                mqtt_config.retain[key] = value;
-            }
-        }
+    mqtt_config.qos.clear();
+    mqtt_config.retain.clear();
+    for (const auto& [key, value] : sectionOf(mqtt, "qos").items()) {
+        if (value.is_number_integer()) mqtt_config.qos[key] = value.get<int>();
+    }
+    for (const auto& [key, value] : sectionOf(mqtt, "retain").items()) {
+        if (value.is_boolean()) mqtt_config.retain[key] = value.get<bool>();
     }
 }
 
@@ -254,7 +324,7 @@ const CameraConfig* ConfigManager::getCameraConfig(const std::string& camera_id)
 }
 
 const CameraConfig* ConfigManager::getCameraConfig(int camera_index) const {
-    return (camera_index >= 0 && camera_index < cameras.size()) ? &cameras[camera_index] : nullptr;
+    return (camera_index >= 0 && camera_index < static_cast<int>(cameras.size())) ? &cameras[camera_index] : nullptr;
 }
 
 const MQTTConfig& ConfigManager::getMQTTConfig() const {
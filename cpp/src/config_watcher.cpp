@@ -0,0 +1,72 @@
+#include "config_watcher.hpp"
+#include <iostream>
+
+FileWatcher::FileWatcher(std::chrono::milliseconds interval) : interval_(interval) {}
+
+FileWatcher::~FileWatcher() {
+    stop();
+}
+
+void FileWatcher::watch(const std::string& path, std::function<bool()> onChange) {
+    Entry entry;
+    entry.path = path;
+    entry.onChange = std::move(onChange);
+    entry.exists = stat(path, entry.mtime, entry.size);
+    entries_.push_back(std::move(entry));
+}
+
+void FileWatcher::start() {
+    if (running_ || entries_.empty()) return;
+    running_ = true;
+    thread_ = std::thread(&FileWatcher::run, this);
+}
+
+void FileWatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool FileWatcher::stat(const std::string& path, std::filesystem::file_time_type& mtime, std::uintmax_t& size) {
+    std::error_code ec;
+    mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    size = std::filesystem::file_size(path, ec);
+    return !ec;
+}
+
+void FileWatcher::run() {
+    while (running_) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait_for(lock, interval_, [this]() { return !running_; });
+        }
+        if (!running_) break;
+
+        for (auto& entry : entries_) {
+            std::filesystem::file_time_type mtime;
+            std::uintmax_t size = 0;
+            const bool exists = stat(entry.path, mtime, size);
+            if (exists == entry.exists && (!exists || (mtime == entry.mtime && size == entry.size))) {
+                continue;
+            }
+            bool applied = false;
+            try {
+                applied = entry.onChange();
+            } catch (const std::exception& e) {
+                std::cerr << "Reload of " << entry.path << " failed: " << e.what() << std::endl;
+            }
+            // Only remember the new state once it was taken; otherwise try again next poll
+            if (applied) {
+                entry.exists = exists;
+                entry.mtime = mtime;
+                entry.size = size;
+            }
+        }
+    }
+}
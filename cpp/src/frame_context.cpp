@@ -0,0 +1,104 @@
+#include "frame_context.hpp"
+#include "scratch_pool.hpp"
+
+const cv::Scalar FrameContext::GREEN_HSV_LOWER = cv::Scalar(25, 40, 40);
+const cv::Scalar FrameContext::GREEN_HSV_UPPER = cv::Scalar(85, 255, 255);
+
+namespace {
+
+void computeGreenMask(const cv::Mat& hsv, cv::Mat& mask) {
+    static const cv::Mat openKernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
+    static const cv::Mat closeKernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(5, 5));
+    cv::Mat raw = ScratchPool::local().acquire(hsv.size(), CV_8UC1);
+    cv::inRange(hsv, FrameContext::GREEN_HSV_LOWER, FrameContext::GREEN_HSV_UPPER, raw);
+    cv::morphologyEx(raw, mask, cv::MORPH_OPEN, openKernel);
+    cv::morphologyEx(mask, mask, cv::MORPH_CLOSE, closeKernel);
+}
+
+} // namespace
+
+FrameContext::FrameContext(const cv::Mat& bgr) : bgr_(bgr) {}
+
+const cv::Mat& FrameContext::hsv() const {
+    std::call_once(hsv_once_, [this]() {
+        if (!bgr_.empty()) {
+            hsv_ = ScratchPool::shared().acquire(bgr_.size(), CV_8UC3);
+            cv::cvtColor(bgr_, hsv_, cv::COLOR_BGR2HSV);
+        }
+        hsv_ready_ = true;
+    });
+    return hsv_;
+}
+
+const cv::Mat& FrameContext::lab() const {
+    std::call_once(lab_once_, [this]() {
+        if (!bgr_.empty()) {
+            lab_ = ScratchPool::shared().acquire(bgr_.size(), CV_8UC3);
+            cv::cvtColor(bgr_, lab_, cv::COLOR_BGR2Lab);
+        }
+    });
+    return lab_;
+}
+
+const cv::Mat& FrameContext::gray() const {
+    std::call_once(gray_once_, [this]() {
+        if (!bgr_.empty()) {
+            gray_ = ScratchPool::shared().acquire(bgr_.size(), CV_8UC1);
+            cv::cvtColor(bgr_, gray_, cv::COLOR_BGR2GRAY);
+        }
+        gray_ready_ = true;
+    });
+    return gray_;
+}
+
+const cv::Mat& FrameContext::greenMask() const {
+    std::call_once(green_mask_once_, [this]() {
+        const cv::Mat& planes = hsv();
+        if (!planes.empty()) {
+            green_mask_ = ScratchPool::shared().acquire(planes.size(), CV_8UC1);
+            computeGreenMask(planes, green_mask_);
+        }
+        green_mask_ready_ = true;
+    });
+    return green_mask_;
+}
+
+const FrameContext& FrameContext::level(int factor) const {
+    if (factor <= 1 || bgr_.empty()) return *this;
+    std::lock_guard<std::mutex> lock(levels_mutex_);
+    auto& entry = levels_[factor];
+    if (!entry) {
+        const cv::Size size(std::max(1, bgr_.cols / factor), std::max(1, bgr_.rows / factor));
+        cv::Mat reduced = ScratchPool::shared().acquire(size, bgr_.type());
+        cv::resize(bgr_, reduced, size, 0, 0, cv::INTER_AREA);
+        entry = std::make_unique<FrameContext>(reduced);
+    }
+    return *entry;
+}
+
+cv::Mat FrameContext::hsvRegion(const cv::Rect& roi) const {
+    const cv::Rect clipped = roi & cv::Rect(0, 0, bgr_.cols, bgr_.rows);
+    if (clipped.empty()) return cv::Mat();
+    if (hsv_ready_) return hsv_(clipped);
+    cv::Mat region = ScratchPool::local().acquire(clipped.size(), CV_8UC3);
+    cv::cvtColor(bgr_(clipped), region, cv::COLOR_BGR2HSV);
+    return region;
+}
+
+cv::Mat FrameContext::grayRegion(const cv::Rect& roi) const {
+    const cv::Rect clipped = roi & cv::Rect(0, 0, bgr_.cols, bgr_.rows);
+    if (clipped.empty()) return cv::Mat();
+    if (gray_ready_) return gray_(clipped);
+    cv::Mat region = ScratchPool::local().acquire(clipped.size(), CV_8UC1);
+    cv::cvtColor(bgr_(clipped), region, cv::COLOR_BGR2GRAY);
+    return region;
+}
+
+cv::Mat FrameContext::greenMaskRegion(const cv::Rect& roi) const {
+    const cv::Rect clipped = roi & cv::Rect(0, 0, bgr_.cols, bgr_.rows);
+    if (clipped.empty()) return cv::Mat();
+    if (green_mask_ready_) return green_mask_(clipped);
+    cv::Mat mask = ScratchPool::local().acquire(clipped.size(), CV_8UC1);
+    computeGreenMask(hsvRegion(clipped), mask);
+    return mask;
+}
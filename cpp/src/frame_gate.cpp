@@ -0,0 +1,77 @@
+#include "frame_gate.hpp"
+#include "frame_context.hpp"
+#include "stage_metrics.hpp"
+#include <algorithm>
+#include <cmath>
+
+FrameGate::FrameGate(const FrameGateOptions& options)
+    : options_(options) {}
+
+void FrameGate::reset() {
+    reference_gray_.release();
+    pending_gray_.release();
+    has_reference_ = false;
+    frames_since_analysis_ = 0;
+}
+
+FrameGate::Decision FrameGate::evaluate(const cv::Mat& frame) {
+    STAGE_TIMER("frame_gate");
+    Decision decision;
+    decision.framesSinceAnalysis = frames_since_analysis_;
+
+    if (frame.empty()) {
+        decision.reason = "empty_frame";
+        pending_gray_.release();
+        return decision;
+    }
+
+    int width = std::max(1, std::min(options_.downscaleWidth, frame.cols));
+    int height = std::max(1, static_cast<int>(std::lround(frame.rows * static_cast<double>(width) / frame.cols)));
+    cv::resize(frame, small_, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+
+    cv::cvtColor(small_, small_hsv_, cv::COLOR_BGR2HSV);
+    cv::inRange(small_hsv_, FrameContext::GREEN_HSV_LOWER, FrameContext::GREEN_HSV_UPPER, green_);
+    pending_green_ratio_ = static_cast<double>(cv::countNonZero(green_)) / green_.total();
+
+    // Fresh buffer: the pending thumbnail may become the reference
+    cv::cvtColor(small_, pending_gray_, cv::COLOR_BGR2GRAY);
+
+    if (!has_reference_) {
+        decision.reason = "no_reference";
+        return decision;
+    }
+    if (pending_gray_.size() != reference_gray_.size()) {
+        decision.reason = "size_changed";
+        return decision;
+    }
+
+    cv::absdiff(pending_gray_, reference_gray_, diff_);
+    decision.motion = cv::mean(diff_)[0];
+    cv::threshold(diff_, diff_, options_.pixelDelta, 255, cv::THRESH_BINARY);
+    decision.changedFraction = static_cast<double>(cv::countNonZero(diff_)) / diff_.total();
+    decision.greenRatioDelta = std::abs(pending_green_ratio_ - reference_green_ratio_);
+
+    if (options_.refreshInterval > 0 && frames_since_analysis_ >= options_.refreshInterval) {
+        decision.reason = "forced_refresh";
+    } else if (decision.motion > options_.motionThreshold) {
+        decision.reason = "motion";
+    } else if (decision.changedFraction > options_.changedPixelThreshold) {
+        decision.reason = "pixel_change";
+    } else if (decision.greenRatioDelta > options_.greenRatioThreshold) {
+        decision.reason = "green_ratio_change";
+    } else {
+        decision.analyze = false;
+        decision.reason = "static";
+        frames_since_analysis_++;
+    }
+    return decision;
+}
+
+void FrameGate::markAnalyzed() {
+    if (pending_gray_.empty()) return;
+    reference_gray_ = pending_gray_;
+    pending_gray_ = cv::Mat();
+    reference_green_ratio_ = pending_green_ratio_;
+    has_reference_ = true;
+    frames_since_analysis_ = 0;
+}
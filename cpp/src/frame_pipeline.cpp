@@ -0,0 +1,104 @@
+#include "frame_pipeline.hpp"
+#include <iostream>
+
+namespace {
+// Consecutive failed reads before the source is closed and reopened
+constexpr int REOPEN_AFTER_FAILURES = 50;
+}
+
+FrameGrabber::~FrameGrabber() {
+    stop();
+}
+
+bool FrameGrabber::start(int camera_id, const CaptureOptions& options) {
+    stop();
+    camera_id_ = camera_id;
+    url_.clear();
+    options_ = options;
+    if (!open()) return false;
+    running_ = true;
+    thread_ = std::thread(&FrameGrabber::captureLoop, this);
+    return true;
+}
+
+bool FrameGrabber::start(const std::string& url, const CaptureOptions& options) {
+    stop();
+    camera_id_ = -1;
+    url_ = url;
+    options_ = options;
+    if (!open()) return false;
+    running_ = true;
+    thread_ = std::thread(&FrameGrabber::captureLoop, this);
+    return true;
+}
+
+void FrameGrabber::stop() {
+    running_ = false;
+    frame_cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    capture_.release();
+}
+
+bool FrameGrabber::open() {
+    return openCapture(capture_, camera_id_, url_, options_);
+}
+
+void FrameGrabber::captureLoop() {
+    int failures = 0;
+    while (running_) {
+        // A fresh Mat per read: the previous one may still be in use downstream
+        cv::Mat frame;
+        if (!capture_.read(frame) || frame.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++stats_.read_errors;
+            }
+            if (++failures >= REOPEN_AFTER_FAILURES) {
+                std::cerr << "FrameGrabber: source stalled, reopening" << std::endl;
+                failures = 0;
+                bool reopened = open();
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++stats_.reopens;
+                if (!reopened) {
+                    std::cerr << "FrameGrabber: reopen failed" << std::endl;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            continue;
+        }
+        failures = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!taken_) {
+                ++stats_.dropped;
+            }
+            latest_ = frame;
+            ++sequence_;
+            taken_ = false;
+            captured_at_ = std::chrono::steady_clock::now();
+            ++stats_.grabbed;
+        }
+        frame_cv_.notify_one();
+    }
+}
+
+bool FrameGrabber::latest(cv::Mat& frame, uint64_t& sequence, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!frame_cv_.wait_for(lock, timeout, [&]() { return sequence_ > sequence || !running_; }) ||
+        sequence_ <= sequence) {
+        return false;
+    }
+    frame = latest_;
+    sequence = sequence_;
+    taken_ = true;
+    stats_.frame_age_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - captured_at_).count();
+    return true;
+}
+
+FrameGrabber::Stats FrameGrabber::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
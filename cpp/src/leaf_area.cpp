@@ -1,12 +1,18 @@
 #include "leaf_area.hpp"
 #include "morphology_analysis.hpp"
+#include "plant_tracker.hpp"
+#include "scratch_pool.hpp"
+#include "skeleton.hpp"
+#include "stage_metrics.hpp"
+#include "vegetation_indices.hpp"
 #include <opencv2/opencv.hpp>
-#include <map>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
 #include <cmath>
 #include <algorithm>
+#include <iostream>
+#include <numeric>
 
 using namespace PlantVision::Morphology;
 
@@ -69,57 +75,160 @@ static std::string getCurrentTimestamp() {
     return ss.str();
 }
 
+// Split touching plants: distance-transform peaks seed a watershed over the mask,
+// then each region's contour is traced inside its own bounding box.
 static void watershedInstances(const cv::Mat &mask, std::vector<std::vector<cv::Point>> &instances) {
+    STAGE_TIMER("segmentation");
     if (mask.empty()) return;
-    cv::Mat dist;
+    // Frame-sized float and label planes the pool does not cover; create() reuses them while the size holds
+    thread_local cv::Mat dist, dist8u, seeds, components, markers, mask3c;
     cv::distanceTransform(mask, dist, cv::DIST_L2, 3);
     cv::normalize(dist, dist, 0, 1.0, cv::NORM_MINMAX);
     cv::threshold(dist, dist, 0.4, 1.0, cv::THRESH_BINARY);
-    cv::Mat dist8u;
     dist.convertTo(dist8u, CV_8U, 255);
-    std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(dist8u, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-    cv::Mat markers = cv::Mat::zeros(mask.size(), CV_32S);
-    for (int i = 0; i < static_cast<int>(contours.size()); ++i) {
-        cv::drawContours(markers, contours, i, cv::Scalar(i + 1), -1);
+
+    const int seedCount = cv::connectedComponents(dist8u, seeds, 8, CV_32S);
+    const int componentCount = cv::connectedComponents(mask, components, 8, CV_32S);
+    if (componentCount <= 1) return;
+
+    // Markers: 1 = background, 0 = plant pixels still to flood, 2.. = one label per peak
+    markers.create(mask.size(), CV_32S);
+    std::vector<char> seeded(componentCount, 0);
+    for (int y = 0; y < mask.rows; ++y) {
+        const uchar *m = mask.ptr<uchar>(y);
+        const int *s = seeds.ptr<int>(y);
+        const int *c = components.ptr<int>(y);
+        int *out = markers.ptr<int>(y);
+        for (int x = 0; x < mask.cols; ++x) {
+            if (!m[x]) {
+                out[x] = 1;
+            } else if (s[x]) {
+                out[x] = s[x] + 1;
+                seeded[c[x]] = 1;
+            } else {
+                out[x] = 0;
+            }
+        }
+    }
+
+    // Plants too small to reach the global peak threshold seed themselves
+    int labelCount = seedCount + 1;
+    std::vector<int> ownLabel(componentCount, 0);
+    for (int c = 1; c < componentCount; ++c) {
+        if (!seeded[c]) ownLabel[c] = labelCount++;
+    }
+    if (labelCount > seedCount + 1) {
+        for (int y = 0; y < mask.rows; ++y) {
+            const int *c = components.ptr<int>(y);
+            int *out = markers.ptr<int>(y);
+            for (int x = 0; x < mask.cols; ++x) {
+                if (ownLabel[c[x]]) out[x] = ownLabel[c[x]];
+            }
+        }
     }
-    cv::circle(markers, cv::Point(5,5), 3, cv::Scalar(255), -1);
-    cv::Mat mask3c; cv::cvtColor(mask, mask3c, cv::COLOR_GRAY2BGR);
+
+    cv::cvtColor(mask, mask3c, cv::COLOR_GRAY2BGR);
     cv::watershed(mask3c, markers);
-    std::map<int, std::vector<cv::Point>> idToPts;
+
+    // Per-label bounding boxes and areas in one pass over the label image
+    std::vector<cv::Point> minPt(labelCount, cv::Point(mask.cols, mask.rows));
+    std::vector<cv::Point> maxPt(labelCount, cv::Point(-1, -1));
+    std::vector<int> area(labelCount, 0);
     for (int y = 0; y < markers.rows; ++y) {
-        const int* row = markers.ptr<int>(y);
+        const int *row = markers.ptr<int>(y);
         for (int x = 0; x < markers.cols; ++x) {
-            int id = row[x];
-            if (id > 1) idToPts[id].push_back(cv::Point(x,y));
+            const int id = row[x];
+            if (id < 2 || id >= labelCount) continue;
+            area[id]++;
+            minPt[id].x = std::min(minPt[id].x, x);
+            minPt[id].y = std::min(minPt[id].y, y);
+            maxPt[id].x = std::max(maxPt[id].x, x);
+            maxPt[id].y = std::max(maxPt[id].y, y);
         }
     }
-    for (auto &kv : idToPts) {
-        std::vector<cv::Point> hull;
-        if (!kv.second.empty()) {
-            cv::convexHull(kv.second, hull);
-            if (!hull.empty()) instances.push_back(hull);
+
+    cv::Mat roiMask;
+    std::vector<std::vector<cv::Point>> roiContours;
+    for (int id = 2; id < labelCount; ++id) {
+        if (area[id] == 0) continue;
+        cv::Rect bbox(minPt[id], maxPt[id] + cv::Point(1, 1));
+        cv::compare(markers(bbox), cv::Scalar(id), roiMask, cv::CMP_EQ);
+        roiContours.clear();
+        cv::findContours(roiMask, roiContours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, bbox.tl());
+        if (roiContours.empty()) continue;
+
+        auto largest = std::max_element(roiContours.begin(), roiContours.end(),
+            [](const std::vector<cv::Point> &a, const std::vector<cv::Point> &b) {
+                return cv::contourArea(a) < cv::contourArea(b);
+            });
+        instances.push_back(std::move(*largest));
+    }
+}
+
+// Pyramid levels below this size lose seedlings entirely
+static const int MIN_PYRAMID_SIDE = 240;
+
+static std::vector<cv::Point> scaleContour(const std::vector<cv::Point> &contour, int factor) {
+    std::vector<cv::Point> scaled;
+    scaled.reserve(contour.size());
+    for (const auto &pt : contour) {
+        scaled.emplace_back(pt.x * factor + factor / 2, pt.y * factor + factor / 2);
+    }
+    return scaled;
+}
+
+// Trace each plant found on a reduced level again on the full frame. Only the scaled-up
+// box is converted and thresholded, and the dilated coarse outline keeps touching
+// plants that the watershed separated from merging back together.
+static void refineContours(const FrameContext &context, int factor,
+                           std::vector<std::vector<cv::Point>> &contours) {
+    STAGE_TIMER("refine_contours");
+    const cv::Rect frameRect(0, 0, context.bgr().cols, context.bgr().rows);
+    const int margin = 2 * factor;
+    const cv::Mat grow = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2 * factor + 1, 2 * factor + 1));
+    std::vector<std::vector<cv::Point>> roiContours;
+    for (auto &contour : contours) {
+        std::vector<cv::Point> coarse = scaleContour(contour, factor);
+        const cv::Rect box = cv::boundingRect(coarse);
+        const cv::Rect roi = cv::Rect(box.x - margin, box.y - margin, box.width + 2 * margin, box.height + 2 * margin) & frameRect;
+        if (roi.empty()) {
+            contour = std::move(coarse);
+            continue;
         }
+
+        cv::Mat guide = ScratchPool::local().zeros(roi.size(), CV_8UC1);
+        cv::fillPoly(guide, std::vector<std::vector<cv::Point>>{coarse}, cv::Scalar(255), cv::LINE_8, 0, -roi.tl());
+        cv::dilate(guide, guide, grow);
+        cv::bitwise_and(guide, context.greenMaskRegion(roi), guide);
+
+        roiContours.clear();
+        cv::findContours(guide, roiContours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, roi.tl());
+        if (roiContours.empty()) {
+            contour = std::move(coarse);
+            continue;
+        }
+        auto largest = std::max_element(roiContours.begin(), roiContours.end(),
+            [](const std::vector<cv::Point> &a, const std::vector<cv::Point> &b) {
+                return cv::contourArea(a) < cv::contourArea(b);
+            });
+        contour = std::move(*largest);
     }
 }
 
-static int countLeavesInContour(const cv::Mat &frame, const std::vector<cv::Point> &contour, bool isSprout) {
+static int countLeavesInContour(const FrameContext &frame, const std::vector<cv::Point> &contour, bool isSprout) {
+    STAGE_TIMER("count_leaves");
     if (contour.empty()) return 0;
     
-    cv::Mat mask = cv::Mat::zeros(frame.size(), CV_8UC1);
-    cv::fillPoly(mask, std::vector<std::vector<cv::Point>>{contour}, cv::Scalar(255));
+    // ROI-sized contour mask; pixels outside the contour are excluded from the leaf mask
+    cv::Rect bbox = cv::boundingRect(contour) & cv::Rect(0, 0, frame.bgr().cols, frame.bgr().rows);
+    if (bbox.width <= 0 || bbox.height <= 0) return 0;
+    ScratchPool &scratch = ScratchPool::local();
+    cv::Mat maskRoi = scratch.zeros(bbox.size(), CV_8UC1);
+    cv::fillPoly(maskRoi, std::vector<std::vector<cv::Point>>{contour}, cv::Scalar(255), cv::LINE_8, 0, -bbox.tl());
     
-    cv::Rect bbox = cv::boundingRect(contour);
-    cv::Mat roi = frame(bbox);
-    cv::Mat maskRoi = mask(bbox);
+    cv::Mat hsv = frame.hsvRegion(bbox);
     
-    cv::Mat maskedRoi;
-    roi.copyTo(maskedRoi, maskRoi);
-    
-    cv::Mat hsv;
-    cv::cvtColor(maskedRoi, hsv, cv::COLOR_BGR2HSV);
-    
-    cv::Mat leafMask;
+    cv::Mat leafMask = scratch.acquire(bbox.size(), CV_8UC1);
     if (isSprout) {
         // More sensitive detection for sprouts - broader green range
         cv::inRange(hsv, cv::Scalar(20, 30, 30), cv::Scalar(90, 255, 255), leafMask);
@@ -127,8 +236,9 @@ static int countLeavesInContour(const cv::Mat &frame, const std::vector<cv::Poin
         // Standard detection for mature plants
         cv::inRange(hsv, cv::Scalar(25, 40, 40), cv::Scalar(85, 255, 255), leafMask);
     }
+    cv::bitwise_and(leafMask, maskRoi, leafMask);
     
-    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
+    static const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
     cv::morphologyEx(leafMask, leafMask, cv::MORPH_OPEN, kernel);
     cv::morphologyEx(leafMask, leafMask, cv::MORPH_CLOSE, kernel);
     
@@ -156,83 +266,6 @@ static int countLeavesInContour(const cv::Mat &frame, const std::vector<cv::Poin
 // ========== ENHANCED MORPHOLOGICAL ANALYSIS ==========
 // Branch and tip analysis inspired by PlantCV morphology module
 
-static cv::Mat skeletonize(const cv::Mat& binaryMask) {
-    cv::Mat skeleton = cv::Mat::zeros(binaryMask.size(), CV_8UC1);
-    cv::Mat temp, eroded;
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3));
-    
-    binaryMask.copyTo(temp);
-    
-    do {
-        cv::erode(temp, eroded, element);
-        cv::Mat opening;
-        cv::morphologyEx(eroded, opening, cv::MORPH_OPEN, element);
-        cv::Mat subset = eroded - opening;
-        cv::bitwise_or(skeleton, subset, skeleton);
-        eroded.copyTo(temp);
-    } while (cv::countNonZero(temp) > 0);
-    
-    return skeleton;
-}
-
-static std::vector<cv::Point> findBranchPoints(const cv::Mat& skeleton) {
-    std::vector<cv::Point> branchPoints;
-    
-    // 3x3 kernel for neighbor counting
-    for (int y = 1; y < skeleton.rows - 1; y++) {
-        for (int x = 1; x < skeleton.cols - 1; x++) {
-            if (skeleton.at<uchar>(y, x) == 0) continue;
-            
-            // Count 8-connected neighbors
-            int neighbors = 0;
-            for (int dy = -1; dy <= 1; dy++) {
-                for (int dx = -1; dx <= 1; dx++) {
-                    if (dy == 0 && dx == 0) continue;
-                    if (skeleton.at<uchar>(y + dy, x + dx) > 0) {
-                        neighbors++;
-                    }
-                }
-            }
-            
-            // Branch points have 3 or more neighbors
-            if (neighbors >= 3) {
-                branchPoints.push_back(cv::Point(x, y));
-            }
-        }
-    }
-    
-    return branchPoints;
-}
-
-static std::vector<cv::Point> findTipPoints(const cv::Mat& skeleton) {
-    std::vector<cv::Point> tipPoints;
-    
-    // 3x3 kernel for neighbor counting
-    for (int y = 1; y < skeleton.rows - 1; y++) {
-        for (int x = 1; x < skeleton.cols - 1; x++) {
-            if (skeleton.at<uchar>(y, x) == 0) continue;
-            
-            // Count 8-connected neighbors
-            int neighbors = 0;
-            for (int dy = -1; dy <= 1; dy++) {
-                for (int dx = -1; dx <= 1; dx++) {
-                    if (dy == 0 && dx == 0) continue;
-                    if (skeleton.at<uchar>(y + dy, x + dx) > 0) {
-                        neighbors++;
-                    }
-                }
-            }
-            
-            // Tip points have exactly 1 neighbor
-            if (neighbors == 1) {
-                tipPoints.push_back(cv::Point(x, y));
-            }
-        }
-    }
-    
-    return tipPoints;
-}
-
 static double calculateSolidity(const std::vector<cv::Point>& contour) {
     if (contour.empty()) return 0.0;
     
@@ -264,21 +297,6 @@ static double calculateCompactness(double area, double perimeter) {
     return std::sqrt((4.0 * area) / M_PI) / (perimeter / M_PI);
 }
 
-static double calculateLongestPath(const cv::Mat& skeleton) {
-    std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(skeleton, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
-    
-    double maxLength = 0.0;
-    for (const auto& contour : contours) {
-        if (contour.size() < 2) continue;
-        
-        double length = cv::arcLength(contour, false);
-        maxLength = std::max(maxLength, length);
-    }
-    
-    return maxLength;
-}
-
 static double calculateAspectRatio(const cv::Rect& boundingBox) {
     if (boundingBox.height == 0) return 0.0;
     return static_cast<double>(boundingBox.width) / static_cast<double>(boundingBox.height);
@@ -315,54 +333,20 @@ static cv::Point2f calculateCentroid(const std::vector<cv::Point>& contour) {
     return cv::Point2f(moments.m10 / moments.m00, moments.m01 / moments.m00);
 }
 
-// Enhanced color analysis with vegetation indices
-static double calculateNDVI(const cv::Mat& image, const cv::Mat& mask) {
-    cv::Mat imageFloat, maskFloat;
-    image.convertTo(imageFloat, CV_32F, 1.0/255.0);
-    mask.convertTo(maskFloat, CV_32F, 1.0/255.0);
-    
-    std::vector<cv::Mat> bgr;
-    cv::split(imageFloat, bgr);
-    
-    cv::Mat nir = bgr[1];  // Use green as proxy for NIR
-    cv::Mat red = bgr[2];
-    
-    cv::Mat ndvi = (nir - red) / (nir + red + 1e-10);
-    cv::Scalar meanNDVI = cv::mean(ndvi, mask);
-    
-    return meanNDVI[0];
-}
-
-static double calculateEXG(const cv::Mat& image, const cv::Mat& mask) {
-    cv::Mat imageFloat;
-    image.convertTo(imageFloat, CV_32F, 1.0/255.0);
-    
-    std::vector<cv::Mat> bgr;
-    cv::split(imageFloat, bgr);
-    
-    cv::Mat exg = 2.0 * bgr[1] - bgr[2] - bgr[0];  // 2*G - R - B
-    cv::Scalar meanEXG = cv::mean(exg, mask);
-    
-    return meanEXG[0];
-}
-
 // Disease detection functions
-static std::vector<cv::Point> detectBrownSpots(const cv::Mat& image, const cv::Mat& mask) {
+static std::vector<cv::Point> detectBrownSpots(const cv::Mat& hsv, const cv::Mat& mask) {
+    STAGE_TIMER("detect_brown_spots");
     std::vector<cv::Point> brownSpots;
     
-    cv::Mat hsv;
-    cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
-    
     // Brown color range in HSV
-    cv::Mat brownMask;
+    cv::Mat brownMask = ScratchPool::local().acquire(hsv.size(), CV_8UC1);
     cv::inRange(hsv, cv::Scalar(5, 50, 20), cv::Scalar(15, 255, 200), brownMask);
     
     // Apply plant mask
-    cv::Mat maskedBrown;
-    cv::bitwise_and(brownMask, mask, maskedBrown);
+    cv::bitwise_and(brownMask, mask, brownMask);
     
     std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(maskedBrown, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    cv::findContours(brownMask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
     
     for (const auto& contour : contours) {
         double area = cv::contourArea(contour);
@@ -378,22 +362,19 @@ static std::vector<cv::Point> detectBrownSpots(const cv::Mat& image, const cv::M
     return brownSpots;
 }
 
-static std::vector<cv::Point> detectYellowAreas(const cv::Mat& image, const cv::Mat& mask) {
+static std::vector<cv::Point> detectYellowAreas(const cv::Mat& hsv, const cv::Mat& mask) {
+    STAGE_TIMER("detect_yellow_areas");
     std::vector<cv::Point> yellowAreas;
     
-    cv::Mat hsv;
-    cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
-    
     // Yellow color range in HSV
-    cv::Mat yellowMask;
+    cv::Mat yellowMask = ScratchPool::local().acquire(hsv.size(), CV_8UC1);
     cv::inRange(hsv, cv::Scalar(15, 50, 50), cv::Scalar(35, 255, 255), yellowMask);
     
     // Apply plant mask
-    cv::Mat maskedYellow;
-    cv::bitwise_and(yellowMask, mask, maskedYellow);
+    cv::bitwise_and(yellowMask, mask, yellowMask);
     
     std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(maskedYellow, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    cv::findContours(yellowMask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
     
     for (const auto& contour : contours) {
         double area = cv::contourArea(contour);
@@ -409,9 +390,40 @@ static std::vector<cv::Point> detectYellowAreas(const cv::Mat& image, const cv::
     return yellowAreas;
 }
 
+// Hue x saturation histogram of the masked pixels, from the HSV region the disease checks already use
+static void computeColorHistogram(const cv::Mat &hsv, const cv::Mat &mask, std::array<float, PLANT_HISTOGRAM_BINS> &histogram) {
+    histogram.fill(0.0f);
+    if (hsv.empty() || hsv.size() != mask.size()) return;
+
+    std::array<uint32_t, PLANT_HISTOGRAM_BINS> counts{};
+    uint32_t total = 0;
+    for (int y = 0; y < hsv.rows; ++y) {
+        const uchar *p = hsv.ptr<uchar>(y);
+        const uchar *m = mask.ptr<uchar>(y);
+        for (int x = 0; x < hsv.cols; ++x) {
+            if (!m[x]) continue;
+            const int hue = std::min(p[3 * x] * PLANT_HISTOGRAM_HUE_BINS / 180, PLANT_HISTOGRAM_HUE_BINS - 1);
+            const int sat = p[3 * x + 1] * PLANT_HISTOGRAM_SAT_BINS / 256;
+            counts[hue * PLANT_HISTOGRAM_SAT_BINS + sat]++;
+            total++;
+        }
+    }
+    if (total == 0) return;
+    const float scale = 1.0f / static_cast<float>(total);
+    for (int i = 0; i < PLANT_HISTOGRAM_BINS; ++i) histogram[i] = counts[i] * scale;
+}
+
 // ========== END ENHANCED ANALYSIS ==========
 
+static PlantType classifyPlantTypeGray(const cv::Mat &grayRoi, const cv::Rect &bbox, double areaPixels, double scalePxPerCm);
+
 PlantType classifyPlantType(const cv::Mat &roi, const cv::Rect &bbox, double areaPixels, double scalePxPerCm) {
+    cv::Mat gray;
+    cv::cvtColor(roi, gray, cv::COLOR_BGR2GRAY);
+    return classifyPlantTypeGray(gray, bbox, areaPixels, scalePxPerCm);
+}
+
+static PlantType classifyPlantTypeGray(const cv::Mat &grayRoi, const cv::Rect &bbox, double areaPixels, double scalePxPerCm) {
     // Primary classification based on size - smaller threshold for better accuracy
     if (areaPixels < 2500.0) {  // Reduced from 5000 to reduce false positives
         return PlantType::SPROUT;
@@ -426,9 +438,8 @@ PlantType classifyPlantType(const cv::Mat &roi, const cv::Rect &bbox, double are
     }
     
     // Advanced morphological analysis for sprout characteristics
-    cv::Mat gray, binary;
-    cv::cvtColor(roi, gray, cv::COLOR_BGR2GRAY);
-    cv::threshold(gray, binary, 0, 255, cv::THRESH_BINARY_INV + cv::THRESH_OTSU);
+    cv::Mat binary = ScratchPool::local().acquire(grayRoi.size(), CV_8UC1);
+    cv::threshold(grayRoi, binary, 0, 255, cv::THRESH_BINARY_INV + cv::THRESH_OTSU);
     
     // Find contours in the ROI
     std::vector<std::vector<cv::Point>> contours;
@@ -458,7 +469,7 @@ PlantType classifyPlantType(const cv::Mat &roi, const cv::Rect &bbox, double are
         // Check for single origin point characteristic of sprouts
         cv::Point2f bottomCenter(bbox.x + bbox.width/2.0f, bbox.y + bbox.height);
         
-        // Create skeleton to analyze branching structure
+        // Create skeleton to analyze branching structure (engine chosen by setDefaultSkeletonEngine)
         cv::Mat skeleton = skeletonize(binary);
         
         // Count connection points near the bottom (root area)
@@ -528,6 +539,12 @@ static double calculateHealthScore(const cv::Scalar &meanColor, PlantType type)
 }
 
 PlantInstance processSprout(const cv::Mat &frame, const cv::Rect &bbox, const std::vector<cv::Point> &contour, double scalePxPerCm) {
+    FrameContext context(frame);
+    return processSprout(context, bbox, contour, scalePxPerCm);
+}
+
+PlantInstance processSprout(const FrameContext &context, const cv::Rect &bbox, const std::vector<cv::Point> &contour, double scalePxPerCm) {
+    const cv::Mat &frame = context.bgr();
     PlantInstance instance;
     instance.type = PlantType::SPROUT;
     instance.boundingBox = bbox;
@@ -540,18 +557,18 @@ PlantInstance processSprout(const cv::Mat &frame, const cv::Rect &bbox, const st
     cv::Rect roi = bbox & cv::Rect(0, 0, frame.cols, frame.rows);
     if (roi.width > 0 && roi.height > 0) {
         cv::Mat roiFrame = frame(roi);
-        instance.meanColor = cv::mean(roiFrame);
-        instance.cropImage = roiFrame.clone();
+        // Kept by the tracker cache and the publisher, so its buffer returns to the pool when they let go
+        instance.cropImage = ScratchPool::shared().acquire(roi.size(), roiFrame.type());
+        roiFrame.copyTo(instance.cropImage);
 
-        // Calculate standard deviation of colors
-        cv::Mat mean, stddev;
-        cv::meanStdDev(roiFrame, mean, stddev);
-        instance.stdColor = cv::Scalar(stddev.at<double>(0), stddev.at<double>(1), stddev.at<double>(2));
+        // Mean and standard deviation of colors over the whole crop, one pass
+        VegetationStats roiStats = computeVegetationStats(roiFrame);
+        instance.meanColor = roiStats.meanBgr;
+        instance.stdColor = roiStats.stdBgr;
 
         // Create binary mask for morphological analysis
-        cv::Mat binaryMask;
-        cv::cvtColor(roiFrame, binaryMask, cv::COLOR_BGR2GRAY);
-        cv::threshold(binaryMask, binaryMask, 0, 255, cv::THRESH_BINARY + cv::THRESH_OTSU);
+        cv::Mat binaryMask = ScratchPool::local().acquire(roi.size(), CV_8UC1);
+        cv::threshold(context.grayRegion(roi), binaryMask, 0, 255, cv::THRESH_BINARY + cv::THRESH_OTSU);
         
         // ========== ENHANCED MORPHOLOGICAL ANALYSIS (PlantCV-INSPIRED) ==========
         MorphologyAnalyzer analyzer;
@@ -571,6 +588,8 @@ PlantInstance processSprout(const cv::Mat &frame, const cv::Rect &bbox, const st
         instance.tipCount = morphology.tip_points;
         instance.pathLengthCm = (scalePxPerCm > 0.0) ? (morphology.total_path_length / scalePxPerCm) : 0.0;
         instance.longestPathCm = (scalePxPerCm > 0.0) ? (morphology.longest_path / scalePxPerCm) : 0.0;
+        for (const auto &pt : morphology.branch_locations) instance.branchPoints.push_back(pt + roi.tl());
+        for (const auto &pt : morphology.tip_locations) instance.tipPoints.push_back(pt + roi.tl());
         
         // Calculate centroid
         if (morphology.centroid.x > 0 && morphology.centroid.y > 0) {
@@ -590,17 +609,20 @@ PlantInstance processSprout(const cv::Mat &frame, const cv::Rect &bbox, const st
         instance.convexity = calculateConvexity(contour);
         
         // Enhanced color analysis
-        instance.ndvi = calculateNDVI(roiFrame, binaryMask);
-        instance.exg = calculateEXG(roiFrame, binaryMask);
+        VegetationStats plantStats = computeVegetationStats(roiFrame, binaryMask);
+        instance.ndvi = plantStats.ndvi;
+        instance.exg = plantStats.exg;
         
         // Basic disease detection for sprouts
-        instance.brownSpotLocations = detectBrownSpots(roiFrame, binaryMask);
-        instance.yellowAreaLocations = detectYellowAreas(roiFrame, binaryMask);
+        cv::Mat roiHsv = context.hsvRegion(roi);
+        instance.brownSpotLocations = detectBrownSpots(roiHsv, binaryMask);
+        instance.yellowAreaLocations = detectYellowAreas(roiHsv, binaryMask);
+        computeColorHistogram(roiHsv, binaryMask, instance.colorHistogram);
         instance.brownSpotCount = static_cast<int>(instance.brownSpotLocations.size());
         instance.yellowAreaCount = static_cast<int>(instance.yellowAreaLocations.size());
     }
     
-    instance.leafCount = countLeavesInContour(frame, contour, true);
+    instance.leafCount = countLeavesInContour(context, contour, true);
     instance.petalCount = 0; // Sprouts don't have petals
     instance.budCount = 0;   // Sprouts don't have buds
     instance.fruitCount = 0; // Sprouts don't have fruits
@@ -618,6 +640,12 @@ PlantInstance processSprout(const cv::Mat &frame, const cv::Rect &bbox, const st
 }
 
 PlantInstance processPlant(const cv::Mat &frame, const cv::Rect &bbox, const std::vector<cv::Point> &contour, double scalePxPerCm) {
+    FrameContext context(frame);
+    return processPlant(context, bbox, contour, scalePxPerCm);
+}
+
+PlantInstance processPlant(const FrameContext &context, const cv::Rect &bbox, const std::vector<cv::Point> &contour, double scalePxPerCm) {
+    const cv::Mat &frame = context.bgr();
     PlantInstance instance;
     instance.type = PlantType::PLANT;
     instance.boundingBox = bbox;
@@ -630,18 +658,18 @@ PlantInstance processPlant(const cv::Mat &frame, const cv::Rect &bbox, const std
     cv::Rect roi = bbox & cv::Rect(0, 0, frame.cols, frame.rows);
     if (roi.width > 0 && roi.height > 0) {
         cv::Mat roiFrame = frame(roi);
-        instance.meanColor = cv::mean(roiFrame);
-        instance.cropImage = roiFrame.clone();
+        // Kept by the tracker cache and the publisher, so its buffer returns to the pool when they let go
+        instance.cropImage = ScratchPool::shared().acquire(roi.size(), roiFrame.type());
+        roiFrame.copyTo(instance.cropImage);
 
-        // Calculate standard deviation of colors
-        cv::Mat mean, stddev;
-        cv::meanStdDev(roiFrame, mean, stddev);
-        instance.stdColor = cv::Scalar(stddev.at<double>(0), stddev.at<double>(1), stddev.at<double>(2));
+        // Mean and standard deviation of colors over the whole crop, one pass
+        VegetationStats roiStats = computeVegetationStats(roiFrame);
+        instance.meanColor = roiStats.meanBgr;
+        instance.stdColor = roiStats.stdBgr;
 
         // Create binary mask for morphological analysis
-        cv::Mat binaryMask;
-        cv::cvtColor(roiFrame, binaryMask, cv::COLOR_BGR2GRAY);
-        cv::threshold(binaryMask, binaryMask, 0, 255, cv::THRESH_BINARY + cv::THRESH_OTSU);
+        cv::Mat binaryMask = ScratchPool::local().acquire(roi.size(), CV_8UC1);
+        cv::threshold(context.grayRegion(roi), binaryMask, 0, 255, cv::THRESH_BINARY + cv::THRESH_OTSU);
         
         // ========== COMPREHENSIVE MORPHOLOGICAL ANALYSIS (PlantCV-INSPIRED) ==========
         MorphologyAnalyzer analyzer;
@@ -661,6 +689,8 @@ PlantInstance processPlant(const cv::Mat &frame, const cv::Rect &bbox, const std
         instance.tipCount = morphology.tip_points;
         instance.pathLengthCm = (scalePxPerCm > 0.0) ? (morphology.total_path_length / scalePxPerCm) : 0.0;
         instance.longestPathCm = (scalePxPerCm > 0.0) ? (morphology.longest_path / scalePxPerCm) : 0.0;
+        for (const auto &pt : morphology.branch_locations) instance.branchPoints.push_back(pt + roi.tl());
+        for (const auto &pt : morphology.tip_locations) instance.tipPoints.push_back(pt + roi.tl());
         
         // Use skeleton analysis for stem length estimation
         instance.stemLengthCm = instance.longestPathCm;
@@ -683,17 +713,20 @@ PlantInstance processPlant(const cv::Mat &frame, const cv::Rect &bbox, const std
         instance.convexity = calculateConvexity(contour);
         
         // Enhanced color analysis with vegetation indices
-        instance.ndvi = calculateNDVI(roiFrame, binaryMask);
-        instance.exg = calculateEXG(roiFrame, binaryMask);
+        VegetationStats plantStats = computeVegetationStats(roiFrame, binaryMask);
+        instance.ndvi = plantStats.ndvi;
+        instance.exg = plantStats.exg;
         
         // Disease detection
-        instance.brownSpotLocations = detectBrownSpots(roiFrame, binaryMask);
-        instance.yellowAreaLocations = detectYellowAreas(roiFrame, binaryMask);
+        cv::Mat roiHsv = context.hsvRegion(roi);
+        instance.brownSpotLocations = detectBrownSpots(roiHsv, binaryMask);
+        instance.yellowAreaLocations = detectYellowAreas(roiHsv, binaryMask);
+        computeColorHistogram(roiHsv, binaryMask, instance.colorHistogram);
         instance.brownSpotCount = static_cast<int>(instance.brownSpotLocations.size());
         instance.yellowAreaCount = static_cast<int>(instance.yellowAreaLocations.size());
     }
     
-    instance.leafCount = countLeavesInContour(frame, contour, false);
+    instance.leafCount = countLeavesInContour(context, contour, false);
     // TODO: Implement petal, bud, and fruit detection for mature plants
     instance.petalCount = 0;
     instance.budCount = 0;
@@ -711,8 +744,91 @@ PlantInstance processPlant(const cv::Mat &frame, const cv::Rect &bbox, const std
     return instance;
 }
 
+void PlantMetricsTable::reserve(size_t count) {
+    type.reserve(count);
+    stage.reserve(count);
+    trackId.reserve(count);
+    analysisReused.reserve(count);
+    areaPixels.reserve(count);
+    areaCm2.reserve(count);
+    heightCm.reserve(count);
+    widthCm.reserve(count);
+    leafCount.reserve(count);
+    healthScore.reserve(count);
+    solidity.reserve(count);
+    circularity.reserve(count);
+    eccentricity.reserve(count);
+    compactness.reserve(count);
+    ndvi.reserve(count);
+    exg.reserve(count);
+    brownSpotCount.reserve(count);
+    yellowAreaCount.reserve(count);
+    meanB.reserve(count);
+    meanG.reserve(count);
+    meanR.reserve(count);
+    colorHistogram.reserve(count * PLANT_HISTOGRAM_BINS);
+}
+
+void PlantMetricsTable::append(const PlantInstance &instance) {
+    type.push_back(instance.type);
+    stage.push_back(instance.stage);
+    trackId.push_back(instance.trackId);
+    analysisReused.push_back(instance.analysisReused ? 1 : 0);
+    areaPixels.push_back(instance.areaPixels);
+    areaCm2.push_back(instance.areaCm2);
+    heightCm.push_back(instance.heightCm);
+    widthCm.push_back(instance.widthCm);
+    leafCount.push_back(instance.leafCount);
+    healthScore.push_back(instance.healthScore);
+    solidity.push_back(instance.solidity);
+    circularity.push_back(instance.circularity);
+    eccentricity.push_back(instance.eccentricity);
+    compactness.push_back(instance.compactness);
+    ndvi.push_back(instance.ndvi);
+    exg.push_back(instance.exg);
+    brownSpotCount.push_back(instance.brownSpotCount);
+    yellowAreaCount.push_back(instance.yellowAreaCount);
+    meanB.push_back(instance.meanColor[0]);
+    meanG.push_back(instance.meanColor[1]);
+    meanR.push_back(instance.meanColor[2]);
+    colorHistogram.insert(colorHistogram.end(), instance.colorHistogram.begin(), instance.colorHistogram.end());
+}
+
+PlantMetricsTable PlantMetricsTable::from(const std::vector<PlantInstance> &instances) {
+    PlantMetricsTable table;
+    table.reserve(instances.size());
+    for (const auto &instance : instances) table.append(instance);
+    return table;
+}
+
+// Classify a single contour and run the matching sprout/plant pipeline
+static PlantInstance analyzeInstance(const FrameContext &context, const std::vector<cv::Point> &contour, double scalePxPerCm) {
+    STAGE_TIMER("analyze_instance");
+    double area = cv::contourArea(contour);
+    cv::Rect bbox = cv::boundingRect(contour);
+    PlantType type = classifyPlantTypeGray(context.grayRegion(bbox), bbox, area, scalePxPerCm);
+
+    if (type == PlantType::SPROUT) {
+        return processSprout(context, bbox, contour, scalePxPerCm);
+    }
+    return processPlant(context, bbox, contour, scalePxPerCm);
+}
+
 PlantAnalysisResult analyzePlants(const cv::Mat &frameBgr, int thresholdValue, double scalePxPerCm) {
-    auto start_time = std::chrono::high_resolution_clock::now();
+    return analyzePlants(frameBgr, thresholdValue, scalePxPerCm, AnalysisOptions());
+}
+
+PlantAnalysisResult analyzePlants(const cv::Mat &frameBgr, int thresholdValue, double scalePxPerCm,
+                                  const AnalysisOptions &options) {
+    FrameContext context(frameBgr);
+    return analyzePlants(context, thresholdValue, scalePxPerCm, options);
+}
+
+PlantAnalysisResult analyzePlants(const FrameContext &context, int thresholdValue, double scalePxPerCm,
+                                  const AnalysisOptions &options) {
+    const cv::Mat &frameBgr = context.bgr();
+    static LatencyHistogram &analyzeHistogram = stageHistogram("analyze_plants");
+    ScopedStageTimer timer(analyzeHistogram);
     
     PlantAnalysisResult result;
     result.scalePxPerCm = scalePxPerCm;
@@ -721,86 +837,135 @@ PlantAnalysisResult analyzePlants(const cv::Mat &frameBgr, int thresholdValue, d
     if (frameBgr.empty()) return result;
 
     // Create annotated frame
-    result.annotatedFrame = frameBgr.clone();
+    result.annotatedFrame = ScratchPool::shared().acquire(frameBgr.size(), frameBgr.type());
+    frameBgr.copyTo(result.annotatedFrame);
     
-    // HSV-based green segmentation
-    cv::Mat hsv, mask, morph;
-    cv::cvtColor(frameBgr, hsv, cv::COLOR_BGR2HSV);
-    cv::inRange(hsv, cv::Scalar(25, 40, 40), cv::Scalar(85, 255, 255), mask);
-    cv::morphologyEx(mask, morph, cv::MORPH_OPEN, cv::getStructuringElement(cv::MORPH_ELLIPSE, {3,3}));
-    cv::morphologyEx(morph, morph, cv::MORPH_CLOSE, cv::getStructuringElement(cv::MORPH_ELLIPSE, {5,5}));
+    // Pyramid mode segments a reduced level; everything measured afterwards is full resolution
+    int factor = std::max(1, options.pyramidFactor);
+    while (factor > 1 && std::min(frameBgr.cols, frameBgr.rows) / factor < MIN_PYRAMID_SIDE) factor /= 2;
+    const FrameContext &segmentation = context.level(factor);
 
+    // HSV-based green segmentation (shared with VisionProcessor through the frame context)
     std::vector<std::vector<cv::Point>> contours;
-    watershedInstances(morph, contours);
+    if (options.separateTouching) {
+        watershedInstances(segmentation.greenMask(), contours);
+    } else {
+        cv::findContours(segmentation.greenMask(), contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    }
+    if (factor > 1) {
+        refineContours(context, factor, contours);
+    }
 
     // Fallback to grayscale if no contours found
     if (contours.empty()) {
-        cv::Mat gray, blurred, thresh;
-        cv::cvtColor(frameBgr, gray, cv::COLOR_BGR2GRAY);
-        cv::GaussianBlur(gray, blurred, cv::Size(5,5), 0);
-        cv::threshold(blurred, thresh, thresholdValue, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+        cv::Mat thresh = ScratchPool::local().acquire(segmentation.size(), CV_8UC1);
+        cv::GaussianBlur(segmentation.gray(), thresh, cv::Size(5,5), 0);
+        cv::threshold(thresh, thresh, thresholdValue, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
         cv::findContours(thresh, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+        for (auto &contour : contours) {
+            if (factor > 1) contour = scaleContour(contour, factor);
+        }
     }
 
-    for (const auto &contour : contours) {
-        double area = cv::contourArea(contour);
-        if (area > 50.0) {
-            cv::Rect bbox = cv::boundingRect(contour);
-            
-            // Classify and process based on type
-            PlantType type = classifyPlantType(frameBgr(bbox & cv::Rect(0, 0, frameBgr.cols, frameBgr.rows)), bbox, area, scalePxPerCm);
-            
-            PlantInstance instance;
-            if (type == PlantType::SPROUT) {
-                instance = processSprout(frameBgr, bbox, contour, scalePxPerCm);
-                result.sproutCount++;
-                
-                // Draw sprout annotation in light green
-                cv::drawContours(result.annotatedFrame, std::vector<std::vector<cv::Point>>{contour}, -1, cv::Scalar(0, 255, 100), 2);
-                cv::rectangle(result.annotatedFrame, bbox, cv::Scalar(0, 255, 100), 2);
-                cv::putText(result.annotatedFrame, "SPROUT", cv::Point(bbox.x, bbox.y - 10), 
-                          cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 255, 100), 1);
-            } else {
-                instance = processPlant(frameBgr, bbox, contour, scalePxPerCm);
-                result.plantCount++;
-                
-                // Draw plant annotation in dark green
-                cv::drawContours(result.annotatedFrame, std::vector<std::vector<cv::Point>>{contour}, -1, cv::Scalar(0, 200, 0), 2);
-                cv::rectangle(result.annotatedFrame, bbox, cv::Scalar(0, 200, 0), 2);
-                cv::putText(result.annotatedFrame, "PLANT", cv::Point(bbox.x, bbox.y - 10), 
-                          cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 200, 0), 1);
+    std::vector<std::vector<cv::Point>> candidates;
+    for (auto &contour : contours) {
+        if (cv::contourArea(contour) > 50.0) {
+            candidates.push_back(std::move(contour));
+        }
+    }
+
+    // Matched plants that look unchanged since the last frame keep their cached analysis
+    std::vector<PlantTracker::Assignment> assignments;
+    if (options.tracker) {
+        assignments = options.tracker->assign(context, candidates);
+    }
+
+    // Per-instance analysis is independent, so fan it out and keep one slot per
+    // candidate; merging afterwards in contour order keeps the output deterministic.
+    const int candidateCount = static_cast<int>(candidates.size());
+    std::vector<PlantInstance> analyzed(candidates.size());
+    std::vector<char> analyzedOk(candidates.size(), 0);
+
+    auto analyzeRange = [&](const cv::Range &range) {
+        for (int k = range.start; k < range.end; ++k) {
+            try {
+                const PlantInstance *cached = assignments.empty() ? nullptr : assignments[k].cached;
+                if (cached) {
+                    // Colour, morphology and classification are reused; the geometry is the current frame's
+                    analyzed[k] = *cached;
+                    analyzed[k].boundingBox = cv::boundingRect(candidates[k]);
+                    analyzed[k].areaPixels = cv::contourArea(candidates[k]);
+                    analyzed[k].areaCm2 = (scalePxPerCm > 0.0) ? (analyzed[k].areaPixels / (scalePxPerCm * scalePxPerCm)) : 0.0;
+                    analyzed[k].centroid = calculateCentroid(candidates[k]);
+                    analyzed[k].contour = std::move(candidates[k]);
+                    analyzed[k].analysisReused = true;
+                } else {
+                    analyzed[k] = analyzeInstance(context, candidates[k], scalePxPerCm);
+                    analyzed[k].analysisReused = false;
+                }
+                if (!assignments.empty()) {
+                    analyzed[k].trackId = assignments[k].trackId;
+                }
+                analyzedOk[k] = 1;
+            } catch (const cv::Exception &e) {
+                std::cerr << "analyzePlants: skipping instance " << k << ": " << e.what() << std::endl;
             }
-            
-            result.instances.push_back(instance);
-            result.totalAreaPixels += instance.areaPixels;
-            result.totalAreaCm2 += instance.areaCm2;
         }
+    };
+
+    if (options.workerThreads == 1 || candidateCount < 2) {
+        analyzeRange(cv::Range(0, candidateCount));
+    } else {
+        int stripes = (options.workerThreads > 0) ? std::min(options.workerThreads, candidateCount) : -1;
+        cv::parallel_for_(cv::Range(0, candidateCount), analyzeRange, stripes);
     }
-    
-    result.totalInstanceCount = static_cast<int>(result.instances.size());
-    
-    // Count sprouts and plants
-    result.sproutCount = 0;
-    result.plantCount = 0;
-    double totalHealth = 0.0;
-    for (const auto& instance : result.instances) {
+
+    if (options.tracker) {
+        options.tracker->commit(assignments, analyzed, analyzedOk);
+    }
+
+    result.instances.reserve(candidates.size());
+    result.metrics.reserve(candidates.size());
+    for (int k = 0; k < candidateCount; ++k) {
+        if (!analyzedOk[k]) continue;
+
+        PlantInstance &instance = analyzed[k];
+        const auto &contour = instance.contour;
+        const cv::Rect &bbox = instance.boundingBox;
+
         if (instance.type == PlantType::SPROUT) {
-            result.sproutCount++;
+            // Draw sprout annotation in light green
+            cv::polylines(result.annotatedFrame, contour, true, cv::Scalar(0, 255, 100), 2);
+            cv::rectangle(result.annotatedFrame, bbox, cv::Scalar(0, 255, 100), 2);
+            cv::putText(result.annotatedFrame, "SPROUT", cv::Point(bbox.x, bbox.y - 10), 
+                      cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 255, 100), 1);
         } else {
-            result.plantCount++;
+            // Draw plant annotation in dark green
+            cv::polylines(result.annotatedFrame, contour, true, cv::Scalar(0, 200, 0), 2);
+            cv::rectangle(result.annotatedFrame, bbox, cv::Scalar(0, 200, 0), 2);
+            cv::putText(result.annotatedFrame, "PLANT", cv::Point(bbox.x, bbox.y - 10), 
+                      cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 200, 0), 1);
         }
-        totalHealth += instance.healthScore;
+        
+        result.metrics.append(instance);
+        result.instances.push_back(std::move(instance));
     }
     
+    // Frame totals stream through the metric columns
+    const PlantMetricsTable &metrics = result.metrics;
+    result.totalInstanceCount = static_cast<int>(metrics.size());
+    result.sproutCount = static_cast<int>(std::count(metrics.type.begin(), metrics.type.end(), PlantType::SPROUT));
+    result.plantCount = result.totalInstanceCount - result.sproutCount;
+    result.reusedInstanceCount = static_cast<int>(std::count(metrics.analysisReused.begin(), metrics.analysisReused.end(), 1));
+    result.totalAreaPixels = std::accumulate(metrics.areaPixels.begin(), metrics.areaPixels.end(), 0.0);
+    result.totalAreaCm2 = std::accumulate(metrics.areaCm2.begin(), metrics.areaCm2.end(), 0.0);
+    
     // Calculate average health
-    if (!result.instances.empty()) {
-        result.averageHealth = totalHealth / result.instances.size();
+    if (!metrics.empty()) {
+        result.averageHealth = std::accumulate(metrics.healthScore.begin(), metrics.healthScore.end(), 0.0) / metrics.size();
     }
     
-    // Calculate processing time
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    result.processingTimeMs = duration.count();
+    result.processingTimeMs = timer.elapsedMs();
     
     return result;
 }
@@ -817,12 +982,15 @@ LeafAreaResult estimateLeafArea(const cv::Mat &frameBgr, int thresholdValue, dou
     result.contourCount = newResult.totalInstanceCount;
     result.totalLeafCount = 0;
     
-    for (const auto &instance : newResult.instances) {
-        result.perContourAreaPx.push_back(instance.areaPixels);
+    const PlantMetricsTable &metrics = newResult.metrics;
+    result.perContourAreaPx = metrics.areaPixels;
+    result.perContourLeafCount = metrics.leafCount;
+    result.totalLeafCount = std::accumulate(metrics.leafCount.begin(), metrics.leafCount.end(), 0);
+    result.perContourBBox.reserve(newResult.instances.size());
+    result.contours.reserve(newResult.instances.size());
+    for (auto &instance : newResult.instances) {
         result.perContourBBox.push_back(instance.boundingBox);
-        result.contours.push_back(instance.contour);
-        result.perContourLeafCount.push_back(instance.leafCount);
-        result.totalLeafCount += instance.leafCount;
+        result.contours.push_back(std::move(instance.contour));
     }
     
     return result;
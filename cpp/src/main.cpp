@@ -1,37 +1,41 @@
 #include <opencv2/opencv.hpp>
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
 #include <nlohmann/json.hpp>
 #include <fstream>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <unordered_map>
 
+#include "ai_frame_channel.hpp"
+#include "ai_inference.hpp"
+#include "batch_runner.hpp"
+#include "change_detector.hpp"
 #include "mqtt_client.hpp"
-// #include "config_manager.hpp"
+#include "config_manager.hpp"
+#include "config_watcher.hpp"
+#include "frame_context.hpp"
+#include "frame_gate.hpp"
+#include "frame_pipeline.hpp"
 #include "leaf_area.hpp"
+#include "output_writer.hpp"
+#include "plant_tracker.hpp"
+#include "skeleton.hpp"
+#include "stage_metrics.hpp"
+#include "telemetry_encoding.hpp"
+#include "timeseries_store.hpp"
 #include "vision_processor.hpp"
 
 using json = nlohmann::json;
 
-// Base64 encoding function
-std::string base64_encode(const unsigned char* data, size_t length) {
-    const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    std::string result;
-    int val = 0, valb = -6;
-    for (size_t i = 0; i < length; ++i) {
-        val = (val << 8) + data[i];
-        valb += 8;
-        while (valb >= 0) {
-            result.push_back(chars[(val >> valb) & 0x3F]);
-            valb -= 6;
-        }
-    }
-    if (valb > -6) result.push_back(chars[((val << 8) >> (valb + 8)) & 0x3F]);
-    while (result.size() % 4) result.push_back('=');
-    return result;
-}
-
 static int getenv_int(const char* key, int def) {
     const char* v = std::getenv(key);
     return v ? std::atoi(v) : def;
@@ -52,21 +56,17 @@ static nlohmann::json load_config_json(const std::string &path) {
     return nlohmann::json();
 }
 
-static nlohmann::json load_json_if_exists(const std::string &path) {
-    try {
-        std::ifstream f(path);
-        if (f) { nlohmann::json j; f >> j; return j; }
-    } catch (...) {}
-    return nlohmann::json();
-}
-
 template <typename T>
 static T json_get_or(const nlohmann::json &j, const char *key, const T &def) {
     try {
         if (!j.is_object()) return def;
         auto it = j.find(key);
         if (it == j.end() || it->is_null()) return def;
-        return it->get<T>();
+        if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+            // The web UI stores numbers as strings
+            if (it->is_string()) return static_cast<T>(std::stod(it->template get<std::string>()));
+        }
+        return it->template get<T>();
     } catch (...) {
         return def;
     }
@@ -84,18 +84,851 @@ static T json_get_nested_or(const nlohmann::json &j, const char *obj, const char
     }
 }
 
+static json gate_decision_json(const FrameGate::Decision &decision) {
+    return {
+        {"reason", decision.reason},
+        {"motion", decision.motion},
+        {"changed_fraction", decision.changedFraction},
+        {"green_ratio_delta", decision.greenRatioDelta},
+        {"frames_since_analysis", decision.framesSinceAnalysis}
+    };
+}
+
+// One fixed-width record per instance; the tracker id, seeded from the store, is the stable key for growth curves
+static std::vector<TimeSeriesRecord> time_series_records(const PlantMetricsTable &metrics, int64_t timestampMs, int frameNumber) {
+    std::vector<TimeSeriesRecord> records(metrics.size());
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        TimeSeriesRecord &record = records[i];
+        record.timestampMs = timestampMs;
+        record.frameNumber = static_cast<uint32_t>(std::max(0, frameNumber));
+        record.trackId = metrics.trackId[i];
+        record.type = static_cast<uint8_t>(metrics.type[i]);
+        record.stage = static_cast<uint8_t>(metrics.stage[i]);
+        record.flags = metrics.analysisReused[i] ? TimeSeriesRecord::FLAG_REUSED : 0;
+        record.leafCount = static_cast<uint16_t>(std::clamp(metrics.leafCount[i], 0, 0xFFFF));
+        record.brownSpotCount = static_cast<uint16_t>(std::clamp(metrics.brownSpotCount[i], 0, 0xFFFF));
+        record.yellowAreaCount = static_cast<uint16_t>(std::clamp(metrics.yellowAreaCount[i], 0, 0xFFFF));
+        record.areaPixels = static_cast<float>(metrics.areaPixels[i]);
+        record.areaCm2 = static_cast<float>(metrics.areaCm2[i]);
+        record.heightCm = static_cast<float>(metrics.heightCm[i]);
+        record.widthCm = static_cast<float>(metrics.widthCm[i]);
+        record.healthScore = static_cast<float>(metrics.healthScore[i]);
+        record.solidity = static_cast<float>(metrics.solidity[i]);
+        record.circularity = static_cast<float>(metrics.circularity[i]);
+        record.eccentricity = static_cast<float>(metrics.eccentricity[i]);
+        record.compactness = static_cast<float>(metrics.compactness[i]);
+        record.ndvi = static_cast<float>(metrics.ndvi[i]);
+        record.exg = static_cast<float>(metrics.exg[i]);
+        record.meanB = static_cast<float>(metrics.meanB[i]);
+        record.meanG = static_cast<float>(metrics.meanG[i]);
+        record.meanR = static_cast<float>(metrics.meanR[i]);
+    }
+    return records;
+}
+
+static std::vector<std::string> split_list(const std::string &value) {
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+// In-process counterpart of the result file ai/main.py writes, published with the frame
+static json run_native_inference(AIInferenceEngine &engine, const cv::Mat &frame, const std::string &requestId) {
+    const auto start = std::chrono::steady_clock::now();
+    json result = {{"success", true}, {"request_id", requestId}, {"mode", "native"}};
+
+    if (engine.isModelLoaded(AIInferenceEngine::ModelType::DEPTH_ESTIMATION)) {
+        AIInferenceEngine::DepthResult depth = engine.runDepthInference(frame);
+        if (depth.success) {
+            // Same scale as the Python module: relative depth normalised to 0-1, mapped onto 10-100 cm
+            const double range = depth.maxDepth - depth.minDepth;
+            const double normalised = range > 0.0 ? (cv::mean(depth.depthMap)[0] - depth.minDepth) / range : 0.0;
+            result["depth_analysis"] = {{"success", true}, {"mean_depth_cm", 10.0 + 90.0 * (1.0 - normalised)}};
+        } else {
+            result["depth_analysis"] = {{"success", false}, {"error", engine.getLastError()}};
+        }
+    }
+
+    if (engine.isModelLoaded(AIInferenceEngine::ModelType::PLANT_DETECTION)) {
+        json detections = json::array();
+        for (const auto &detection : engine.runDetection(frame)) {
+            const auto &box = detection.box;
+            detections.push_back({
+                {"bbox", {box.x, box.y, box.width, box.height}},
+                {"score", detection.score},
+                {"class_id", detection.classId}
+            });
+        }
+        result["detections"] = std::move(detections);
+    }
+
+    result["inference_ms"] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Per-camera values that config.json can change while running
+struct CameraTuning {
+    int thresholdValue = 100;
+    double scalePxPerCm = 0.0;
+    int intervalMs = 30000;
+};
+
+// Everything that differs between cameras; single-camera mode builds exactly one
+struct CameraSettings {
+    std::string id;                    // Empty in single-camera mode
+    std::string name;
+    std::string inputMode = "IMAGE";   // IMAGE, CAMERA or NETWORK
+    std::string inputPath;
+    std::string inputUrl;
+    int deviceId = 0;
+    CaptureOptions capture;            // Backend, hardware decode and format for CAMERA/NETWORK
+    CameraTuning tuning;               // Starting values, hot-reloaded afterwards
+    std::string topic;                 // Frame summary
+    std::string sproutTopic;           // Per-instance telemetry, "{id}" is replaced by the instance key
+    std::string plantTopic;
+    std::string dataDir = "/app/data";
+};
+
+// Services and settings shared by every camera in the process
+struct SharedRuntime {
+    SharedRuntime(MqttClient &client, AIInferenceEngine &aiEngine, OutputWriter &outputWriter)
+        : client(client), aiEngine(aiEngine), outputWriter(outputWriter) {}
+
+    MqttClient &client;
+    AIInferenceEngine &aiEngine;
+    OutputWriter &outputWriter;
+    bool nativeAI = false;
+    // Shared-memory handoff to ai/main.py; null when AI_TRANSPORT=file or inference is native
+    AIFrameChannel *aiChannel = nullptr;
+    int mqttQos = 0;
+    TelemetryFormat telemetryFormat = TelemetryFormat::JSON;
+    bool imageTopics = false;
+    std::string highlightMode = "full";
+    bool changeGateEnabled = false;
+    FrameGateOptions gateOptions;
+    AnalysisOptions analysisOptions;
+    bool trackingEnabled = true;
+    TrackerOptions trackerOptions;
+    // Per-plant colour/area drift; names the plants worth classifying
+    bool plantChangeEnabled = false;
+    bool plantChangeTriggersAI = false;
+    ChangeDetectorOptions plantChangeOptions;
+    // Per-instance history under <data dir>/timeseries
+    bool timeSeriesEnabled = true;
+    uint32_t timeSeriesSegmentRecords = TimeSeriesOptions().segmentRecords;
+};
+
+static std::string instance_topic(const std::string &pattern, const std::string &key) {
+    std::string topic = pattern;
+    const size_t pos = topic.find("{id}");
+    if (pos != std::string::npos) topic.replace(pos, 4, key);
+    return topic;
+}
+
+// A topic next to the telemetry one: .../{id}/telemetry -> .../{id}/image
+static std::string sibling_topic(const std::string &telemetryTopic, const std::string &leaf) {
+    static const std::string suffix = "/telemetry";
+    if (telemetryTopic.size() >= suffix.size() &&
+        telemetryTopic.compare(telemetryTopic.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        return telemetryTopic.substr(0, telemetryTopic.size() - suffix.size()) + "/" + leaf;
+    }
+    return telemetryTopic + "/" + leaf;
+}
+
+// One camera: its own grabber and publish threads, with analysis run by the shared scheduler thread
+class CameraChannel {
+public:
+    CameraChannel(CameraSettings settings, SharedRuntime &shared);
+
+    const CameraSettings &settings() const { return settings_; }
+    std::chrono::steady_clock::time_point deadline() const { return deadline_; }
+    std::string overridesPath() const { return settings_.dataDir + "/classes_overrides.json"; }
+
+    // Both are called from the config watcher thread; the next cycle picks the new values up
+    void applyTuning(const CameraTuning &tuning);
+    bool reloadOverrides();
+
+    // Capture and analyse one frame, hand it to the publish stage and schedule the next cycle
+    void runCycle();
+
+private:
+    struct PublishJob {
+        bool republishCached = false;
+        FrameGate::Decision gateDecision;
+        cv::Mat frame;
+        PlantAnalysisResult analysisResult;
+        VisionProcessor::BasicMetrics basicMetrics;
+        std::string aiRequestId;
+        json aiResult;
+        bool aiResultPending = false;   // handed to ai/main.py; the publish stage collects the answer
+        std::vector<AIInferenceEngine::Classification> diseaseResults;
+        json plantChanges;
+        json pipeline;
+    };
+
+    // Publish stage: telemetry assembly, the disk batch and MQTT, overlapping the next frame's analysis
+    void publish(PublishJob &job);
+    // Answers to earlier shared-memory requests that arrived since the last publish; never waits
+    json collectLateAIResults();
+    // Deadline pacing: a cycle starts one interval after the previous one started, however long the work took
+    void advanceDeadline();
+
+    CameraSettings settings_;
+    SharedRuntime &shared_;
+    FrameGrabber grabber_;
+    PlantTracker tracker_;
+    AnalysisOptions analysisOptions_;
+    FrameGate frameGate_;
+    ChangeDetector plantChanges_;
+    // Last disease verdict per track id, republished while drift mode skips the unchanged plant
+    struct TrackedDisease {
+        AIInferenceEngine::Classification result;
+        uint64_t lastSeen = 0;
+    };
+    std::unordered_map<int, TrackedDisease> trackedDiseases_;
+    uint64_t analysedFrames_ = 0;
+    VisionProcessor visionProcessor_;
+    std::string dimmedFramePath_;
+    ConfigSnapshot<CameraTuning> tuning_;
+    ConfigSnapshot<ClassOverrides> overrides_;
+    json cachedPayload_;
+    // Per-instance telemetry of the cached frame, re-stamped on every republish
+    struct CachedInstance {
+        std::string topic;
+        json data;
+    };
+    std::vector<CachedInstance> cachedInstances_;
+    // Requests whose answers are still out, oldest first; touched by the publish stage only
+    struct PendingAIRequest {
+        std::string id;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    std::deque<PendingAIRequest> pendingAIRequests_;
+    bool haveAnalysis_ = false;
+    uint64_t frameSequence_ = 0;
+    uint64_t cycleOverruns_ = 0;
+    std::chrono::steady_clock::time_point deadline_;
+    // Appended to by the publish stage only
+    std::unique_ptr<TimeSeriesWriter> timeSeries_;
+    // Declared last so its worker is joined before the state it publishes from goes away
+    PipelineStage<PublishJob> publishStage_;
+};
+
+CameraChannel::CameraChannel(CameraSettings settings, SharedRuntime &shared)
+    : settings_(std::move(settings)),
+      shared_(shared),
+      tracker_(shared.trackerOptions),
+      analysisOptions_(shared.analysisOptions),
+      frameGate_(shared.gateOptions),
+      plantChanges_(shared.plantChangeOptions),
+      dimmedFramePath_(settings_.dataDir + "/frame_dimmed.jpg"),
+      tuning_(settings_.tuning),
+      deadline_(std::chrono::steady_clock::now()),
+      // Two slots: one frame being published while the next is analysed
+      publishStage_(2, [this](PublishJob &job) { publish(job); }) {
+    if (shared_.trackingEnabled) {
+        analysisOptions_.tracker = &tracker_;
+    }
+    reloadOverrides();
+
+    if (shared_.timeSeriesEnabled) {
+        TimeSeriesOptions timeSeriesOptions;
+        timeSeriesOptions.directory = settings_.dataDir + "/timeseries";
+        timeSeriesOptions.segmentRecords = shared_.timeSeriesSegmentRecords;
+        timeSeries_ = std::make_unique<TimeSeriesWriter>(timeSeriesOptions);
+        if (!timeSeries_->isOpen()) {
+            timeSeries_.reset();
+        } else {
+            // Track ids are the store's instance key: a restart must not hand out ids of earlier plants
+            tracker_.seedIds(timeSeries_->maxTrackId() + 1);
+        }
+    }
+
+    // Initialize the consolidated VisionProcessor (replaces duplicate OpenCV in Python)
+    visionProcessor_.configureChangeDetection(10.0, 15.0, 0.08, 0.15);
+    visionProcessor_.setAnalysisScale(analysisOptions_.pyramidFactor);
+    visionProcessor_.setDebugMode(true, settings_.dataDir + "/debug");
+
+    // Live sources are read on their own thread, which always holds the newest frame
+    if (settings_.inputMode == "CAMERA") {
+        if (!grabber_.start(settings_.deviceId, settings_.capture)) {
+            std::cerr << "Failed to open camera " << settings_.deviceId << ". Falling back to black frame.\n";
+        }
+    } else if (settings_.inputMode == "NETWORK") {
+        if (!settings_.inputUrl.empty()) {
+            if (!grabber_.start(settings_.inputUrl, settings_.capture)) {
+                std::cerr << "Failed to open network stream at URL: " << settings_.inputUrl << "\n";
+            }
+        } else {
+            std::cerr << "INPUT_MODE=NETWORK but INPUT_URL is empty.\n";
+        }
+    }
+}
+
+void CameraChannel::applyTuning(const CameraTuning &tuning) {
+    const auto current = tuning_.load();
+    if (current->thresholdValue == tuning.thresholdValue && current->scalePxPerCm == tuning.scalePxPerCm &&
+        current->intervalMs == tuning.intervalMs) {
+        return;
+    }
+    tuning_.store(tuning);
+    std::cout << "Config reloaded" << (settings_.id.empty() ? std::string() : " for camera " + settings_.id)
+              << ": threshold " << tuning.thresholdValue << ", scale " << tuning.scalePxPerCm
+              << " px/cm, interval " << tuning.intervalMs << " ms" << std::endl;
+}
+
+bool CameraChannel::reloadOverrides() {
+    ClassOverrides overrides;
+    if (!loadClassOverrides(overridesPath(), overrides)) {
+        return false;
+    }
+    overrides_.store(std::move(overrides));
+    return true;
+}
+
+void CameraChannel::advanceDeadline() {
+    deadline_ += std::chrono::milliseconds(std::max(0, tuning_.load()->intervalMs));
+    const auto now = std::chrono::steady_clock::now();
+    if (deadline_ < now) {
+        // Overran: start the next cycle now instead of bursting to catch up
+        ++cycleOverruns_;
+        deadline_ = now;
+    }
+}
+
+void CameraChannel::runCycle() {
+    static LatencyHistogram &cycleHistogram = stageHistogram("cycle");
+    ScopedStageTimer cycleTimer(cycleHistogram);
+    cv::Mat frame;
+    {
+        STAGE_TIMER("capture");
+        if (grabber_.isRunning()) {
+            grabber_.latest(frame, frameSequence_, std::chrono::milliseconds(1000));
+        }
+        if (frame.empty()) {
+            if (settings_.inputMode == "IMAGE") {
+                frame = cv::imread(settings_.inputPath);
+            }
+            if (frame.empty()) {
+                frame = cv::Mat::zeros(480, 640, CV_8UC3);
+            }
+        }
+    }
+
+    FrameGate::Decision gateDecision;
+    if (shared_.changeGateEnabled) {
+        gateDecision = frameGate_.evaluate(frame);
+        if (!gateDecision.analyze && haveAnalysis_) {
+            PublishJob job;
+            job.republishCached = true;
+            job.gateDecision = gateDecision;
+            publishStage_.push(std::move(job));
+            advanceDeadline();
+            return;
+        }
+    }
+
+    // Colour planes are converted once per frame and shared by every stage below
+    FrameContext frameContext(frame);
+
+    // Use new plant analysis system
+    const auto tuning = tuning_.load();
+    PlantAnalysisResult analysisResult = analyzePlants(frameContext, tuning->thresholdValue, tuning->scalePxPerCm, analysisOptions_);
+    
+    // Step 1: Process basic metrics with consolidated OpenCV (replaces Python duplicate)
+    VisionProcessor::BasicMetrics basicMetrics = visionProcessor_.processBasicMetrics(frameContext);
+    
+    // Plants drifting from their own running colour histogram and area, by track id
+    ChangeDetectionMetrics plantChanges;
+    std::vector<char> plantChanged(analysisResult.instances.size(), 1);
+    if (shared_.plantChangeEnabled) {
+        STAGE_TIMER("plant_change");
+        plantChanges = plantChanges_.analyzeFrame(analysisResult.metrics);
+        for (const auto &change : plantChanges.instanceChanges) {
+            plantChanged[change.row] = change.changed;
+        }
+        if (shared_.plantChangeTriggersAI && plantChanges.changedInstanceCount > 0) {
+            basicMetrics.ai_analysis_required = true;
+        }
+    }
+    
+    // Step 2: Determine if AI analysis is needed (smart triggering)
+    bool runAIAnalysis = basicMetrics.ai_analysis_required;
+    std::string aiRequestId = "";
+    json aiResult;
+    bool aiResultPending = false;
+    std::vector<AIInferenceEngine::Classification> diseaseResults;
+    
+    if (runAIAnalysis) {
+        // Request ids are shared with ai/main.py, so they carry the camera id when several cameras run
+        aiRequestId = "req_" + (settings_.id.empty() ? std::string() : settings_.id + "_") + std::to_string(basicMetrics.frame_number);
+
+        if (shared_.nativeAI) {
+            // Runs in-process and lands in this frame's payload, no files or polling involved
+            aiResult = run_native_inference(shared_.aiEngine, frame, aiRequestId);
+        } else {
+            // Raw frame through shared memory while ai/main.py is listening. The scheduler never waits for
+            // the answer: the publish stage attaches it to this frame's payload or, when late, to a later one
+            bool handedOver = false;
+            if (shared_.aiChannel && shared_.aiChannel->ready()) {
+                VisionProcessor::AIRequestData aiRequest = visionProcessor_.generateAIRequest(frameContext, basicMetrics, false);
+                handedOver = shared_.aiChannel->submit(frame, aiRequestId, visionProcessor_.serializeAIRequest(aiRequest, aiRequestId));
+            }
+            aiResultPending = handedOver;
+
+            if (!handedOver) {
+                // Generate AI request data
+                VisionProcessor::AIRequestData aiRequest = visionProcessor_.generateAIRequest(frameContext, basicMetrics);
+                
+                // Save request for Python AI module
+                if (visionProcessor_.saveAIRequestData(aiRequest, aiRequestId)) {
+                    std::cout << "AI analysis requested (frame " << basicMetrics.frame_number << "): " 
+                             << basicMetrics.change_detection.change_reason << std::endl;
+                }
+            }
+        }
+
+        // One batched Run() covers every instance crop of the frame; with drift tracking only the changed plants
+        if (shared_.aiEngine.isModelLoaded(AIInferenceEngine::ModelType::DISEASE_DETECTION) && !analysisResult.instances.empty()) {
+            std::vector<cv::Rect> instanceBoxes;
+            std::vector<size_t> instanceRows;
+            instanceBoxes.reserve(analysisResult.instances.size());
+            instanceRows.reserve(analysisResult.instances.size());
+            for (size_t i = 0; i < analysisResult.instances.size(); ++i) {
+                if (!plantChanged[i]) continue;
+                instanceBoxes.push_back(analysisResult.instances[i].boundingBox);
+                instanceRows.push_back(i);
+            }
+            if (!instanceBoxes.empty()) {
+                std::vector<AIInferenceEngine::Classification> classified = shared_.aiEngine.runClassification(frame, instanceBoxes);
+                // Unchanged plants keep classId -1 here and get their last verdict below
+                diseaseResults.resize(analysisResult.instances.size());
+                for (size_t k = 0; k < classified.size() && k < instanceRows.size(); ++k) {
+                    diseaseResults[instanceRows[k]] = std::move(classified[k]);
+                }
+            }
+        }
+    }
+
+    // Drift mode classifies only changed plants; the rest keep the verdict of their last classification
+    if (shared_.plantChangeEnabled) {
+        ++analysedFrames_;
+        const std::vector<int> &trackIds = analysisResult.metrics.trackId;
+        diseaseResults.resize(trackIds.size());
+        for (size_t i = 0; i < trackIds.size(); ++i) {
+            if (trackIds[i] < 0) continue;
+            if (diseaseResults[i].classId >= 0) {
+                trackedDiseases_[trackIds[i]] = {diseaseResults[i], analysedFrames_};
+                continue;
+            }
+            auto it = trackedDiseases_.find(trackIds[i]);
+            if (it != trackedDiseases_.end()) {
+                diseaseResults[i] = it->second.result;
+                it->second.lastSeen = analysedFrames_;
+            }
+        }
+        // Tracks the tracker has dropped never come back
+        const uint64_t maxMissed = static_cast<uint64_t>(std::max(0, shared_.plantChangeOptions.maxMissedFrames));
+        for (auto it = trackedDiseases_.begin(); it != trackedDiseases_.end();) {
+            if (analysedFrames_ - it->second.lastSeen > maxMissed) {
+                it = trackedDiseases_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    if (shared_.changeGateEnabled) {
+        frameGate_.markAnalyzed();
+        haveAnalysis_ = true;
+    }
+
+    // Hand the frame to the publish stage and move straight on to the next capture
+    const FrameGrabber::Stats grabStats = grabber_.stats();
+    PublishJob job;
+    job.gateDecision = gateDecision;
+    job.frame = frame;
+    job.analysisResult = std::move(analysisResult);
+    job.basicMetrics = std::move(basicMetrics);
+    job.aiRequestId = std::move(aiRequestId);
+    job.aiResult = std::move(aiResult);
+    job.aiResultPending = aiResultPending;
+    job.diseaseResults = std::move(diseaseResults);
+    if (shared_.plantChangeEnabled) {
+        job.plantChanges = plantChanges_.changeSignal(plantChanges);
+    }
+    job.pipeline = {
+        {"frame_age_ms", grabStats.frame_age_ms},
+        {"frames_dropped", grabStats.dropped},
+        {"capture_errors", grabStats.read_errors},
+        {"analysis_ms", cycleTimer.elapsedMs()},
+        {"publish_ms", publishStage_.lastJobMs()},
+        {"publish_backlog", publishStage_.pending()},
+        {"cycle_overruns", cycleOverruns_}
+    };
+    publishStage_.push(std::move(job));
+
+    advanceDeadline();
+}
+
+json CameraChannel::collectLateAIResults() {
+    json late = json::array();
+    if (!shared_.aiChannel) return late;
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = pendingAIRequests_.begin(); it != pendingAIRequests_.end();) {
+        json result = shared_.aiChannel->takeResult(it->id);
+        if (!result.is_null()) {
+            late.push_back({{"request_id", it->id}, {"result", std::move(result)}});
+            it = pendingAIRequests_.erase(it);
+        } else if (now > it->deadline) {
+            std::cerr << "AI channel: no answer to " << it->id << " within " << shared_.aiChannel->timeoutMs() << " ms" << std::endl;
+            it = pendingAIRequests_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return late;
+}
+
+void CameraChannel::publish(PublishJob &job) {
+    STAGE_TIMER("publish");
+    const FrameGate::Decision &gateDecision = job.gateDecision;
+    if (job.republishCached) {
+        if (cachedPayload_.is_null()) return;
+        const int64_t timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                      std::chrono::system_clock::now().time_since_epoch()).count();
+        json payload = cachedPayload_;
+        payload["timestamp"] = timestamp;
+        payload["cached"] = true;
+        payload["gate"] = gate_decision_json(gateDecision);
+        // Late answers belong to the payload they arrived for, not to every republish of it
+        json lateAIResults = collectLateAIResults();
+        payload["vision_metrics"]["ai_analysis"].erase("late_results");
+        if (!lateAIResults.empty()) {
+            payload["vision_metrics"]["ai_analysis"]["late_results"] = std::move(lateAIResults);
+        }
+        // Consumers must not take the previous frame's readings for new ones
+        for (const char *group : {"sprouts", "plants"}) {
+            for (auto &instance : payload[group]) {
+                instance["timestamp"] = timestamp;
+                instance["cached"] = true;
+            }
+        }
+
+        // Telemetry only: crop images are unchanged and were sent with the analysed frame
+        std::vector<MqttMessage> messages;
+        messages.reserve(cachedInstances_.size() + 1);
+        for (auto &instance : cachedInstances_) {
+            instance.data["timestamp"] = timestamp;
+            instance.data["cached"] = true;
+            messages.push_back(MqttMessage::make(instance.topic, encodeTelemetry(instance.data, shared_.telemetryFormat), shared_.mqttQos));
+        }
+        messages.push_back(MqttMessage::make(settings_.topic, encodeTelemetry(payload, shared_.telemetryFormat), shared_.mqttQos));
+        shared_.client.publishBatch(messages);
+        return;
+    }
+
+    const cv::Mat &frame = job.frame;
+    PlantAnalysisResult &analysisResult = job.analysisResult;
+    const VisionProcessor::BasicMetrics &basicMetrics = job.basicMetrics;
+    const std::string &aiRequestId = job.aiRequestId;
+    json &aiResult = job.aiResult;
+    json lateAIResults = collectLateAIResults();
+    if (job.aiResultPending && shared_.aiChannel) {
+        // Usually still out: the answer then rides along with the first payload published after it arrives
+        aiResult = shared_.aiChannel->takeResult(aiRequestId);
+        if (aiResult.is_null()) {
+            pendingAIRequests_.push_back({aiRequestId, std::chrono::steady_clock::now() +
+                                                       std::chrono::milliseconds(std::max(0, shared_.aiChannel->timeoutMs()))});
+        }
+    }
+    const std::vector<AIInferenceEngine::Classification> &diseaseResults = job.diseaseResults;
+
+    // Everything this frame writes to disk goes out as one batch
+    OutputWriter::Batch outputBatch;
+    outputBatch.frame_number = basicMetrics.frame_number;
+    outputBatch.addImage(settings_.dataDir + "/frame_raw.jpg", frame);
+    outputBatch.addImage(settings_.dataDir + "/frame_annotated.jpg", analysisResult.annotatedFrame);
+
+    // Manual class overrides, parsed by the config watcher rather than per frame
+    const auto overrides = overrides_.load();
+
+    // Highlights share one dimmed copy of the annotated frame per cycle
+    cv::Mat dimmedFrame;
+    if (shared_.highlightMode != "off" && !analysisResult.instances.empty() && !analysisResult.annotatedFrame.empty()) {
+        analysisResult.annotatedFrame.convertTo(dimmedFrame, -1, 0.6, 0.0);
+        if (shared_.highlightMode == "reference") {
+            outputBatch.addImage(dimmedFramePath_, dimmedFrame);
+        }
+    }
+
+    // Each instance is serialized once per format; its data.json and legacy file share the JSON buffer, which is the MQTT payload too for JSON
+    json plants = json::array();
+    json sprouts = json::array();
+    std::vector<MqttMessage> instanceMessages;
+    std::vector<CachedInstance> cachedInstances;
+    instanceMessages.reserve(analysisResult.instances.size() * (shared_.imageTopics ? 2 : 1));
+
+    for (size_t i = 0; i < analysisResult.instances.size(); ++i) {
+        const auto &instance = analysisResult.instances[i];
+        const auto &bb = instance.boundingBox;
+        const bool isSprout = instance.type == PlantType::SPROUT;
+        cv::Rect roi = bb & cv::Rect(0, 0, frame.cols, frame.rows);
+        const int instanceNumber = instance.trackId >= 0 ? instance.trackId : static_cast<int>(i);
+        const std::string instanceKey = std::to_string(instanceNumber);
+
+        std::string instanceId = instanceKey;
+        if (instanceId.length() < 3) instanceId.insert(0, 3 - instanceId.length(), '0');
+        const std::string instanceDir = settings_.dataDir + (isSprout ? "/sprouts" : "/plants") +
+                                        "/" + instance.classification + "_" + instanceId;
+        const std::string &topicPattern = isSprout ? settings_.sproutTopic : settings_.plantTopic;
+        const std::string instanceTopic = topicPattern.empty() ? std::string() : instance_topic(topicPattern, instanceKey);
+        const std::string imageTopic = sibling_topic(instanceTopic, "image");
+    
+        // Encode the crop once: base64 inline, or kept as raw bytes for the image topic
+        std::string base64Image = "";
+        std::shared_ptr<const std::string> cropJpeg;
+        if (!instance.cropImage.empty()) {
+            STAGE_TIMER("crop_encode");
+            std::vector<uchar> buffer;
+            cv::imencode(".jpg", instance.cropImage, buffer);
+            if (shared_.imageTopics) {
+                cropJpeg = std::make_shared<const std::string>(buffer.begin(), buffer.end());
+            } else {
+                base64Image = base64Encode(buffer.data(), buffer.size());
+            }
+        }
+    
+        const std::string *overrideLabel = overrides->label(instanceNumber);
+        const std::string label = overrideLabel ? *overrideLabel : std::string("unknown");
+    
+        json instanceData = {
+            {"id", instanceNumber},
+            {"type", isSprout ? "sprout" : "plant"},
+            {"classification", instance.classification},
+            {"bbox", {bb.x, bb.y, bb.width, bb.height}},
+            {"area_pixels", instance.areaPixels},
+            {"area_cm2", instance.areaCm2},
+            {"height_cm", instance.heightCm},
+            {"width_cm", instance.widthCm},
+            {"label", label},
+            {"mean_bgr", {instance.meanColor[0], instance.meanColor[1], instance.meanColor[2]}},
+            {"leaf_count", instance.leafCount},
+            {"petal_count", instance.petalCount},
+            {"bud_count", instance.budCount},
+            {"fruit_count", instance.fruitCount},
+            {"health_score", instance.healthScore},
+            {"growth_stage", static_cast<int>(instance.stage)},
+            {"analysis_reused", instance.analysisReused},
+            {"image_format", "jpg"},
+            {"instance_directory", instanceDir},
+            {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch()).count()}
+        };
+        if (shared_.imageTopics) {
+            if (cropJpeg && !instanceTopic.empty()) {
+                instanceData["image_topic"] = imageTopic;
+            }
+        } else {
+            instanceData["raw_image_base64"] = std::move(base64Image);
+        }
+        if (i < diseaseResults.size() && diseaseResults[i].classId >= 0) {
+            instanceData["disease"] = {
+                {"class_id", diseaseResults[i].classId},
+                {"label", diseaseResults[i].label},
+                {"score", diseaseResults[i].score}
+            };
+        }
+        const bool hasRoi = roi.width > 0 && roi.height > 0;
+        if (hasRoi && shared_.highlightMode == "reference" && !dimmedFrame.empty()) {
+            instanceData["highlight"] = {
+                {"frame", dimmedFramePath_},
+                {"bbox", {roi.x, roi.y, roi.width, roi.height}}
+            };
+        }
+
+        // JSON text is only needed for the files written below
+        const SerializedTelemetry serialized = serializeTelemetry(instanceData, shared_.telemetryFormat, hasRoi);
+
+        if (hasRoi) {
+            outputBatch.addImage(instanceDir + "/crop.jpg", instance.cropImage);
+            // Highlight image: the crop pasted over the dimmed frame, composed by the writer
+            if (shared_.highlightMode == "full" && !dimmedFrame.empty()) {
+                outputBatch.addComposite(instanceDir + "/highlight.jpg", dimmedFrame, instance.cropImage, roi);
+            }
+            outputBatch.addText(instanceDir + "/data.json", serialized.json);
+            // Legacy compatibility - save to old structure
+            outputBatch.addText(settings_.dataDir + "/plant_" + std::to_string(i) + ".json", serialized.json);
+        }
+
+        // Per-instance MQTT topics
+        if (!instanceTopic.empty()) {
+            instanceMessages.push_back({instanceTopic, serialized.wire, shared_.mqttQos, false});
+            if (shared_.changeGateEnabled) {
+                // Republishes carry telemetry only; the inline crop went out with this frame
+                cachedInstances.push_back({instanceTopic, instanceData});
+                cachedInstances.back().data.erase("raw_image_base64");
+            }
+            if (cropJpeg) {
+                instanceMessages.push_back({imageTopic, std::move(cropJpeg), shared_.mqttQos, false});
+            }
+        }
+
+        // The summary embeds every instance, grouped by type
+        (isSprout ? sprouts : plants).push_back(std::move(instanceData));
+    }
+
+    // Main telemetry payload
+    OutputWriter::Stats outputStats = shared_.outputWriter.stats();
+    MqttClient::Stats mqttStats = shared_.client.stats();
+    json payload = {
+        {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch()).count()},
+        {"total_instances", analysisResult.totalInstanceCount},
+        {"sprout_count", analysisResult.sproutCount},
+        {"plant_count", analysisResult.plantCount},
+        {"reused_instances", analysisResult.reusedInstanceCount},
+        {"total_area_pixels", analysisResult.totalAreaPixels},
+        {"total_area_cm2", analysisResult.totalAreaCm2},
+        {"scale_px_per_cm", analysisResult.scalePxPerCm},
+        {"sprouts", std::move(sprouts)},
+        {"plants", std::move(plants)},
+        // Add consolidated vision metrics (replaces Python AI module basic processing)
+        {"vision_metrics", {
+            {"frame_number", basicMetrics.frame_number},
+            {"green_ratio", basicMetrics.color_analysis.green_ratio},
+            {"health_indicator", basicMetrics.color_analysis.health_indicator},
+            {"total_green_pixels", basicMetrics.color_analysis.total_green_pixels},
+            {"ndvi", basicMetrics.color_analysis.ndvi},
+            {"exg", basicMetrics.color_analysis.exg},
+            {"change_detection", {
+                {"significant_change", basicMetrics.change_detection.significant_change},
+                {"hue_change", basicMetrics.change_detection.hue_change},
+                {"saturation_change", basicMetrics.change_detection.saturation_change},
+                {"green_ratio_change", basicMetrics.change_detection.green_ratio_change},
+                {"motion_magnitude", basicMetrics.change_detection.motion_magnitude},
+                {"change_reason", basicMetrics.change_detection.change_reason}
+            }},
+            {"ai_analysis", {
+                {"required", basicMetrics.ai_analysis_required},
+                {"request_id", aiRequestId},
+                {"result", std::move(aiResult)}
+            }}
+        }},
+        {"output", {
+            {"queue_depth", outputStats.queue_depth},
+            {"batches_dropped", outputStats.batches_dropped},
+            {"write_errors", outputStats.write_errors},
+            {"write_latency_ms", outputStats.last_write_latency_ms},
+            {"io_time_ms", outputStats.last_io_time_ms}
+        }},
+        {"mqtt", {
+            {"connected", mqttStats.connected},
+            {"queued", mqttStats.queued},
+            {"inflight", mqttStats.inflight},
+            {"dropped", mqttStats.dropped},
+            {"reconnects", mqttStats.reconnects}
+        }},
+        {"pipeline", std::move(job.pipeline)},
+        {"cached", false}
+    };
+    if (shared_.changeGateEnabled) {
+        payload["gate"] = gate_decision_json(gateDecision);
+    }
+    if (!job.plantChanges.is_null()) {
+        payload["vision_metrics"]["plant_changes"] = std::move(job.plantChanges);
+    }
+    if (!lateAIResults.empty()) {
+        payload["vision_metrics"]["ai_analysis"]["late_results"] = std::move(lateAIResults);
+    }
+
+    // Cached republishes add nothing new, so only analysed frames reach the history
+    if (timeSeries_ && !analysisResult.metrics.empty()) {
+        STAGE_TIMER("timeseries_append");
+        timeSeries_->append(time_series_records(analysisResult.metrics, payload["timestamp"].get<int64_t>(), basicMetrics.frame_number));
+    }
+
+    shared_.outputWriter.submit(std::move(outputBatch));
+
+    // The whole frame goes to the broker as one batch: instances, then the summary
+    std::vector<MqttMessage> frameMessages(std::move(instanceMessages));
+    frameMessages.push_back(MqttMessage::make(settings_.topic, encodeTelemetry(payload, shared_.telemetryFormat), shared_.mqttQos));
+    shared_.client.publishBatch(frameMessages);
+
+    if (shared_.changeGateEnabled) {
+        for (const char *group : {"sprouts", "plants"}) {
+            for (auto &instance : payload[group]) instance.erase("raw_image_base64");
+        }
+        cachedPayload_ = std::move(payload);
+        cachedInstances_ = std::move(cachedInstances);
+    }
+}
+
+// Threshold, scale and interval for single-camera mode; environment variables win over config.json
+static CameraTuning legacy_tuning(const nlohmann::json &cfg) {
+    CameraTuning tuning;
+    tuning.thresholdValue = getenv_int("THRESHOLD", json_get_nested_or<int>(cfg, "processing", "threshold", 100));
+    tuning.intervalMs = getenv_int("PUBLISH_INTERVAL_MS", json_get_nested_or<int>(cfg, "processing", "publish_interval_ms", 30000));
+    tuning.scalePxPerCm = std::atof(getenv_str("SCALE_PX_PER_CM", std::to_string(json_get_nested_or<double>(cfg, "processing", "scale_px_per_cm", 0.0)).c_str()).c_str());
+    return tuning;
+}
+
+// On reload config.json wins: environment variables only seed the startup values, which stay in
+// effect for keys the file does not set
+static CameraTuning reloaded_tuning(const nlohmann::json &cfg, const CameraTuning &startup) {
+    CameraTuning tuning;
+    tuning.thresholdValue = json_get_nested_or<int>(cfg, "processing", "threshold", startup.thresholdValue);
+    tuning.intervalMs = json_get_nested_or<int>(cfg, "processing", "publish_interval_ms", startup.intervalMs);
+    tuning.scalePxPerCm = json_get_nested_or<double>(cfg, "processing", "scale_px_per_cm", startup.scalePxPerCm);
+    return tuning;
+}
+
+static CaptureOptions legacy_capture(const nlohmann::json &cfg) {
+    const CaptureOptions defaults;
+    auto text = [&cfg](const char *env, const char *key, const std::string &def) {
+        return getenv_str(env, json_get_nested_or<std::string>(cfg, "capture", key, def).c_str());
+    };
+    CaptureOptions capture;
+    capture.backend = text("CAPTURE_BACKEND", "backend", defaults.backend);
+    capture.hw_decoder = text("CAPTURE_HW_DECODER", "hw_decoder", defaults.hw_decoder);
+    capture.hw_acceleration = text("CAPTURE_HW_ACCELERATION", "hw_acceleration", defaults.hw_acceleration);
+    capture.codec = text("CAPTURE_CODEC", "codec", defaults.codec);
+    capture.fourcc = text("CAPTURE_FOURCC", "fourcc", defaults.fourcc);
+    capture.pipeline = text("CAPTURE_PIPELINE", "pipeline", defaults.pipeline);
+    capture.width = getenv_int("CAPTURE_WIDTH", json_get_nested_or<int>(cfg, "capture", "width", defaults.width));
+    capture.height = getenv_int("CAPTURE_HEIGHT", json_get_nested_or<int>(cfg, "capture", "height", defaults.height));
+    capture.fps = getenv_int("CAPTURE_FPS", json_get_nested_or<int>(cfg, "capture", "fps", defaults.fps));
+    capture.latency_ms = getenv_int("CAPTURE_LATENCY_MS", json_get_nested_or<int>(cfg, "capture", "latency_ms", defaults.latency_ms));
+    return capture;
+}
+
 // Function declarations
-int runLegacyMode(const nlohmann::json& cfg, int cameraId, int thresholdValue, int intervalMs,
-                 const std::string& mqttHost, int mqttPort, double scalePxPerCm,
+int runLegacyMode(const nlohmann::json& cfg, const std::string& configPath, int cameraId, const CameraTuning& tuning,
+                 const std::string& mqttHost, int mqttPort,
                  const std::string& inputMode, const std::string& inputPath, 
                  const std::string& inputUrl, const std::string& topic);
+int runMultiCamera(const std::string& configPath);
+int runBatchMode(const nlohmann::json& cfg, const CameraTuning& tuning, const std::string& inputPath,
+                 const std::string& mqttHost, int mqttPort, const std::string& topic);
 
 // int runWithConfigManager(const CameraConfig& cameraConfig, const ProcessingConfig& processingConfig, const MQTTConfig& mqttConfig);
 
 int main() {
+    // Before any grabber thread exists
+    configureCaptureEnvironment();
+
     // Initialize configuration manager
     std::string config_path = getenv_str("CONFIG_PATH", "/app/data/config.json");
     
+    // Multi-camera: one process serves every entry of "cameras"
+    if (getenv_int("MULTI_CAMERA", json_get_or<int>(load_config_json(config_path), "multi_camera", 0)) != 0) {
+        return runMultiCamera(config_path);
+    }
+
     // Force legacy mode for testing
     // if (!g_config_manager->loadConfig(config_path)) {
         std::cout << "Using legacy configuration..." << std::endl;
@@ -104,11 +937,9 @@ int main() {
         auto cfg = load_config_json(config_path);
         
         int cameraId = getenv_int("CAMERA_ID", json_get_or<int>(cfg, "camera_id", 0));
-        int thresholdValue = getenv_int("THRESHOLD", json_get_nested_or<int>(cfg, "processing", "threshold", 100));
-        int intervalMs = getenv_int("PUBLISH_INTERVAL_MS", json_get_nested_or<int>(cfg, "processing", "publish_interval_ms", 30000));
+        const CameraTuning tuning = legacy_tuning(cfg);
         std::string mqttHost = getenv_str("MQTT_HOST", json_get_nested_or<std::string>(cfg, "mqtt", "host", std::string("localhost")).c_str());
         int mqttPort = getenv_int("MQTT_PORT", json_get_nested_or<int>(cfg, "mqtt", "port", 1883));
-        double scalePxPerCm = std::atof(getenv_str("SCALE_PX_PER_CM", std::to_string(json_get_nested_or<double>(cfg, "processing", "scale_px_per_cm", 0.0)).c_str()).c_str());
         std::string inputMode = getenv_str("INPUT_MODE", json_get_nested_or<std::string>(cfg, "processing", "input_mode", std::string("IMAGE")).c_str());
         std::string inputPath = getenv_str("INPUT_PATH", json_get_nested_or<std::string>(cfg, "processing", "input_path", std::string("/samples/plant.jpg")).c_str());
         std::string inputUrl = getenv_str("INPUT_URL", json_get_nested_or<std::string>(cfg, "processing", "input_url", std::string("")).c_str());
@@ -148,8 +979,11 @@ int main() {
             topic = std::string("plantvision/") + room + "/" + area + "/" + camIdStr + "/" + plant + "/telemetry";
         }
         
-        return runLegacyMode(cfg, cameraId, thresholdValue, intervalMs, mqttHost, mqttPort, 
-                           scalePxPerCm, inputMode, inputPath, inputUrl, topic);
+        if (inputMode == "BATCH") {
+            return runBatchMode(cfg, tuning, inputPath, mqttHost, mqttPort, topic);
+        }
+        return runLegacyMode(cfg, config_path, cameraId, tuning, mqttHost, mqttPort,
+                           inputMode, inputPath, inputUrl, topic);
     // }
     
     /*
@@ -184,259 +1018,383 @@ int main() {
     */
 }
 
-// Legacy mode function for backward compatibility
-int runLegacyMode(const nlohmann::json& cfg, int cameraId, int thresholdValue, int intervalMs,
-                 const std::string& mqttHost, int mqttPort, double scalePxPerCm,
-                 const std::string& inputMode, const std::string& inputPath, 
-                 const std::string& inputUrl, const std::string& topic) {
+// Re-reads the camera list after config.json changed; false while the file is unreadable
+using CameraReloader = std::function<bool(std::vector<CameraSettings>&)>;
 
-    cv::VideoCapture cap;
-    if (inputMode == "CAMERA") {
-        cap.open(cameraId);
-        if (!cap.isOpened()) {
-            std::cerr << "Failed to open camera " << cameraId << ". Falling back to black frame.\n";
+// Shared services for every camera, then an earliest-deadline-first loop over their cycles
+static int runCameras(const nlohmann::json& cfg, const std::string& mqttHost, int mqttPort,
+                      const std::vector<CameraSettings>& cameras,
+                      const std::string& configPath, const CameraReloader& reloadCameras) {
+    // Publishing only enqueues; the client's network thread keeps the session alive and reconnects
+    MqttClientOptions mqttOptions;
+    mqttOptions.client_id = getenv_str("MQTT_CLIENT_ID", json_get_nested_or<std::string>(cfg, "mqtt", "client_id", std::string("plantvision-client")).c_str());
+    mqttOptions.keepalive_sec = getenv_int("MQTT_KEEPALIVE_SEC", json_get_nested_or<int>(cfg, "mqtt", "keepalive_sec", mqttOptions.keepalive_sec));
+    mqttOptions.max_queued_messages = static_cast<size_t>(std::max(1, getenv_int("MQTT_QUEUE_MAX", json_get_nested_or<int>(cfg, "mqtt", "queue_max", static_cast<int>(mqttOptions.max_queued_messages)))));
+    const int mqttQos = getenv_int("MQTT_QOS", json_get_nested_or<int>(cfg, "mqtt", "qos", 0));
+    // Payload encoding and whether crops are inlined as base64 or sent as raw JPEG on <instance>/image
+    const TelemetryFormat telemetryFormat = parseTelemetryFormat(
+        getenv_str("TELEMETRY_FORMAT", json_get_nested_or<std::string>(cfg, "mqtt", "telemetry_format", std::string("json")).c_str()));
+    const bool imageTopics = getenv_str("IMAGE_TRANSPORT", json_get_nested_or<std::string>(cfg, "mqtt", "image_transport", std::string("inline")).c_str()) == "topic";
+    std::cout << "Telemetry format: " << telemetryFormatName(telemetryFormat)
+              << ", crops " << (imageTopics ? "on image topics" : "inline base64") << std::endl;
+    MqttClient client(mqttHost, mqttPort, mqttOptions);
+    if (!client.connect()) {
+        std::cerr << "Failed to connect to MQTT broker at " << mqttHost << ":" << mqttPort << ", retrying in background\n";
+    }
+
+    // Per-instance analysis fans out over OpenCV's worker pool
+    AnalysisOptions analysisOptions;
+    analysisOptions.workerThreads = getenv_int("ANALYSIS_THREADS", json_get_nested_or<int>(cfg, "processing", "analysis_threads", 0));
+    analysisOptions.separateTouching = getenv_int("WATERSHED_ENABLED", json_get_nested_or<int>(cfg, "processing", "watershed_enabled", 1)) != 0;
+    // Segmentation and motion on a reduced level, per-plant measurements at full resolution
+    analysisOptions.pyramidFactor = getenv_int("ANALYSIS_PYRAMID", json_get_nested_or<int>(cfg, "processing", "pyramid_factor", 1));
+    if (analysisOptions.workerThreads > 0) {
+        cv::setNumThreads(analysisOptions.workerThreads);
+    }
+    // Thinning engine used by plant classification and morphology analysis
+    PlantVision::Morphology::setDefaultSkeletonEngine(PlantVision::Morphology::parseSkeletonEngine(
+        getenv_str("SKELETON_ENGINE", json_get_nested_or<std::string>(cfg, "processing", "skeleton_engine", std::string("zhang-suen")).c_str())));
+    std::cout << "Skeleton engine: "
+              << PlantVision::Morphology::skeletonEngineName(PlantVision::Morphology::defaultSkeletonEngine()) << std::endl;
+
+    // Stable plant ids across frames; unchanged plants reuse last frame's analysis
+    TrackerOptions trackerOptions;
+    trackerOptions.maxMissedFrames = getenv_int("TRACK_MAX_MISSED", json_get_nested_or<int>(cfg, "processing", "track_max_missed", trackerOptions.maxMissedFrames));
+    trackerOptions.refreshInterval = getenv_int("TRACK_REFRESH_FRAMES", json_get_nested_or<int>(cfg, "processing", "track_refresh_frames", trackerOptions.refreshInterval));
+    trackerOptions.maxAppearanceDelta = std::atof(getenv_str("TRACK_REUSE_DELTA", std::to_string(json_get_nested_or<double>(cfg, "processing", "track_reuse_delta", trackerOptions.maxAppearanceDelta)).c_str()).c_str());
+    const bool trackingEnabled = getenv_int("TRACKING_ENABLED", json_get_nested_or<int>(cfg, "processing", "tracking_enabled", 1)) != 0;
+
+    std::cout << "Instance analysis threads: "
+              << (analysisOptions.workerThreads > 0 ? analysisOptions.workerThreads : cv::getNumThreads()) << std::endl;
+
+    // Native ONNX Runtime inference; the file/signal handoff to ai/main.py is only the fallback
+    const std::string aiInferenceMode = getenv_str("AI_INFERENCE", json_get_nested_or<std::string>(cfg, "ai", "inference", std::string("auto")).c_str());
+    InferenceOptions inferenceOptions;
+    inferenceOptions.intraOpThreads = getenv_int("AI_INTRA_OP_THREADS", json_get_nested_or<int>(cfg, "ai", "intra_op_threads", inferenceOptions.intraOpThreads));
+    inferenceOptions.graphOptimization = getenv_str("AI_GRAPH_OPTIMIZATION", json_get_nested_or<std::string>(cfg, "ai", "graph_optimization", inferenceOptions.graphOptimization).c_str());
+    inferenceOptions.executionProviders = split_list(getenv_str("AI_EXECUTION_PROVIDERS", json_get_nested_or<std::string>(cfg, "ai", "execution_providers", std::string("")).c_str()));
+    inferenceOptions.deviceId = getenv_int("AI_DEVICE_ID", json_get_nested_or<int>(cfg, "ai", "device_id", 0));
+    inferenceOptions.warmupRuns = getenv_int("AI_WARMUP_RUNS", json_get_nested_or<int>(cfg, "ai", "warmup_runs", inferenceOptions.warmupRuns));
+    // One engine keeps every model resident on a shared ONNX Runtime environment
+    AIInferenceEngine aiEngine(inferenceOptions);
+    bool nativeAI = false;
+    if (aiInferenceMode != "file" && aiEngine.isOnnxRuntimeAvailable()) {
+        // Empty paths resolve to the model cache in /app/models
+        // MiDaS small: RGB scaled to 0-1, NCHW 256x256
+        AIInferenceEngine::ModelConfig depthConfig;
+        depthConfig.modelPath = getenv_str("AI_DEPTH_MODEL", json_get_nested_or<std::string>(cfg, "ai", "depth_model", std::string("")).c_str());
+        depthConfig.inputShape = {1, 3, 256, 256};
+        depthConfig.meanValue = 0.0f;
+        depthConfig.scaleValue = 1.0f / 255.0f;
+        if (!aiEngine.loadModel(AIInferenceEngine::ModelType::DEPTH_ESTIMATION, depthConfig)) {
+            std::cerr << "Native depth model unavailable: " << aiEngine.getLastError() << std::endl;
         }
-    } else if (inputMode == "NETWORK") {
-        if (!inputUrl.empty()) {
-            cap.open(inputUrl);
-            if (!cap.isOpened()) {
-                std::cerr << "Failed to open network stream at URL: " << inputUrl << "\n";
-            }
-        } else {
-            std::cerr << "INPUT_MODE=NETWORK but INPUT_URL is empty.\n";
+
+        // YOLOv5-style detector: RGB scaled to 0-1, NCHW 640x640
+        AIInferenceEngine::ModelConfig detectionConfig;
+        detectionConfig.modelPath = getenv_str("AI_DETECTION_MODEL", json_get_nested_or<std::string>(cfg, "ai", "detection_model", std::string("")).c_str());
+        detectionConfig.inputShape = {1, 3, 640, 640};
+        detectionConfig.meanValue = 0.0f;
+        detectionConfig.scaleValue = 1.0f / 255.0f;
+        if (!aiEngine.loadModel(AIInferenceEngine::ModelType::PLANT_DETECTION, detectionConfig)) {
+            std::cerr << "Native detection model unavailable: " << aiEngine.getLastError() << std::endl;
+        }
+
+        // Per-instance disease classifier: every instance crop of a frame goes through one batched Run()
+        AIInferenceEngine::ModelConfig diseaseConfig;
+        diseaseConfig.modelPath = getenv_str("AI_DISEASE_MODEL", json_get_nested_or<std::string>(cfg, "ai", "disease_model", std::string("")).c_str());
+        diseaseConfig.inputShape = {1, 3, 224, 224};
+        diseaseConfig.classLabels = split_list(getenv_str("AI_DISEASE_LABELS", json_get_nested_or<std::string>(cfg, "ai", "disease_labels", std::string("")).c_str()));
+        diseaseConfig.maxBatchSize = getenv_int("AI_MAX_BATCH", json_get_nested_or<int>(cfg, "ai", "max_batch", diseaseConfig.maxBatchSize));
+        if (!aiEngine.loadModel(AIInferenceEngine::ModelType::DISEASE_DETECTION, diseaseConfig)) {
+            std::cerr << "Native disease model unavailable: " << aiEngine.getLastError() << std::endl;
         }
+
+        nativeAI = aiEngine.isModelLoaded(AIInferenceEngine::ModelType::DEPTH_ESTIMATION) ||
+                   aiEngine.isModelLoaded(AIInferenceEngine::ModelType::PLANT_DETECTION);
     }
 
-    MqttClient client(mqttHost, mqttPort);
-    if (!client.connect()) {
-        std::cerr << "Failed to connect to MQTT broker at " << mqttHost << ":" << mqttPort << "\n";
+    // Without native models, frames go to ai/main.py through shared memory; files remain the fallback
+    const std::string aiTransport = getenv_str("AI_TRANSPORT", json_get_nested_or<std::string>(cfg, "ai", "transport", std::string("shm")).c_str());
+    std::unique_ptr<AIFrameChannel> aiChannel;
+    if (!nativeAI && aiTransport == "shm") {
+        AIChannelOptions channelOptions;
+        channelOptions.socketPath = getenv_str("AI_IPC_SOCKET", json_get_nested_or<std::string>(cfg, "ai", "ipc_socket", channelOptions.socketPath).c_str());
+        channelOptions.shmName = getenv_str("AI_SHM_NAME", json_get_nested_or<std::string>(cfg, "ai", "shm_name", channelOptions.shmName).c_str());
+        channelOptions.slots = getenv_int("AI_SHM_SLOTS", json_get_nested_or<int>(cfg, "ai", "shm_slots", channelOptions.slots));
+        channelOptions.timeoutMs = getenv_int("AI_IPC_TIMEOUT_MS", json_get_nested_or<int>(cfg, "ai", "ipc_timeout_ms", channelOptions.timeoutMs));
+        aiChannel = std::make_unique<AIFrameChannel>(channelOptions);
     }
+    std::cout << "AI inference: " << (nativeAI ? "native ONNX Runtime"
+                                               : aiChannel ? "shared-memory handoff to the Python AI module (file fallback)"
+                                                           : "file handoff to the Python AI module") << std::endl;
 
-    // Initialize the consolidated VisionProcessor (replaces duplicate OpenCV in Python)
-    VisionProcessor visionProcessor;
-    visionProcessor.configureChangeDetection(10.0, 15.0, 0.08, 0.15);
-    visionProcessor.setDebugMode(true, "/app/data/debug");
+    // Images and JSON are written off the capture loop; the oldest pending frame is dropped when disk falls behind
+    int outputQueueDepth = getenv_int("OUTPUT_QUEUE_DEPTH", json_get_nested_or<int>(cfg, "processing", "output_queue_depth", 4));
+    int outputWriterThreads = getenv_int("OUTPUT_WRITER_THREADS", json_get_nested_or<int>(cfg, "processing", "output_writer_threads", 1));
+    OutputWriter outputWriter(static_cast<size_t>(std::max(1, outputQueueDepth)), outputWriterThreads);
+
+    // full: one highlight.jpg per instance, reference: a shared dimmed frame plus bbox, off: none
+    std::string highlightMode = getenv_str("HIGHLIGHT_MODE", json_get_nested_or<std::string>(cfg, "processing", "highlight_mode", std::string("full")).c_str());
+
+    // Static frames republish the last full result instead of being re-analysed
+    bool changeGateEnabled = getenv_int("CHANGE_GATE", json_get_nested_or<int>(cfg, "processing", "change_gate", 0)) != 0;
+    FrameGateOptions gateOptions;
+    gateOptions.refreshInterval = getenv_int("CHANGE_GATE_REFRESH_FRAMES", json_get_nested_or<int>(cfg, "processing", "change_gate_refresh_frames", gateOptions.refreshInterval));
+    gateOptions.motionThreshold = std::atof(getenv_str("CHANGE_GATE_MOTION", std::to_string(json_get_nested_or<double>(cfg, "processing", "change_gate_motion", gateOptions.motionThreshold)).c_str()).c_str());
+
+    // Per-plant drift: off, baseline (frame averages against the first frame) or drift (running averages per plant)
+    const std::string plantChangeMode = getenv_str("PLANT_CHANGE_MODE", json_get_nested_or<std::string>(cfg, "processing", "plant_change_mode", std::string("off")).c_str());
+    ChangeDetectorOptions plantChangeOptions;
+    plantChangeOptions.mode = plantChangeMode == "baseline" ? ChangeDetectionMode::BASELINE : ChangeDetectionMode::DRIFT;
+    plantChangeOptions.emaAlpha = std::atof(getenv_str("PLANT_CHANGE_ALPHA", std::to_string(json_get_nested_or<double>(cfg, "processing", "plant_change_alpha", plantChangeOptions.emaAlpha)).c_str()).c_str());
+    plantChangeOptions.histogramThreshold = std::atof(getenv_str("PLANT_CHANGE_HIST_THRESHOLD", std::to_string(json_get_nested_or<double>(cfg, "processing", "plant_change_hist_threshold", plantChangeOptions.histogramThreshold)).c_str()).c_str());
+    plantChangeOptions.areaThreshold = std::atof(getenv_str("PLANT_CHANGE_AREA_THRESHOLD", std::to_string(json_get_nested_or<double>(cfg, "processing", "plant_change_area_threshold", plantChangeOptions.areaThreshold)).c_str()).c_str());
+    plantChangeOptions.maxMissedFrames = trackerOptions.maxMissedFrames;
+    const bool plantChangeTriggersAI = getenv_int("PLANT_CHANGE_AI", json_get_nested_or<int>(cfg, "processing", "plant_change_ai", 0)) != 0;
+
+    // Append-only per-instance history for growth curves, queried with plantvision_tsq
+    const bool timeSeriesEnabled = getenv_int("TIMESERIES", json_get_nested_or<int>(cfg, "processing", "timeseries", 1)) != 0;
+    const int timeSeriesSegmentRecords = getenv_int("TIMESERIES_SEGMENT_RECORDS", json_get_nested_or<int>(cfg, "processing", "timeseries_segment_records",
+                                                    static_cast<int>(TimeSeriesOptions().segmentRecords)));
+
+    SharedRuntime shared(client, aiEngine, outputWriter);
+    shared.nativeAI = nativeAI;
+    shared.aiChannel = aiChannel.get();
+    shared.mqttQos = mqttQos;
+    shared.telemetryFormat = telemetryFormat;
+    shared.imageTopics = imageTopics;
+    shared.highlightMode = highlightMode;
+    shared.changeGateEnabled = changeGateEnabled;
+    shared.gateOptions = gateOptions;
+    shared.analysisOptions = analysisOptions;
+    shared.trackingEnabled = trackingEnabled;
+    shared.trackerOptions = trackerOptions;
+    shared.plantChangeEnabled = plantChangeMode == "baseline" || plantChangeMode == "drift";
+    shared.plantChangeTriggersAI = plantChangeTriggersAI;
+    shared.plantChangeOptions = plantChangeOptions;
+    shared.timeSeriesEnabled = timeSeriesEnabled;
+    shared.timeSeriesSegmentRecords = static_cast<uint32_t>(std::max(1, timeSeriesSegmentRecords));
+
+    std::vector<std::unique_ptr<CameraChannel>> channels;
+    channels.reserve(cameras.size());
+    for (const auto &camera : cameras) {
+        channels.push_back(std::make_unique<CameraChannel>(camera, shared));
+    }
     
     std::cout << "Using consolidated VisionProcessor - OpenCV operations moved from Python to C++" << std::endl;
 
-    while (true) {
-        cv::Mat frame;
-        if ((inputMode == "CAMERA" || inputMode == "NETWORK") && cap.isOpened()) {
-            cap >> frame;
-        }
-        if (frame.empty()) {
-            if (inputMode == "IMAGE") {
-                frame = cv::imread(inputPath);
-            }
-            if (frame.empty()) {
-                frame = cv::Mat::zeros(480, 640, CV_8UC3);
-            }
-        }
+    // Per-stage latency: windowed p50/p95/p99 on <topic>/metrics, since-start summaries for Prometheus
+    const int metricsIntervalMs = getenv_int("METRICS_INTERVAL_MS", json_get_nested_or<int>(cfg, "metrics", "interval_ms", 60000));
+    const std::string metricsTopic = getenv_str("METRICS_TOPIC", json_get_nested_or<std::string>(cfg, "metrics", "topic",
+        cameras.size() == 1 && !cameras.front().topic.empty() ? sibling_topic(cameras.front().topic, "metrics") : std::string("plantvision/metrics")).c_str());
+    std::unique_ptr<MetricsReporter> metricsReporter;
+    if (metricsIntervalMs > 0 && !metricsTopic.empty()) {
+        metricsReporter = std::make_unique<MetricsReporter>(std::chrono::milliseconds(metricsIntervalMs),
+            [&client, metricsTopic, telemetryFormat, mqttQos](const std::vector<StageSummary> &stages, double windowMs) {
+                json stageJson = json::object();
+                for (const auto &stage : stages) {
+                    stageJson[stage.stage] = {
+                        {"count", stage.count},
+                        {"mean_ms", stage.mean_ms},
+                        {"p50_ms", stage.p50_ms},
+                        {"p95_ms", stage.p95_ms},
+                        {"p99_ms", stage.p99_ms},
+                        {"max_ms", stage.max_ms}
+                    };
+                }
+                json metrics = {
+                    {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
+                                      std::chrono::system_clock::now().time_since_epoch()).count()},
+                    {"window_ms", windowMs},
+                    {"stages", std::move(stageJson)}
+                };
+                client.publish(metricsTopic, encodeTelemetry(metrics, telemetryFormat), mqttQos);
+            });
+    }
+    const int metricsPort = getenv_int("METRICS_PORT", json_get_nested_or<int>(cfg, "metrics", "port", 0));
+    MetricsHttpServer metricsServer;
+    if (metricsPort > 0 && metricsServer.start(metricsPort)) {
+        std::cout << "Prometheus metrics on :" << metricsPort << "/metrics" << std::endl;
+    }
 
-        // Use new plant analysis system
-        PlantAnalysisResult analysisResult = analyzePlants(frame, thresholdValue, scalePxPerCm);
-        
-        // Step 1: Process basic metrics with consolidated OpenCV (replaces Python duplicate)
-        VisionProcessor::BasicMetrics basicMetrics = visionProcessor.processBasicMetrics(frame);
-        
-        // Step 2: Determine if AI analysis is needed (smart triggering)
-        bool runAIAnalysis = basicMetrics.ai_analysis_required;
-        std::string aiRequestId = "";
-        
-        if (runAIAnalysis) {
-            // Generate AI request data
-            VisionProcessor::AIRequestData aiRequest = visionProcessor.generateAIRequest(frame, basicMetrics);
-            aiRequestId = "req_" + std::to_string(basicMetrics.frame_number);
-            
-            // Save request for Python AI module
-            if (visionProcessor.saveAIRequestData(aiRequest, aiRequestId)) {
-                std::cout << "AI analysis requested (frame " << basicMetrics.frame_number << "): " 
-                         << basicMetrics.change_detection.change_reason << std::endl;
-            }
-        }
-        
-        // Save annotated frame
-        try {
-            cv::imwrite("/app/data/frame_raw.jpg", frame);
-            cv::imwrite("/app/data/frame_annotated.jpg", analysisResult.annotatedFrame);
-        } catch (...) {}
-
-        // Load manual class overrides
-        auto overrides = load_json_if_exists("/app/data/classes_overrides.json");
-
-        // Build payload with per-plant/sprout data
-        json plants = json::array();
-        json sprouts = json::array();
-        
-        for (size_t i = 0; i < analysisResult.instances.size(); ++i) {
-            const auto &instance = analysisResult.instances[i];
-            const auto &bb = instance.boundingBox;
-            
-            // Encode crop image as base64
-            std::string base64Image = "";
-            if (!instance.cropImage.empty()) {
-                std::vector<uchar> buffer;
-                cv::imencode(".jpg", instance.cropImage, buffer);
-                base64Image = base64_encode(buffer.data(), buffer.size());
-            }
-            
-            std::string label = "unknown";
-            try {
-                if (overrides.contains(std::to_string(i)) && overrides[std::to_string(i)].contains("label")) {
-                    label = overrides[std::to_string(i)]["label"].get<std::string>();
+    // Hot reload: config.json retunes the running cameras, each overrides file is re-parsed when it changes
+    const int reloadIntervalMs = getenv_int("CONFIG_RELOAD_MS", json_get_nested_or<int>(cfg, "processing", "config_reload_ms", 1000));
+    FileWatcher configWatcher(std::chrono::milliseconds(std::max(1, reloadIntervalMs)));
+    if (reloadIntervalMs > 0) {
+        configWatcher.watch(configPath, [&channels, &reloadCameras]() {
+            std::vector<CameraSettings> updated;
+            if (!reloadCameras(updated)) return false;
+            for (auto &channel : channels) {
+                const std::string &id = channel->settings().id;
+                auto it = std::find_if(updated.begin(), updated.end(),
+                                       [&id](const CameraSettings &camera) { return camera.id == id; });
+                if (it == updated.end()) {
+                    std::cerr << "Camera " << id << " is no longer configured; restart to stop it" << std::endl;
+                    continue;
                 }
-            } catch (...) {}
-            
-            json instanceData = {
-                {"id", static_cast<int>(i)},
-                {"type", instance.type == PlantType::SPROUT ? "sprout" : "plant"},
-                {"classification", instance.classification},
-                {"bbox", {bb.x, bb.y, bb.width, bb.height}},
-                {"area_pixels", instance.areaPixels},
-                {"area_cm2", instance.areaCm2},
-                {"height_cm", instance.heightCm},
-                {"width_cm", instance.widthCm},
-                {"label", label},
-                {"mean_bgr", {instance.meanColor[0], instance.meanColor[1], instance.meanColor[2]}},
-                {"leaf_count", instance.leafCount},
-                {"petal_count", instance.petalCount},
-                {"bud_count", instance.budCount},
-                {"fruit_count", instance.fruitCount},
-                {"health_score", instance.healthScore},
-                {"growth_stage", static_cast<int>(instance.stage)},
-                {"raw_image_base64", base64Image},
-                {"image_format", "jpg"},
-                {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
-                               std::chrono::system_clock::now().time_since_epoch()).count()}
-            };
-            
-            // Add to appropriate array
-            if (instance.type == PlantType::SPROUT) {
-                sprouts.push_back(instanceData);
-            } else {
-                plants.push_back(instanceData);
+                channel->applyTuning(it->tuning);
             }
+            return true;
+        });
+        for (auto &channel : channels) {
+            CameraChannel *camera = channel.get();
+            configWatcher.watch(camera->overridesPath(), [camera]() { return camera->reloadOverrides(); });
         }
+        configWatcher.start();
+    }
 
-        // Main telemetry payload
-        json payload = {
-            {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(
-                               std::chrono::system_clock::now().time_since_epoch()).count()},
-            {"total_instances", analysisResult.totalInstanceCount},
-            {"sprout_count", analysisResult.sproutCount},
-            {"plant_count", analysisResult.plantCount},
-            {"total_area_pixels", analysisResult.totalAreaPixels},
-            {"total_area_cm2", analysisResult.totalAreaCm2},
-            {"scale_px_per_cm", analysisResult.scalePxPerCm},
-            {"sprouts", sprouts},
-            {"plants", plants},
-            // Add consolidated vision metrics (replaces Python AI module basic processing)
-            {"vision_metrics", {
-                {"frame_number", basicMetrics.frame_number},
-                {"green_ratio", basicMetrics.color_analysis.green_ratio},
-                {"health_indicator", basicMetrics.color_analysis.health_indicator},
-                {"total_green_pixels", basicMetrics.color_analysis.total_green_pixels},
-                {"ndvi", basicMetrics.color_analysis.ndvi},
-                {"exg", basicMetrics.color_analysis.exg},
-                {"change_detection", {
-                    {"significant_change", basicMetrics.change_detection.significant_change},
-                    {"hue_change", basicMetrics.change_detection.hue_change},
-                    {"saturation_change", basicMetrics.change_detection.saturation_change},
-                    {"green_ratio_change", basicMetrics.change_detection.green_ratio_change},
-                    {"motion_magnitude", basicMetrics.change_detection.motion_magnitude},
-                    {"change_reason", basicMetrics.change_detection.change_reason}
-                }},
-                {"ai_analysis", {
-                    {"required", basicMetrics.ai_analysis_required},
-                    {"request_id", aiRequestId}
-                }}
-            }}
-        };
+    // A camera that overran restarts its schedule at "now", so cameras already waiting keep
+    // their earlier deadlines; ties go to the camera after the one that ran last
+    size_t next = 0;
+    while (true) {
+        size_t due = next;
+        for (size_t k = 1; k < channels.size(); ++k) {
+            const size_t i = (next + k) % channels.size();
+            if (channels[i]->deadline() < channels[due]->deadline()) due = i;
+        }
+        std::this_thread::sleep_until(channels[due]->deadline());
+        channels[due]->runCycle();
+        next = (due + 1) % channels.size();
+    }
 
-        // Create organized directory structure
-        std::system("mkdir -p /app/data/sprouts");
-        std::system("mkdir -p /app/data/plants");
-        
-        // Save per-instance data and publish per-instance topics
-        for (size_t i = 0; i < analysisResult.instances.size(); ++i) {
-            const auto &instance = analysisResult.instances[i];
-            const auto &bb = instance.boundingBox;
-            cv::Rect roi = bb & cv::Rect(0, 0, frame.cols, frame.rows);
-            
-            std::string instanceId = std::to_string(i);
-            instanceId = std::string(3 - instanceId.length(), '0') + instanceId;
-            
-            std::string baseDir = (instance.type == PlantType::SPROUT) ? "/app/data/sprouts" : "/app/data/plants";
-            std::string instanceDir = baseDir + "/" + instance.classification + "_" + instanceId;
-            std::system(("mkdir -p " + instanceDir).c_str());
-            
-            if (roi.width > 0 && roi.height > 0) {
-                try {
-                    // Save crop image
-                    cv::imwrite(instanceDir + "/crop.jpg", instance.cropImage);
-                    
-                    // Create highlight image
-                    cv::Mat highlight = analysisResult.annotatedFrame.clone();
-                    cv::Mat overlay = highlight.clone();
-                    cv::Mat dark(highlight.size(), highlight.type(), cv::Scalar(0,0,0));
-                    double alpha = 0.6;
-                    cv::addWeighted(overlay, alpha, dark, 1.0 - alpha, 0.0, overlay);
-                    instance.cropImage.copyTo(overlay(roi));
-                    
-                    // Save highlight image
-                    cv::imwrite(instanceDir + "/highlight.jpg", overlay);
-                    
-                    // Save instance JSON data
-                    json instanceJson = (instance.type == PlantType::SPROUT) ? 
-                                      sprouts.at(std::count_if(analysisResult.instances.begin(), 
-                                                             analysisResult.instances.begin() + i + 1,
-                                                             [](const PlantInstance& inst) { return inst.type == PlantType::SPROUT; }) - 1) :
-                                      plants.at(std::count_if(analysisResult.instances.begin(), 
-                                                            analysisResult.instances.begin() + i + 1,
-                                                            [](const PlantInstance& inst) { return inst.type == PlantType::PLANT; }) - 1);
-                    
-                    instanceJson["instance_directory"] = instanceDir;
-                    
-                    std::ofstream instanceFile(instanceDir + "/data.json");
-                    instanceFile << instanceJson.dump(2);
-                    instanceFile.close();
-                    
-                    // Legacy compatibility - save to old structure
-                    std::ofstream legacyFile("/app/data/plant_" + std::to_string(i) + ".json");
-                    legacyFile << instanceJson.dump();
-                    legacyFile.close();
-                    
-                } catch (...) {}
-            }
+    client.disconnect();
+    return 0;
+}
 
-            // Per-instance MQTT topics
-            std::string instanceTopic = topic;
-            if (!instanceTopic.empty()) {
-                if (instance.type == PlantType::SPROUT) {
-                    instanceTopic += "/sprouts/" + std::to_string(i) + "/telemetry";
-                } else {
-                    instanceTopic += "/plants/" + std::to_string(i) + "/telemetry";
-                }
-                
-                json instancePayload = (instance.type == PlantType::SPROUT) ? 
-                                     sprouts.at(std::count_if(analysisResult.instances.begin(), 
-                                                            analysisResult.instances.begin() + i + 1,
-                                                            [](const PlantInstance& inst) { return inst.type == PlantType::SPROUT; }) - 1) :
-                                     plants.at(std::count_if(analysisResult.instances.begin(), 
-                                                           analysisResult.instances.begin() + i + 1,
-                                                           [](const PlantInstance& inst) { return inst.type == PlantType::PLANT; }) - 1);
-                
-                client.publish(instanceTopic, instancePayload.dump());
-            }
+// Legacy mode function for backward compatibility
+int runLegacyMode(const nlohmann::json& cfg, const std::string& configPath, int cameraId, const CameraTuning& tuning,
+                 const std::string& mqttHost, int mqttPort,
+                 const std::string& inputMode, const std::string& inputPath, 
+                 const std::string& inputUrl, const std::string& topic) {
+    CameraSettings camera;
+    camera.inputMode = inputMode;
+    camera.inputPath = inputPath;
+    camera.inputUrl = inputUrl;
+    camera.deviceId = cameraId;
+    camera.capture = legacy_capture(cfg);
+    camera.tuning = tuning;
+    camera.topic = topic;
+    if (!topic.empty()) {
+        camera.sproutTopic = topic + "/sprouts/{id}/telemetry";
+        camera.plantTopic = topic + "/plants/{id}/telemetry";
+    }
+    return runCameras(cfg, mqttHost, mqttPort, {camera}, configPath, [&configPath, tuning](std::vector<CameraSettings> &cameras) {
+        const auto updated = load_config_json(configPath);
+        if (updated.is_null()) return false;
+        CameraSettings reloaded;
+        reloaded.tuning = reloaded_tuning(updated, tuning);
+        cameras.assign(1, reloaded);
+        return true;
+    });
+}
+
+// Reprocess an archive: INPUT_PATH is a directory or glob, results go to BATCH_OUTPUT and optionally MQTT
+int runBatchMode(const nlohmann::json& cfg, const CameraTuning& tuning, const std::string& inputPath,
+                 const std::string& mqttHost, int mqttPort, const std::string& topic) {
+    BatchOptions options;
+    options.input = inputPath;
+    options.output = getenv_str("BATCH_OUTPUT", json_get_nested_or<std::string>(cfg, "batch", "output", options.output).c_str());
+    options.threads = getenv_int("BATCH_THREADS", json_get_nested_or<int>(cfg, "batch", "threads", 0));
+    options.decodeScale = getenv_int("BATCH_DECODE_SCALE", json_get_nested_or<int>(cfg, "batch", "decode_scale", 1));
+    options.resume = getenv_int("BATCH_RESUME", json_get_nested_or<int>(cfg, "batch", "resume", 1)) != 0;
+    options.thresholdValue = tuning.thresholdValue;
+    options.scalePxPerCm = tuning.scalePxPerCm;
+    options.analysis.separateTouching = getenv_int("WATERSHED_ENABLED", json_get_nested_or<int>(cfg, "processing", "watershed_enabled", 1)) != 0;
+    options.analysis.pyramidFactor = getenv_int("ANALYSIS_PYRAMID", json_get_nested_or<int>(cfg, "processing", "pyramid_factor", 1));
+    PlantVision::Morphology::setDefaultSkeletonEngine(PlantVision::Morphology::parseSkeletonEngine(
+        getenv_str("SKELETON_ENGINE", json_get_nested_or<std::string>(cfg, "processing", "skeleton_engine", std::string("zhang-suen")).c_str())));
+
+    // Records can also be streamed to <topic>/batch; the queue is drained before more frames are queued
+    std::unique_ptr<MqttClient> client;
+    std::function<void(const std::string&)> onRecord;
+    if (getenv_int("BATCH_MQTT", json_get_nested_or<int>(cfg, "batch", "mqtt", 0)) != 0) {
+        MqttClientOptions mqttOptions;
+        mqttOptions.client_id = getenv_str("MQTT_CLIENT_ID", json_get_nested_or<std::string>(cfg, "mqtt", "client_id", std::string("plantvision-client")).c_str()) + std::string("-batch");
+        client = std::make_unique<MqttClient>(mqttHost, mqttPort, mqttOptions);
+        if (!client->connect()) {
+            std::cerr << "Failed to connect to MQTT broker at " << mqttHost << ":" << mqttPort << ", retrying in background\n";
         }
+        const std::string batchTopic = sibling_topic(topic, "batch");
+        const int mqttQos = getenv_int("MQTT_QOS", json_get_nested_or<int>(cfg, "mqtt", "qos", 0));
+        const size_t highWater = std::max<size_t>(1, mqttOptions.max_queued_messages / 2);
+        MqttClient *publisher = client.get();
+        onRecord = [publisher, batchTopic, mqttQos, highWater](const std::string &record) {
+            // Without a broker the client drops its oldest messages rather than stalling the batch
+            while (publisher->isConnected() && publisher->stats().queued >= highWater) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            publisher->publish(batchTopic, record, mqttQos);
+        };
+    }
 
-        client.publish(topic, payload.dump());
+    const BatchSummary summary = runBatch(options, onRecord);
+    if (client) client->disconnect();
+    return summary.discovered == 0 ? -1 : 0;
+}
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+// CameraSettings for every usable entry of "cameras" in the loaded ConfigManager
+static std::vector<CameraSettings> configured_cameras() {
+    std::vector<CameraSettings> cameras;
+    std::set<std::string> cameraIds;
+    for (int i = 0; const CameraConfig* cameraConfig = g_config_manager->getCameraConfig(i); ++i) {
+        // The id names the camera's data directory and topics, so it has to be unique
+        if (cameraConfig->id.empty() || !cameraIds.insert(cameraConfig->id).second) {
+            std::cerr << "Skipping camera " << i << " (" << cameraConfig->name << "): missing or duplicate id" << std::endl;
+            continue;
+        }
+        CameraSettings camera;
+        camera.id = cameraConfig->id;
+        camera.name = cameraConfig->name;
+        switch (cameraConfig->input.mode) {
+            case CameraConfig::Input::CAMERA: camera.inputMode = "CAMERA"; break;
+            case CameraConfig::Input::URL: camera.inputMode = "NETWORK"; break;
+            default: camera.inputMode = "IMAGE"; break;
+        }
+        camera.inputPath = cameraConfig->input.path.empty() ? std::string("/samples/plant.jpg") : cameraConfig->input.path;
+        camera.inputUrl = cameraConfig->input.url;
+        camera.deviceId = cameraConfig->input.device_id;
+        camera.capture = cameraConfig->input.capture;
+        camera.tuning.thresholdValue = cameraConfig->processing_overrides.threshold;
+        camera.tuning.scalePxPerCm = cameraConfig->processing_overrides.scale_px_per_cm;
+        camera.tuning.intervalMs = cameraConfig->processing_overrides.publish_interval_ms;
+        camera.topic = g_config_manager->generateMQTTTopic("analysis_telemetry", *cameraConfig);
+        camera.sproutTopic = g_config_manager->generateMQTTTopic("sprout_telemetry", *cameraConfig, "{id}");
+        camera.plantTopic = g_config_manager->generateMQTTTopic("plant_telemetry", *cameraConfig, "{id}");
+        camera.dataDir = "/app/data/cameras/" + cameraConfig->id;
+        cameras.push_back(std::move(camera));
     }
+    return cameras;
+}
 
-    client.disconnect();
-    return 0;
+// Every entry of "cameras" in one process, with per-camera interval, overrides and topics
+int runMultiCamera(const std::string& configPath) {
+    if (!g_config_manager->loadConfig(configPath)) {
+        return -1;
+    }
+    for (const auto& error : g_config_manager->getValidationErrors()) {
+        std::cerr << "  - " << error << std::endl;
+    }
+    const auto cfg = load_config_json(configPath);
+    const auto& mqttConfig = g_config_manager->getMQTTConfig();
+    const std::string mqttHost = getenv_str("MQTT_HOST", mqttConfig.broker.host.c_str());
+    const int mqttPort = getenv_int("MQTT_PORT", mqttConfig.broker.port);
+
+    const std::vector<CameraSettings> cameras = configured_cameras();
+    for (const auto& camera : cameras) {
+        std::cout << "Camera " << camera.id << " (" << camera.name << "): " << camera.inputMode
+                  << " every " << camera.tuning.intervalMs << " ms on " << camera.topic << std::endl;
+    }
+    if (cameras.empty()) {
+        std::cerr << "MULTI_CAMERA is set but no usable camera is configured in " << configPath << std::endl;
+        return -1;
+    }
+    return runCameras(cfg, mqttHost, mqttPort, cameras, configPath, [](std::vector<CameraSettings> &updated) {
+        // Runs on the watcher thread, the only user of the config manager once the cameras are up
+        if (!g_config_manager->reloadConfig()) return false;
+        updated = configured_cameras();
+        return true;
+    });
 }
 
 /*
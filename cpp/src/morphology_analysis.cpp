@@ -1,4 +1,5 @@
 #include "morphology_analysis.hpp"
+#include "stage_metrics.hpp"
 #include <opencv2/opencv.hpp>
 #include <cmath>
 #include <algorithm>
@@ -10,8 +11,15 @@
 
 using namespace PlantVision::Morphology;
 
-MorphologyAnalyzer::MorphologyAnalyzer() {
-    // Initialize analyzer
+// Skeleton segments shorter than this are treated as noise
+static const int MIN_SEGMENT_PIXELS = 6;
+
+MorphologyAnalyzer::MorphologyAnalyzer()
+    : skeleton_engine_(defaultSkeletonEngine()) {
+}
+
+MorphologyAnalyzer::MorphologyAnalyzer(SkeletonEngine skeleton_engine)
+    : skeleton_engine_(skeleton_engine) {
 }
 
 MorphologyAnalyzer::~MorphologyAnalyzer() {
@@ -19,6 +27,7 @@ MorphologyAnalyzer::~MorphologyAnalyzer() {
 }
 
 MorphologyMetrics MorphologyAnalyzer::analyzeMorphology(const cv::Mat& mask, const cv::Mat& original_img) {
+    STAGE_TIMER("morphology");
     MorphologyMetrics metrics = {};
     
     if (mask.empty() || original_img.empty()) {
@@ -85,28 +94,23 @@ MorphologyMetrics MorphologyAnalyzer::analyzeMorphology(const cv::Mat& mask, con
         metrics.shape_index = metrics.perimeter / std::sqrt(metrics.area);
         
         // === SKELETON ANALYSIS (PlantCV-inspired) ===
+        // Tips, branches, segments and the longest route come out of one graph pass
         cv::Mat skeleton = skeletonize(mask);
-        std::vector<cv::Point> branch_points = findBranchPoints(skeleton);
-        std::vector<cv::Point> tip_points = findTipPoints(skeleton);
-        std::vector<std::vector<cv::Point>> segments = segmentSkeleton(skeleton);
+        SkeletonGraph graph = extractSkeletonGraph(skeleton, MIN_SEGMENT_PIXELS);
         
-        metrics.branch_points = static_cast<int>(branch_points.size());
-        metrics.tip_points = static_cast<int>(tip_points.size());
+        metrics.branch_points = static_cast<int>(graph.branchPoints.size());
+        metrics.tip_points = static_cast<int>(graph.tipPoints.size());
+        metrics.branch_locations = std::move(graph.branchPoints);
+        metrics.tip_locations = std::move(graph.tipPoints);
         
-        // Calculate segment lengths and angles
         metrics.segment_lengths.clear();
-        for (const auto& segment : segments) {
-            double length = calculatePathLength(segment);
-            metrics.segment_lengths.push_back(length);
-            metrics.total_path_length += length;
-        }
-        
-        if (!metrics.segment_lengths.empty()) {
-            metrics.longest_path = *std::max_element(metrics.segment_lengths.begin(), 
-                                                   metrics.segment_lengths.end());
+        metrics.segment_angles.clear();
+        for (const auto& segment : graph.segments) {
+            metrics.segment_lengths.push_back(segment.length);
+            metrics.segment_angles.push_back(segment.angle);
         }
-        
-        metrics.segment_angles = calculateSegmentAngles(segments);
+        metrics.total_path_length = graph.totalLength;
+        metrics.longest_path = graph.longestPath;
         
     } catch (const cv::Exception& e) {
         std::cerr << "MorphologyAnalyzer OpenCV error: " << e.what() << std::endl;
@@ -118,32 +122,15 @@ MorphologyMetrics MorphologyAnalyzer::analyzeMorphology(const cv::Mat& mask, con
 }
 
 cv::Mat MorphologyAnalyzer::skeletonize(const cv::Mat& binary_mask) {
+    STAGE_TIMER("skeletonize");
     if (binary_mask.empty()) return cv::Mat();
     
-    cv::Mat skeleton = cv::Mat::zeros(binary_mask.size(), CV_8UC1);
-    cv::Mat temp, eroded;
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3));
-    
-    binary_mask.copyTo(temp);
-    
-    int iterations = 0;
-    int max_iterations = 100; // Prevent infinite loops
-    
-    do {
-        cv::erode(temp, eroded, element);
-        cv::Mat opening;
-        cv::morphologyEx(eroded, opening, cv::MORPH_OPEN, element);
-        cv::Mat subset = eroded - opening;
-        cv::bitwise_or(skeleton, subset, skeleton);
-        eroded.copyTo(temp);
-        
-        iterations++;
-        if (iterations > max_iterations) {
-            std::cerr << "Skeletonization exceeded maximum iterations" << std::endl;
-            break;
-        }
-        
-    } while (cv::countNonZero(temp) > 0);
+    cv::Mat skeleton;
+    if (skeleton_engine_ == SkeletonEngine::MORPHOLOGICAL) {
+        skeleton = morphologicalSkeleton(binary_mask, 100); // Prevent runaway loops
+    } else {
+        thinZhangSuen(binary_mask, skeleton);
+    }
     
     // Optional: Prune short spurious branches
     prunesSkeleton(skeleton, 2);
@@ -152,87 +139,18 @@ cv::Mat MorphologyAnalyzer::skeletonize(const cv::Mat& binary_mask) {
 }
 
 std::vector<cv::Point> MorphologyAnalyzer::findBranchPoints(const cv::Mat& skeleton) {
-    std::vector<cv::Point> branch_points;
-    
-    if (skeleton.empty()) return branch_points;
-    
-    // Create kernel for neighbor counting (8-connectivity)
-    cv::Mat kernel = (cv::Mat_<int>(3, 3) << 
-        1, 1, 1,
-        1, 0, 1,
-        1, 1, 1);
-    
-    for (int y = 1; y < skeleton.rows - 1; y++) {
-        for (int x = 1; x < skeleton.cols - 1; x++) {
-            if (skeleton.at<uchar>(y, x) == 0) continue;
-            
-            // Count 8-connected neighbors
-            int neighbors = 0;
-            for (int dy = -1; dy <= 1; dy++) {
-                for (int dx = -1; dx <= 1; dx++) {
-                    if (dy == 0 && dx == 0) continue;
-                    if (skeleton.at<uchar>(y + dy, x + dx) > 0) {
-                        neighbors++;
-                    }
-                }
-            }
-            
-            // Branch points have 3 or more neighbors
-            if (neighbors >= 3) {
-                branch_points.push_back(cv::Point(x, y));
-            }
-        }
-    }
-    
-    return branch_points;
+    return extractSkeletonGraph(skeleton).branchPoints;
 }
 
 std::vector<cv::Point> MorphologyAnalyzer::findTipPoints(const cv::Mat& skeleton) {
-    std::vector<cv::Point> tip_points;
-    
-    if (skeleton.empty()) return tip_points;
-    
-    for (int y = 1; y < skeleton.rows - 1; y++) {
-        for (int x = 1; x < skeleton.cols - 1; x++) {
-            if (skeleton.at<uchar>(y, x) == 0) continue;
-            
-            // Count 8-connected neighbors
-            int neighbors = 0;
-            for (int dy = -1; dy <= 1; dy++) {
-                for (int dx = -1; dx <= 1; dx++) {
-                    if (dy == 0 && dx == 0) continue;
-                    if (skeleton.at<uchar>(y + dy, x + dx) > 0) {
-                        neighbors++;
-                    }
-                }
-            }
-            
-            // Tip points have exactly 1 neighbor
-            if (neighbors == 1) {
-                tip_points.push_back(cv::Point(x, y));
-            }
-        }
-    }
-    
-    return tip_points;
+    return extractSkeletonGraph(skeleton).tipPoints;
 }
 
 std::vector<std::vector<cv::Point>> MorphologyAnalyzer::segmentSkeleton(const cv::Mat& skeleton) {
     std::vector<std::vector<cv::Point>> segments;
-    
-    if (skeleton.empty()) return segments;
-    
-    // Find contours in the skeleton
-    std::vector<std::vector<cv::Point>> contours;
-    cv::findContours(skeleton, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
-    
-    // Each contour represents a skeleton segment
-    for (const auto& contour : contours) {
-        if (contour.size() > 5) { // Minimum segment size
-            segments.push_back(contour);
-        }
+    for (auto& segment : extractSkeletonGraph(skeleton, MIN_SEGMENT_PIXELS).segments) {
+        segments.push_back(std::move(segment.points));
     }
-    
     return segments;
 }
 
@@ -1,22 +1,54 @@
 #include "mqtt_client.hpp"
+#include "stage_metrics.hpp"
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <vector>
 
 namespace {
-// Minimal MQTT 3.1.1 client (connect and publish) without external deps
+// Minimal MQTT 3.1.1 client without external deps
+
+// Non-blocking connect bounded by timeout_ms; an unroutable broker would otherwise block for the kernel SYN timeout
+bool connect_with_timeout(int fd, const struct sockaddr* addr, socklen_t addrlen, int timeout_ms) {
+    const int flags = ::fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) return false;
+
+    bool connected = ::connect(fd, addr, addrlen) == 0;
+    if (!connected && errno == EINPROGRESS) {
+        struct pollfd pfd{fd, POLLOUT, 0};
+        int ready;
+        do {
+            ready = ::poll(&pfd, 1, std::max(1, timeout_ms));
+        } while (ready < 0 && errno == EINTR);
+        int error = 0;
+        socklen_t len = sizeof(error);
+        connected = ready > 0 && ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+    }
+
+    // The session itself uses blocking I/O with SO_SNDTIMEO
+    return ::fcntl(fd, F_SETFL, flags) == 0 && connected;
+}
 
 bool write_all(int fd, const void* data, size_t len) {
     const uint8_t* ptr = static_cast<const uint8_t*>(data);
     size_t total = 0;
     while (total < len) {
-        ssize_t n = ::send(fd, ptr + total, len - total, 0);
+        ssize_t n = ::send(fd, ptr + total, len - total, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
         if (n <= 0) return false;
         total += static_cast<size_t>(n);
     }
@@ -39,14 +71,160 @@ void append_utf8_string(std::string &buf, const std::string &s) {
     buf.append(reinterpret_cast<const char*>(&len), 2);
     buf.append(s);
 }
+
+// Messages taken from the queue per sendBatch call
+constexpr size_t MAX_BATCH_MESSAGES = 256;
+
+void set_tcp_option(int fd, int option, int value) {
+    ::setsockopt(fd, IPPROTO_TCP, option, &value, sizeof(value));
+}
+
+void append_u16(std::string &buf, uint16_t value) {
+    buf.push_back(static_cast<char>(value >> 8));
+    buf.push_back(static_cast<char>(value & 0xFF));
+}
+
+// parse_packet result for a remaining length longer than the 4 bytes MQTT allows
+constexpr size_t MALFORMED_PACKET = SIZE_MAX;
+
+// Parses one packet from the front of buf; returns 0 if incomplete, MALFORMED_PACKET if it
+// can never complete, else its total size
+size_t parse_packet(const std::string &buf, uint8_t &type, std::string &body) {
+    if (buf.size() < 2) return 0;
+    uint32_t remaining = 0;
+    uint32_t multiplier = 1;
+    size_t pos = 1;
+    while (true) {
+        if (pos > 4) return MALFORMED_PACKET;
+        if (pos >= buf.size()) return 0;
+        uint8_t byte = static_cast<uint8_t>(buf[pos++]);
+        remaining += (byte & 0x7F) * multiplier;
+        multiplier *= 128;
+        if (!(byte & 0x80)) break;
+    }
+    if (buf.size() < pos + remaining) return 0;
+    type = static_cast<uint8_t>(buf[0]);
+    body.assign(buf, pos, remaining);
+    return pos + remaining;
+}
 }
 
-MqttClient::MqttClient(const std::string &host, int port)
-    : host_(host), port_(port), sock_(-1) {}
+MqttClient::MqttClient(const std::string &host, int port, const MqttClientOptions &options)
+    : host_(host), port_(port), options_(options) {
+    if (::pipe(wake_pipe_) == 0) {
+        ::fcntl(wake_pipe_[0], F_SETFL, O_NONBLOCK);
+        ::fcntl(wake_pipe_[1], F_SETFL, O_NONBLOCK);
+    }
+}
 
-MqttClient::~MqttClient() { disconnect(); }
+MqttClient::~MqttClient() {
+    disconnect();
+    for (int &fd : wake_pipe_) {
+        if (fd != -1) ::close(fd);
+        fd = -1;
+    }
+}
 
 bool MqttClient::connect() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) {
+        running_ = true;
+        stopping_ = false;
+        thread_ = std::thread(&MqttClient::networkLoop, this);
+    }
+    state_cv_.wait_for(lock, std::chrono::milliseconds(options_.connect_timeout_ms),
+                       [this]() { return connected_; });
+    return connected_;
+}
+
+bool MqttClient::publish(const std::string &topic, const std::string &payload, int qos, bool retain) {
+    return publish(topic, std::make_shared<const std::string>(payload), qos, retain);
+}
+
+bool MqttClient::publish(const std::string &topic, std::shared_ptr<const std::string> payload, int qos, bool retain) {
+    bool kept;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        kept = enqueueLocked({topic, std::move(payload), qos, retain});
+    }
+    wake();
+    return kept;
+}
+
+bool MqttClient::publishBatch(const std::vector<MqttMessage> &messages) {
+    if (messages.empty()) return true;
+    bool kept = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &message : messages) {
+            kept = enqueueLocked(message) && kept;
+        }
+    }
+    wake();
+    return kept;
+}
+
+bool MqttClient::enqueueLocked(const MqttMessage &message) {
+    Message queued;
+    queued.message = message;
+    queued.message.qos = message.qos > 0 ? 1 : 0; // QoS 2 is not supported; deliver at least once
+    if (!queued.message.payload) queued.message.payload = std::make_shared<const std::string>();
+
+    bool dropped = false;
+    while (queue_.size() >= std::max<size_t>(1, options_.max_queued_messages)) {
+        queue_.pop_front();
+        stats_.dropped++;
+        dropped = true;
+    }
+    queue_.push_back(std::move(queued));
+    return !dropped;
+}
+
+void MqttClient::disconnect() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        stopping_ = true;
+    }
+    wake();
+    state_cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    connected_ = false;
+}
+
+bool MqttClient::isConnected() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connected_;
+}
+
+MqttClient::Stats MqttClient::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats current = stats_;
+    current.connected = connected_;
+    current.queued = queue_.size();
+    current.inflight = inflight_.size();
+    return current;
+}
+
+void MqttClient::wake() {
+    if (wake_pipe_[1] != -1) {
+        char byte = 1;
+        (void)!::write(wake_pipe_[1], &byte, 1);
+    }
+}
+
+uint16_t MqttClient::nextPacketId() {
+    // Packet id 0 is reserved; skip ids still waiting for their PUBACK
+    do {
+        last_packet_id_ = static_cast<uint16_t>(last_packet_id_ + 1);
+    } while (last_packet_id_ == 0 || inflight_.count(last_packet_id_));
+    return last_packet_id_;
+}
+
+bool MqttClient::openSession() {
     struct addrinfo hints{}; hints.ai_family = AF_UNSPEC; hints.ai_socktype = SOCK_STREAM; hints.ai_protocol = IPPROTO_TCP;
     struct addrinfo* res = nullptr;
     std::string port_str = std::to_string(port_);
@@ -58,7 +236,7 @@ bool MqttClient::connect() {
     for (auto p = res; p != nullptr; p = p->ai_next) {
         fd = ::socket(p->ai_family, p->ai_socktype, p->ai_protocol);
         if (fd == -1) continue;
-        if (::connect(fd, p->ai_addr, p->ai_addrlen) == 0) break;
+        if (connect_with_timeout(fd, p->ai_addr, p->ai_addrlen, options_.connect_timeout_ms)) break;
         ::close(fd);
         fd = -1;
     }
@@ -66,6 +244,13 @@ bool MqttClient::connect() {
     if (fd == -1) return false;
     sock_ = fd;
 
+    // A stalled broker must not wedge the network thread forever
+    struct timeval timeout{};
+    timeout.tv_sec = std::max(1, options_.connect_timeout_ms / 1000);
+    ::setsockopt(sock_, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    // Batches are already coalesced by sendmsg; small control packets should not wait
+    set_tcp_option(sock_, TCP_NODELAY, 1);
+
     // Build CONNECT packet
     std::string payload;
     append_utf8_string(payload, "MQTT"); // Protocol Name
@@ -74,59 +259,318 @@ bool MqttClient::connect() {
     uint8_t connect_flags = 0x02; // Clean Session
     payload.push_back(static_cast<char>(connect_flags));
 
-    uint16_t keepalive = htons(60);
-    payload.append(reinterpret_cast<const char*>(&keepalive), 2);
+    append_u16(payload, static_cast<uint16_t>(std::max(0, options_.keepalive_sec)));
 
-    append_utf8_string(payload, "plantvision-client");
+    append_utf8_string(payload, options_.client_id);
 
-    std::string remaining_length = encode_varint(static_cast<uint32_t>(payload.size()));
     std::string packet;
     packet.push_back(0x10); // CONNECT
-    packet += remaining_length;
+    packet += encode_varint(static_cast<uint32_t>(payload.size()));
     packet += payload;
 
-    if (!write_all(sock_, packet.data(), packet.size())) {
-        disconnect();
+    if (!sendPacket(packet)) {
+        closeSocket();
         return false;
     }
 
-    // Read CONNACK (minimal)
-    uint8_t header[4];
-    ssize_t n = ::recv(sock_, header, sizeof(header), 0);
-    if (n < 4 || header[0] != 0x20 || header[1] < 2 || header[3] != 0x00) {
-        disconnect();
-        return false;
+    // Wait for CONNACK
+    rx_buffer_.clear();
+    auto deadline = Clock::now() + std::chrono::milliseconds(options_.connect_timeout_ms);
+    while (Clock::now() < deadline) {
+        struct pollfd pfd{sock_, POLLIN, 0};
+        int wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+        if (::poll(&pfd, 1, std::max(1, wait_ms)) <= 0) continue;
+
+        char buf[256];
+        ssize_t n = ::recv(sock_, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        rx_buffer_.append(buf, static_cast<size_t>(n));
+
+        uint8_t type = 0;
+        std::string body;
+        size_t consumed = parse_packet(rx_buffer_, type, body);
+        if (consumed == 0) continue;
+        if (consumed == MALFORMED_PACKET) {
+            std::cerr << "MQTT: malformed packet from broker while connecting" << std::endl;
+            break;
+        }
+        rx_buffer_.erase(0, consumed);
+        if (type == 0x20 && body.size() >= 2 && body[1] == 0x00) {
+            ping_outstanding_ = false;
+            return true;
+        }
+        std::cerr << "MQTT: broker refused connection (code "
+                  << (body.size() >= 2 ? static_cast<int>(static_cast<uint8_t>(body[1])) : -1) << ")" << std::endl;
+        break;
+    }
+
+    closeSocket();
+    return false;
+}
+
+void MqttClient::closeSocket() {
+    if (sock_ != -1) {
+        ::close(sock_);
+        sock_ = -1;
     }
+    rx_buffer_.clear();
+}
+
+bool MqttClient::sendPacket(const std::string &packet) {
+    if (sock_ == -1 || !write_all(sock_, packet.data(), packet.size())) return false;
+    last_sent_ = Clock::now();
     return true;
 }
 
-bool MqttClient::publish(const std::string &topic, const std::string &payload, int qos, bool retain) {
-    if (sock_ == -1) return false;
-    (void)qos; // Only QoS 0 in this minimal client
+size_t MqttClient::sendBatch(const std::vector<Message> &batch) {
+    if (sock_ == -1 || batch.empty()) return 0;
+    STAGE_TIMER("mqtt_send");
 
-    std::string var_header;
-    append_utf8_string(var_header, topic);
+    // Encode every header first; iovec pointers are taken once the buffer stops growing
+    header_buffer_.clear();
+    header_offsets_.clear();
+    for (const auto &queued : batch) {
+        const MqttMessage &message = queued.message;
+        header_offsets_.push_back(header_buffer_.size());
 
-    std::string remaining = var_header + payload;
-    std::string rl = encode_varint(static_cast<uint32_t>(remaining.size()));
+        uint8_t header = 0x30; // PUBLISH
+        if (queued.dup) header |= 0x08;
+        if (message.qos > 0) header |= 0x02;
+        if (message.retain) header |= 0x01;
 
-    uint8_t header = 0x30; // PUBLISH QoS0
-    if (retain) header |= 0x01;
+        size_t var_header_size = 2 + message.topic.size() + (message.qos > 0 ? 2 : 0);
+        header_buffer_.push_back(static_cast<char>(header));
+        header_buffer_ += encode_varint(static_cast<uint32_t>(var_header_size + message.payload->size()));
+        append_utf8_string(header_buffer_, message.topic);
+        if (message.qos > 0) append_u16(header_buffer_, queued.packet_id);
+    }
+    header_offsets_.push_back(header_buffer_.size());
 
-    std::string packet;
-    packet.push_back(static_cast<char>(header));
-    packet += rl;
-    packet += remaining;
+    iov_.clear();
+    message_ends_.clear();
+    size_t total = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        size_t header_len = header_offsets_[i + 1] - header_offsets_[i];
+        iov_.push_back({const_cast<char *>(header_buffer_.data() + header_offsets_[i]), header_len});
+        const std::string &payload = *batch[i].message.payload;
+        if (!payload.empty()) {
+            iov_.push_back({const_cast<char *>(payload.data()), payload.size()});
+        }
+        total += header_len + payload.size();
+        message_ends_.push_back(total);
+    }
+
+    // Cork only when the kernel's iovec limit forces several sendmsg calls
+    const size_t iov_limit = IOV_MAX;
+    const bool corked = iov_.size() > iov_limit;
+#ifdef TCP_CORK
+    if (corked) set_tcp_option(sock_, TCP_CORK, 1);
+#endif
+
+    size_t written = 0;
+    size_t first = 0;
+    while (first < iov_.size()) {
+        struct msghdr msg{};
+        msg.msg_iov = &iov_[first];
+        msg.msg_iovlen = std::min(iov_.size() - first, iov_limit);
+        ssize_t n = ::sendmsg(sock_, &msg, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        written += static_cast<size_t>(n);
+        size_t remaining = static_cast<size_t>(n);
+        while (first < iov_.size() && remaining >= iov_[first].iov_len) {
+            remaining -= iov_[first].iov_len;
+            first++;
+        }
+        if (remaining > 0) {
+            iov_[first].iov_base = static_cast<char *>(iov_[first].iov_base) + remaining;
+            iov_[first].iov_len -= remaining;
+        }
+    }
 
-    return write_all(sock_, packet.data(), packet.size());
+#ifdef TCP_CORK
+    if (corked) set_tcp_option(sock_, TCP_CORK, 0);
+#endif
+    (void)corked;
+
+    if (written > 0) last_sent_ = Clock::now();
+    return static_cast<size_t>(std::upper_bound(message_ends_.begin(), message_ends_.end(), written) - message_ends_.begin());
 }
 
-void MqttClient::disconnect() {
-    if (sock_ != -1) {
-        uint8_t pkt[2] = {0xE0, 0x00};
-        (void)write_all(sock_, pkt, 2);
-        ::close(sock_);
-        sock_ = -1;
+bool MqttClient::readPackets() {
+    char buf[1024];
+    while (true) {
+        ssize_t n = ::recv(sock_, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            rx_buffer_.append(buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+        return false; // orderly shutdown or socket error
+    }
+
+    uint8_t type = 0;
+    std::string body;
+    size_t consumed;
+    while ((consumed = parse_packet(rx_buffer_, type, body)) > 0) {
+        if (consumed == MALFORMED_PACKET) {
+            // The stream cannot be resynchronised; drop the session and reconnect
+            std::cerr << "MQTT: malformed packet from broker (remaining length over 4 bytes)" << std::endl;
+            return false;
+        }
+        rx_buffer_.erase(0, consumed);
+        switch (type & 0xF0) {
+            case 0x40: // PUBACK
+                if (body.size() >= 2) {
+                    uint16_t id = static_cast<uint16_t>((static_cast<uint8_t>(body[0]) << 8) | static_cast<uint8_t>(body[1]));
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (inflight_.erase(id)) stats_.acked++;
+                }
+                break;
+            case 0xD0: // PINGRESP
+                ping_outstanding_ = false;
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+void MqttClient::requeueInflight() {
+    // Called with mutex_ held after a reconnect: clean sessions forget in-flight ids,
+    // so unacknowledged messages are re-sent first, flagged as duplicates
+    std::vector<Message> resend;
+    for (auto &kv : inflight_) resend.push_back(std::move(kv.second));
+    inflight_.clear();
+    for (auto it = resend.rbegin(); it != resend.rend(); ++it) {
+        it->packet_id = 0;
+        it->dup = true;
+        queue_.push_front(std::move(*it));
     }
 }
 
+void MqttClient::networkLoop() {
+    int backoff_ms = options_.reconnect_min_ms;
+    bool had_session = false;
+    // In milliseconds so that half of a 1 s keepalive is not truncated to zero
+    const auto keepalive = std::chrono::milliseconds(1000 * std::max(1, options_.keepalive_sec));
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) break;
+        }
+
+        if (sock_ == -1) {
+            if (!openSession()) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (state_cv_.wait_for(lock, std::chrono::milliseconds(backoff_ms), [this]() { return stopping_; })) break;
+                backoff_ms = std::min(options_.reconnect_max_ms, std::max(1, backoff_ms) * 2);
+                continue;
+            }
+
+            backoff_ms = options_.reconnect_min_ms;
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (had_session) {
+                stats_.reconnects++;
+                std::cout << "MQTT: reconnected to " << host_ << ":" << port_ << std::endl;
+            }
+            had_session = true;
+            requeueInflight();
+            connected_ = true;
+            state_cv_.notify_all();
+        }
+
+        // Send what the in-flight window allows, a batch at a time; anything that arrived
+        // behind the CONNACK is already buffered and would not wake poll()
+        bool link_ok = rx_buffer_.empty() || readPackets();
+        while (link_ok) {
+            batch_.clear();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                while (!queue_.empty() && batch_.size() < MAX_BATCH_MESSAGES) {
+                    if (queue_.front().message.qos > 0 && inflight_.size() >= options_.max_inflight) break;
+                    Message queued = std::move(queue_.front());
+                    queue_.pop_front();
+                    if (queued.message.qos > 0) {
+                        queued.packet_id = nextPacketId();
+                        inflight_[queued.packet_id] = queued;
+                    }
+                    batch_.push_back(std::move(queued));
+                }
+            }
+            if (batch_.empty()) break;
+
+            size_t sent = sendBatch(batch_);
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.sent += sent;
+            if (sent < batch_.size()) {
+                // QoS 1 leftovers stay in flight and are re-sent after the reconnect
+                link_ok = false;
+                for (size_t i = batch_.size(); i-- > sent;) {
+                    if (batch_[i].message.qos == 0) queue_.push_front(std::move(batch_[i]));
+                }
+            }
+        }
+
+        // Keepalive: ping when idle for half the interval, give up if no PINGRESP within it
+        auto now = Clock::now();
+        if (link_ok && ping_outstanding_ && now - ping_sent_ > keepalive) {
+            std::cerr << "MQTT: keepalive timeout" << std::endl;
+            link_ok = false;
+        }
+        if (link_ok && !ping_outstanding_ && now - last_sent_ >= keepalive / 2) {
+            static const std::string pingreq("\xC0\x00", 2);
+            if (sendPacket(pingreq)) {
+                ping_outstanding_ = true;
+                ping_sent_ = now;
+            } else {
+                link_ok = false;
+            }
+        }
+
+        if (link_ok) {
+            struct pollfd fds[2] = {{sock_, POLLIN, 0}, {wake_pipe_[0], POLLIN, 0}};
+            int ready = ::poll(fds, wake_pipe_[0] != -1 ? 2 : 1, 1000);
+            if (ready > 0) {
+                if (fds[1].revents & POLLIN) {
+                    char drain[64];
+                    while (::read(wake_pipe_[0], drain, sizeof(drain)) > 0) {}
+                }
+                if ((fds[0].revents & (POLLIN | POLLHUP | POLLERR)) && !readPackets()) {
+                    link_ok = false;
+                }
+            }
+        }
+
+        if (!link_ok) {
+            std::cerr << "MQTT: connection to " << host_ << ":" << port_ << " lost, reconnecting" << std::endl;
+            closeSocket();
+            std::lock_guard<std::mutex> lock(mutex_);
+            connected_ = false;
+        }
+    }
+
+    // Shutdown: best-effort flush of what is already queued, then DISCONNECT
+    if (sock_ != -1) {
+        auto deadline = Clock::now() + std::chrono::seconds(2);
+        while (Clock::now() < deadline) {
+            batch_.clear();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                while (!queue_.empty() && batch_.size() < MAX_BATCH_MESSAGES) {
+                    Message queued = std::move(queue_.front());
+                    queue_.pop_front();
+                    if (queued.message.qos > 0) queued.packet_id = nextPacketId();
+                    batch_.push_back(std::move(queued));
+                }
+            }
+            if (batch_.empty() || sendBatch(batch_) < batch_.size()) break;
+        }
+        static const std::string disconnect_packet("\xE0\x00", 2);
+        (void)sendPacket(disconnect_packet);
+        closeSocket();
+    }
+}
@@ -0,0 +1,225 @@
+#include "output_writer.hpp"
+#include "stage_metrics.hpp"
+#include <opencv2/imgcodecs.hpp>
+#include <fstream>
+#include <iostream>
+
+void OutputWriter::Batch::addImage(const std::string& path, const cv::Mat& image, const std::vector<int>& params) {
+    Item item;
+    item.path = path;
+    item.image = image;
+    item.params = params;
+    items.push_back(std::move(item));
+}
+
+void OutputWriter::Batch::addText(const std::string& path, std::string text) {
+    Item item;
+    item.path = path;
+    item.text = std::move(text);
+    items.push_back(std::move(item));
+}
+
+void OutputWriter::Batch::addText(const std::string& path, std::shared_ptr<const std::string> text) {
+    Item item;
+    item.path = path;
+    item.shared_text = std::move(text);
+    items.push_back(std::move(item));
+}
+
+void OutputWriter::Batch::addComposite(const std::string& path, const cv::Mat& base, const cv::Mat& patch,
+                                       const cv::Rect& roi, const std::vector<int>& params) {
+    Item item;
+    item.path = path;
+    item.image = base;
+    item.params = params;
+    item.patch = patch;
+    item.patch_roi = roi;
+    items.push_back(std::move(item));
+}
+
+OutputWriter::OutputWriter(size_t max_queue_depth, int worker_threads)
+    : max_queue_depth_(max_queue_depth > 0 ? max_queue_depth : 1) {
+    int count = worker_threads > 0 ? worker_threads : 1;
+    for (int i = 0; i < count; ++i) {
+        workers_.emplace_back(&OutputWriter::workerLoop, this, i);
+    }
+}
+
+OutputWriter::~OutputWriter() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+bool OutputWriter::submit(Batch batch) {
+    batch.submitted = std::chrono::steady_clock::now();
+
+    bool dropped = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (queue_.size() >= max_queue_depth_) {
+            queue_.pop_front();
+            stats_.batches_dropped++;
+            dropped = true;
+        }
+        queue_.push_back(std::move(batch));
+        stats_.queue_depth = queue_.size();
+    }
+    queue_cv_.notify_one();
+    return !dropped;
+}
+
+void OutputWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this]() { return queue_.empty() && active_batches_ == 0; });
+}
+
+OutputWriter::Stats OutputWriter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats current = stats_;
+    current.queue_depth = queue_.size();
+    return current;
+}
+
+void OutputWriter::workerLoop(int worker) {
+    while (true) {
+        Batch batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queue_cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return; // stopping and drained
+            batch = std::move(queue_.front());
+            queue_.pop_front();
+            stats_.queue_depth = queue_.size();
+            active_batches_++;
+        }
+
+        writeBatch(batch, worker);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_batches_--;
+        }
+        idle_cv_.notify_all();
+    }
+}
+
+void OutputWriter::writeBatch(const Batch& batch, int worker) {
+    STAGE_TIMER("disk_write");
+    auto io_start = std::chrono::steady_clock::now();
+
+    // Reused across items; encoded JPEGs of the same frame are similar in size
+    thread_local std::vector<uchar> encode_buffer;
+    uint64_t errors = 0;
+    for (const auto& item : batch.items) {
+        if (!writeItem(item, encode_buffer, worker)) errors++;
+    }
+
+    auto done = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.batches_written++;
+    stats_.write_errors += errors;
+    stats_.last_io_time_ms = std::chrono::duration<double, std::milli>(done - io_start).count();
+    stats_.last_write_latency_ms = std::chrono::duration<double, std::milli>(done - batch.submitted).count();
+}
+
+bool OutputWriter::writeItem(const Item& item, std::vector<uchar>& encode_buffer, int worker) {
+    const std::filesystem::path path(item.path);
+    if (path.has_parent_path() && !ensureDirectory(path.parent_path())) {
+        return false;
+    }
+
+    const std::string& text = item.shared_text ? *item.shared_text : item.text;
+    const char* data = text.data();
+    size_t size = text.size();
+    if (!item.image.empty()) {
+        try {
+            std::string ext = path.extension().string();
+            if (ext.empty()) ext = ".jpg";
+            bool encoded = item.patch.empty() ? cv::imencode(ext, item.image, encode_buffer, item.params)
+                                              : encodeComposite(item, ext, encode_buffer);
+            if (!encoded) {
+                std::cerr << "OutputWriter: failed to encode " << item.path << std::endl;
+                return false;
+            }
+        } catch (const cv::Exception& e) {
+            std::cerr << "OutputWriter: encode error for " << item.path << ": " << e.what() << std::endl;
+            return false;
+        }
+        data = reinterpret_cast<const char*>(encode_buffer.data());
+        size = encode_buffer.size();
+    }
+
+    // Write next to the target and rename, which is atomic on the same filesystem.
+    // One temp name per worker: two workers may be writing the same target for consecutive frames
+    std::filesystem::path tmp_path = path;
+    tmp_path += ".tmp" + std::to_string(worker);
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "OutputWriter: cannot open " << tmp_path << std::endl;
+            return false;
+        }
+        out.write(data, static_cast<std::streamsize>(size));
+        if (!out) {
+            std::cerr << "OutputWriter: short write to " << tmp_path << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::cerr << "OutputWriter: rename to " << item.path << " failed: " << ec.message() << std::endl;
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool OutputWriter::encodeComposite(const Item& item, const std::string& ext, std::vector<uchar>& encode_buffer) {
+    const cv::Rect roi = item.patch_roi & cv::Rect(0, 0, item.image.cols, item.image.rows);
+    if (roi.size() != item.patch.size() || item.patch.type() != item.image.type()) {
+        return cv::imencode(ext, item.image, encode_buffer, item.params);
+    }
+
+    // The canvas keeps a reference to its base, so an unchanged data pointer
+    // means the same (immutable) frame and only the pasted ROI needs undoing
+    thread_local cv::Mat canvas;
+    thread_local cv::Mat canvas_base;
+    if (canvas_base.data != item.image.data || canvas.size() != item.image.size() ||
+        canvas.type() != item.image.type()) {
+        item.image.copyTo(canvas);
+        canvas_base = item.image;
+    }
+
+    item.patch.copyTo(canvas(roi));
+    bool encoded = cv::imencode(ext, canvas, encode_buffer, item.params);
+    item.image(roi).copyTo(canvas(roi));
+    return encoded;
+}
+
+bool OutputWriter::ensureDirectory(const std::filesystem::path& dir) {
+    const std::string key = dir.string();
+    {
+        std::lock_guard<std::mutex> lock(dirs_mutex_);
+        if (known_dirs_.count(key)) return true;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec && !std::filesystem::is_directory(dir)) {
+        std::cerr << "OutputWriter: cannot create " << key << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(dirs_mutex_);
+    known_dirs_.insert(key);
+    return true;
+}
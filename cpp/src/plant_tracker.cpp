@@ -0,0 +1,154 @@
+#include "plant_tracker.hpp"
+#include "stage_metrics.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const cv::Size THUMBNAIL_SIZE(16, 16);
+
+double rectIoU(const cv::Rect& a, const cv::Rect& b) {
+    double inter = (a & b).area();
+    double uni = a.area() + b.area() - inter;
+    return uni > 0.0 ? inter / uni : 0.0;
+}
+
+double pointDistance(const cv::Point2f& a, const cv::Point2f& b) {
+    return std::hypot(a.x - b.x, a.y - b.y);
+}
+
+struct Pair {
+    double score;
+    int track;
+    int candidate;
+};
+
+} // namespace
+
+PlantTracker::PlantTracker(const TrackerOptions& options)
+    : options_(options) {}
+
+void PlantTracker::reset() {
+    tracks_.clear();
+    pending_.clear();
+}
+
+std::vector<PlantTracker::Assignment> PlantTracker::assign(const FrameContext& frame,
+                                                           const std::vector<std::vector<cv::Point>>& contours) {
+    STAGE_TIMER("track_assign");
+    const cv::Rect frameRect(0, 0, frame.size().width, frame.size().height);
+
+    pending_.assign(contours.size(), Observation());
+    for (size_t c = 0; c < contours.size(); ++c) {
+        Observation& obs = pending_[c];
+        obs.bbox = cv::boundingRect(contours[c]);
+        obs.area = cv::contourArea(contours[c]);
+        cv::Moments m = cv::moments(contours[c]);
+        obs.centroid = (m.m00 > 0.0) ? cv::Point2f(static_cast<float>(m.m10 / m.m00), static_cast<float>(m.m01 / m.m00))
+                                     : cv::Point2f(obs.bbox.x + obs.bbox.width * 0.5f, obs.bbox.y + obs.bbox.height * 0.5f);
+
+        cv::Rect roi = obs.bbox & frameRect;
+        if (roi.area() > 0) {
+            cv::resize(frame.grayRegion(roi), obs.thumbnail, THUMBNAIL_SIZE, 0, 0, cv::INTER_AREA);
+        }
+    }
+
+    // Score every plausible (track, candidate) pair and take the best ones greedily
+    std::vector<Pair> pairs;
+    for (size_t t = 0; t < tracks_.size(); ++t) {
+        for (size_t c = 0; c < pending_.size(); ++c) {
+            double iou = rectIoU(tracks_[t].bbox, pending_[c].bbox);
+            double dist = pointDistance(tracks_[t].centroid, pending_[c].centroid);
+            if (iou < options_.minIoU && dist > options_.maxCentroidDistancePx) continue;
+
+            double proximity = options_.maxCentroidDistancePx > 0.0
+                ? std::max(0.0, 1.0 - dist / options_.maxCentroidDistancePx) : 0.0;
+            pairs.push_back({iou + 0.5 * proximity, static_cast<int>(t), static_cast<int>(c)});
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.score > b.score; });
+
+    std::vector<char> trackTaken(tracks_.size(), 0);
+    for (const Pair& p : pairs) {
+        if (trackTaken[p.track] || pending_[p.candidate].track >= 0) continue;
+        trackTaken[p.track] = 1;
+        pending_[p.candidate].track = p.track;
+    }
+
+    std::vector<Assignment> assignments(pending_.size());
+    for (size_t c = 0; c < pending_.size(); ++c) {
+        const Observation& obs = pending_[c];
+        if (obs.track < 0) {
+            assignments[c].trackId = next_id_++;
+            continue;
+        }
+
+        const Track& track = tracks_[obs.track];
+        assignments[c].trackId = track.id;
+
+        bool refreshDue = options_.refreshInterval > 0 && track.reuseCount >= options_.refreshInterval;
+        if (!track.hasInstance || refreshDue || obs.thumbnail.empty() || track.thumbnail.empty()) continue;
+
+        double areaDelta = track.area > 0.0 ? std::abs(obs.area - track.area) / track.area : 1.0;
+        if (areaDelta > options_.maxAreaDelta) continue;
+
+        cv::Mat diff;
+        cv::absdiff(obs.thumbnail, track.thumbnail, diff);
+        if (cv::mean(diff)[0] <= options_.maxAppearanceDelta) {
+            assignments[c].cached = &track.instance;
+        }
+    }
+    return assignments;
+}
+
+void PlantTracker::commit(const std::vector<Assignment>& assignments, const std::vector<PlantInstance>& instances,
+                          const std::vector<char>& ok) {
+    std::vector<char> seen(tracks_.size(), 0);
+    std::vector<Track> created;
+
+    const size_t count = std::min({assignments.size(), instances.size(), ok.size(), pending_.size()});
+    for (size_t c = 0; c < count; ++c) {
+        if (!ok[c]) continue;
+        const Observation& obs = pending_[c];
+
+        if (obs.track >= 0) {
+            Track& track = tracks_[obs.track];
+            seen[obs.track] = 1;
+            track.missed = 0;
+            track.bbox = obs.bbox;
+            track.centroid = obs.centroid;
+            if (assignments[c].cached) {
+                // Keep the reference thumbnail and area so slow drift still triggers a refresh
+                track.reuseCount++;
+            } else {
+                track.area = obs.area;
+                track.thumbnail = obs.thumbnail;
+                track.instance = instances[c];
+                track.hasInstance = true;
+                track.reuseCount = 0;
+            }
+            continue;
+        }
+
+        Track track;
+        track.id = assignments[c].trackId;
+        track.bbox = obs.bbox;
+        track.centroid = obs.centroid;
+        track.area = obs.area;
+        track.thumbnail = obs.thumbnail;
+        track.instance = instances[c];
+        track.hasInstance = true;
+        created.push_back(std::move(track));
+    }
+
+    std::vector<Track> kept;
+    kept.reserve(tracks_.size() + created.size());
+    for (size_t t = 0; t < tracks_.size(); ++t) {
+        if (!seen[t] && ++tracks_[t].missed > options_.maxMissedFrames) continue;
+        kept.push_back(std::move(tracks_[t]));
+    }
+    for (auto& track : created) kept.push_back(std::move(track));
+
+    tracks_ = std::move(kept);
+    pending_.clear();
+}
@@ -0,0 +1,106 @@
+#include "scratch_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Room for a few 4K frames' planes in flight; one thread's masks rarely exceed a few MB
+const size_t SHARED_POOL_BYTES = size_t(256) << 20;
+const size_t LOCAL_POOL_BYTES = size_t(64) << 20;
+const size_t MIN_CAPACITY = 4096;
+
+std::atomic<uint64_t> g_allocations{0};
+
+// Rounded up to 1/8..1/16 of the size, so bounding boxes that jitter by a few pixels share a buffer
+size_t roundCapacity(size_t bytes) {
+    size_t step = MIN_CAPACITY;
+    while ((step << 4) <= bytes) step <<= 1;
+    return (bytes + step - 1) / step * step;
+}
+
+// Only the pool's own reference left: nobody can reach the buffer except through acquire()
+bool isIdle(const cv::Mat& buffer) {
+    return buffer.u && buffer.u->refcount == 1;
+}
+
+} // namespace
+
+ScratchPool::ScratchPool(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+ScratchPool& ScratchPool::shared() {
+    static ScratchPool pool(SHARED_POOL_BYTES);
+    return pool;
+}
+
+ScratchPool& ScratchPool::local() {
+    thread_local ScratchPool pool(LOCAL_POOL_BYTES);
+    return pool;
+}
+
+cv::Mat ScratchPool::acquire(cv::Size size, int type) {
+    if (size.width <= 0 || size.height <= 0 || CV_MAT_DEPTH(type) != CV_8U) {
+        return cv::Mat(size, type);
+    }
+    const int channels = CV_MAT_CN(type);
+    const size_t needed = static_cast<size_t>(size.width) * size.height * channels;
+
+    cv::Mat buffer;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Best fit, but never park a small mask in a frame-sized buffer
+        const cv::Mat* best = nullptr;
+        for (const auto& candidate : buffers_) {
+            const size_t capacity = candidate.total();
+            if (capacity < needed || capacity > 2 * needed + MIN_CAPACITY || !isIdle(candidate)) continue;
+            if (!best || capacity < best->total()) best = &candidate;
+        }
+        if (best) {
+            ++hits_;
+            buffer = *best;
+        } else {
+            ++misses_;
+            buffer = allocate(roundCapacity(needed));
+        }
+    }
+    // A continuous header over the front of the buffer, sharing its reference count
+    return buffer.colRange(0, static_cast<int>(needed)).reshape(channels, size.height);
+}
+
+cv::Mat ScratchPool::zeros(cv::Size size, int type) {
+    cv::Mat mat = acquire(size, type);
+    mat.setTo(cv::Scalar::all(0));
+    return mat;
+}
+
+cv::Mat ScratchPool::allocate(size_t capacity) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (bytes_ + capacity > max_bytes_) {
+        // Make room by dropping idle buffers; busy ones are released by their holders
+        buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(), [&](const cv::Mat& buffer) {
+            if (bytes_ + capacity <= max_bytes_ || !isIdle(buffer)) return false;
+            bytes_ -= buffer.total();
+            return true;
+        }), buffers_.end());
+    }
+    cv::Mat buffer(1, static_cast<int>(capacity), CV_8UC1);
+    if (bytes_ + capacity <= max_bytes_) {
+        buffers_.push_back(buffer);
+        bytes_ += capacity;
+    }
+    return buffer;
+}
+
+ScratchPool::Stats ScratchPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.buffers = buffers_.size();
+    stats.bytes = bytes_;
+    return stats;
+}
+
+uint64_t ScratchPool::allocations() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,414 @@
+#include "skeleton.hpp"
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <vector>
+
+#ifndef M_SQRT2
+#define M_SQRT2 1.41421356237309504880
+#endif
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace PlantVision {
+namespace Morphology {
+
+namespace {
+
+std::atomic<SkeletonEngine> g_default_engine{SkeletonEngine::ZHANG_SUEN};
+
+// Neighbour code bit order: P2 (N), P3 (NE), P4 (E), P5 (SE), P6 (S), P7 (SW), P8 (W), P9 (NW)
+struct ZhangSuenTables {
+    std::array<uchar, 256> first{};
+    std::array<uchar, 256> second{};
+
+    ZhangSuenTables() {
+        for (int code = 0; code < 256; ++code) {
+            int p[8];
+            int neighbours = 0;
+            for (int i = 0; i < 8; ++i) {
+                p[i] = (code >> i) & 1;
+                neighbours += p[i];
+            }
+
+            int transitions = 0;
+            for (int i = 0; i < 8; ++i) {
+                if (p[i] == 0 && p[(i + 1) % 8] == 1) transitions++;
+            }
+
+            bool removable = neighbours >= 2 && neighbours <= 6 && transitions == 1;
+            const int p2 = p[0], p4 = p[2], p6 = p[4], p8 = p[6];
+            first[code] = removable && !(p2 && p4 && p6) && !(p4 && p6 && p8);
+            second[code] = removable && !(p2 && p4 && p8) && !(p2 && p6 && p8);
+        }
+    }
+};
+
+const ZhangSuenTables& zhangSuenTables() {
+    static const ZhangSuenTables tables;
+    return tables;
+}
+
+inline int neighbourCode(const uchar* p, int step) {
+    return  p[-step]
+         | (p[-step + 1] << 1)
+         | (p[1]         << 2)
+         | (p[step + 1]  << 3)
+         | (p[step]      << 4)
+         | (p[step - 1]  << 5)
+         | (p[-1]        << 6)
+         | (p[-step - 1] << 7);
+}
+
+} // namespace
+
+SkeletonEngine defaultSkeletonEngine() {
+    return g_default_engine.load(std::memory_order_relaxed);
+}
+
+void setDefaultSkeletonEngine(SkeletonEngine engine) {
+    g_default_engine.store(engine, std::memory_order_relaxed);
+}
+
+SkeletonEngine parseSkeletonEngine(const std::string& name, SkeletonEngine fallback) {
+    if (name == "morphological" || name == "MORPHOLOGICAL") return SkeletonEngine::MORPHOLOGICAL;
+    if (name == "zhang-suen" || name == "zhang_suen" || name == "ZHANG_SUEN") return SkeletonEngine::ZHANG_SUEN;
+    return fallback;
+}
+
+const char* skeletonEngineName(SkeletonEngine engine) {
+    return engine == SkeletonEngine::MORPHOLOGICAL ? "morphological" : "zhang-suen";
+}
+
+void thinZhangSuen(const cv::Mat& binary, cv::Mat& skeleton) {
+    CV_Assert(binary.empty() || binary.type() == CV_8UC1);
+    if (binary.empty()) {
+        skeleton.release();
+        return;
+    }
+
+    const ZhangSuenTables& tables = zhangSuenTables();
+
+    // 0/1 image with a one-pixel zero border so neighbour reads need no bounds checks
+    thread_local cv::Mat padded;
+    thread_local std::vector<int> foreground;
+    thread_local std::vector<int> removed;
+
+    padded.create(binary.rows + 2, binary.cols + 2, CV_8UC1);
+    padded.setTo(cv::Scalar(0));
+    const int step = static_cast<int>(padded.step[0]);
+    uchar* base = padded.data;
+
+    foreground.clear();
+    for (int y = 0; y < binary.rows; ++y) {
+        const uchar* src = binary.ptr<uchar>(y);
+        uchar* dst = padded.ptr<uchar>(y + 1) + 1;
+        const int rowOffset = (y + 1) * step + 1;
+        for (int x = 0; x < binary.cols; ++x) {
+            if (src[x]) {
+                dst[x] = 1;
+                foreground.push_back(rowOffset + x);
+            }
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int pass = 0; pass < 2; ++pass) {
+            const uchar* lut = pass == 0 ? tables.first.data() : tables.second.data();
+
+            // Decide on the unmodified state first, then clear, as the algorithm requires
+            removed.clear();
+            for (int idx : foreground) {
+                if (lut[neighbourCode(base + idx, step)]) removed.push_back(idx);
+            }
+            if (removed.empty()) continue;
+
+            changed = true;
+            for (int idx : removed) base[idx] = 0;
+
+            size_t kept = 0;
+            for (int idx : foreground) {
+                if (base[idx]) foreground[kept++] = idx;
+            }
+            foreground.resize(kept);
+        }
+    }
+
+    skeleton.create(binary.size(), CV_8UC1);
+    skeleton.setTo(cv::Scalar(0));
+    for (int idx : foreground) {
+        int y = idx / step - 1;
+        int x = idx % step - 1;
+        skeleton.at<uchar>(y, x) = 255;
+    }
+}
+
+cv::Mat morphologicalSkeleton(const cv::Mat& binary, int max_iterations) {
+    if (binary.empty()) return cv::Mat();
+
+    cv::Mat skeleton = cv::Mat::zeros(binary.size(), CV_8UC1);
+    cv::Mat temp, eroded;
+    cv::Mat element = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3));
+
+    binary.copyTo(temp);
+
+    int iterations = 0;
+    do {
+        cv::erode(temp, eroded, element);
+        cv::Mat opening;
+        cv::morphologyEx(eroded, opening, cv::MORPH_OPEN, element);
+        cv::Mat subset = eroded - opening;
+        cv::bitwise_or(skeleton, subset, skeleton);
+        eroded.copyTo(temp);
+
+        iterations++;
+        if (max_iterations > 0 && iterations > max_iterations) {
+            std::cerr << "Skeletonization exceeded maximum iterations" << std::endl;
+            break;
+        }
+    } while (cv::countNonZero(temp) > 0);
+
+    return skeleton;
+}
+
+cv::Mat skeletonize(const cv::Mat& binary, SkeletonEngine engine) {
+    if (engine == SkeletonEngine::MORPHOLOGICAL) {
+        return morphologicalSkeleton(binary);
+    }
+    cv::Mat skeleton;
+    thinZhangSuen(binary, skeleton);
+    return skeleton;
+}
+
+namespace {
+
+// Neighbour count per packed 8-neighbour code
+struct NeighbourCountTable {
+    std::array<uchar, 256> count{};
+
+    NeighbourCountTable() {
+        for (int code = 0; code < 256; ++code) {
+            int n = 0;
+            for (int i = 0; i < 8; ++i) n += (code >> i) & 1;
+            count[code] = static_cast<uchar>(n);
+        }
+    }
+};
+
+const NeighbourCountTable& neighbourCountTable() {
+    static const NeighbourCountTable table;
+    return table;
+}
+
+// Orthogonal directions first so staircases are walked pixel by pixel
+const int WALK_ORDER[8] = {0, 2, 4, 6, 1, 3, 5, 7};
+
+const double STEP_LENGTH[8] = {1.0, M_SQRT2, 1.0, M_SQRT2, 1.0, M_SQRT2, 1.0, M_SQRT2};
+
+double longestRoute(const std::vector<std::vector<std::pair<int, double>>>& adjacency) {
+    const size_t n = adjacency.size();
+    std::vector<double> dist(n);
+    std::vector<char> component_seen(n, 0);
+
+    // Farthest node from source with its distance; marks the component as seen
+    auto farthest = [&](int source) {
+        std::fill(dist.begin(), dist.end(), -1.0);
+        using Entry = std::pair<double, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+        dist[source] = 0.0;
+        queue.push({0.0, source});
+        std::pair<int, double> best(source, 0.0);
+        while (!queue.empty()) {
+            Entry top = queue.top();
+            queue.pop();
+            if (top.first > dist[top.second]) continue;
+            component_seen[top.second] = 1;
+            if (top.first > best.second) best = {top.second, top.first};
+            for (const auto& edge : adjacency[top.second]) {
+                double d = top.first + edge.second;
+                if (dist[edge.first] < 0.0 || d < dist[edge.first]) {
+                    dist[edge.first] = d;
+                    queue.push({d, edge.first});
+                }
+            }
+        }
+        return best;
+    };
+
+    double longest = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        if (component_seen[i] || adjacency[i].empty()) continue;
+        auto end = farthest(static_cast<int>(i));
+        longest = std::max(longest, farthest(end.first).second);
+    }
+    return longest;
+}
+
+} // namespace
+
+SkeletonGraph extractSkeletonGraph(const cv::Mat& skeleton, int min_segment_pixels) {
+    SkeletonGraph graph;
+    if (skeleton.empty()) return graph;
+    CV_Assert(skeleton.type() == CV_8UC1);
+
+    const NeighbourCountTable& table = neighbourCountTable();
+
+    // 0 = background, 1 = unvisited skeleton, 2 = visited; zero border avoids bounds checks
+    thread_local cv::Mat padded;
+    thread_local std::vector<int> node_of;
+    thread_local std::vector<int> pixels;
+
+    padded.create(skeleton.rows + 2, skeleton.cols + 2, CV_8UC1);
+    padded.setTo(cv::Scalar(0));
+    for (int y = 0; y < skeleton.rows; ++y) {
+        const uchar* src = skeleton.ptr<uchar>(y);
+        uchar* dst = padded.ptr<uchar>(y + 1) + 1;
+        for (int x = 0; x < skeleton.cols; ++x) dst[x] = src[x] ? 1 : 0;
+    }
+
+    const int step = static_cast<int>(padded.step[0]);
+    const int offsets[8] = {-step, -step + 1, 1, step + 1, step, step - 1, -1, -step - 1};
+    uchar* base = padded.data;
+
+    node_of.assign(padded.total(), -1);
+    pixels.clear();
+
+    // Single classification scan with row pointers
+    for (int y = 1; y <= skeleton.rows; ++y) {
+        const uchar* above = padded.ptr<uchar>(y - 1);
+        const uchar* row = padded.ptr<uchar>(y);
+        const uchar* below = padded.ptr<uchar>(y + 1);
+        for (int x = 1; x <= skeleton.cols; ++x) {
+            if (!row[x]) continue;
+            const int code =  above[x]
+                           | (above[x + 1] << 1)
+                           | (row[x + 1]   << 2)
+                           | (below[x + 1] << 3)
+                           | (below[x]     << 4)
+                           | (below[x - 1] << 5)
+                           | (row[x - 1]   << 6)
+                           | (above[x - 1] << 7);
+            const int idx = y * step + x;
+            pixels.push_back(idx);
+
+            const int neighbours = table.count[code];
+            if (neighbours == 1 || neighbours >= 3) {
+                node_of[idx] = static_cast<int>(graph.nodes.size());
+                graph.nodes.emplace_back(x - 1, y - 1);
+                (neighbours == 1 ? graph.tipPoints : graph.branchPoints).emplace_back(x - 1, y - 1);
+            }
+        }
+    }
+
+    auto toPoint = [step](int idx) { return cv::Point(idx % step - 1, idx / step - 1); };
+
+    // Follow a chain of plain pixels from cur (reached from prev) until a node or a dead end
+    auto walk = [&](int prev, int cur, int start_node, SkeletonSegment& segment) {
+        while (true) {
+            int next = -1;
+            int next_dir = -1;
+            for (int k = 0; k < 8 && next < 0; ++k) {
+                const int d = WALK_ORDER[k];
+                const int nb = cur + offsets[d];
+                if (nb == prev || !base[nb] || node_of[nb] < 0) continue;
+                if (node_of[nb] == start_node && segment.points.size() < 3) continue;
+                next = nb;
+                next_dir = d;
+            }
+            if (next >= 0) {
+                segment.points.push_back(toPoint(next));
+                segment.length += STEP_LENGTH[next_dir];
+                segment.endNode = node_of[next];
+                return;
+            }
+
+            for (int k = 0; k < 8 && next < 0; ++k) {
+                const int d = WALK_ORDER[k];
+                const int nb = cur + offsets[d];
+                if (base[nb] == 1 && node_of[nb] < 0) {
+                    next = nb;
+                    next_dir = d;
+                }
+            }
+            if (next < 0) return;
+
+            base[next] = 2;
+            segment.points.push_back(toPoint(next));
+            segment.length += STEP_LENGTH[next_dir];
+            prev = cur;
+            cur = next;
+        }
+    };
+
+    std::vector<SkeletonSegment> traced;
+    for (int idx : pixels) {
+        const int node = node_of[idx];
+        if (node < 0) continue;
+        for (int d = 0; d < 8; ++d) {
+            const int nb = idx + offsets[d];
+            if (!base[nb]) continue;
+
+            SkeletonSegment segment;
+            segment.startNode = node;
+            segment.points.push_back(toPoint(idx));
+            segment.points.push_back(toPoint(nb));
+            segment.length = STEP_LENGTH[d];
+
+            if (node_of[nb] >= 0) {
+                // Adjacent nodes: record the link once
+                if (node_of[nb] < node) continue;
+                segment.endNode = node_of[nb];
+            } else {
+                if (base[nb] == 2) continue;
+                base[nb] = 2;
+                walk(idx, nb, node, segment);
+            }
+            traced.push_back(std::move(segment));
+        }
+    }
+
+    // Whatever is left belongs to closed loops without any node
+    for (int idx : pixels) {
+        if (base[idx] != 1 || node_of[idx] >= 0) continue;
+        base[idx] = 2;
+        SkeletonSegment segment;
+        segment.points.push_back(toPoint(idx));
+        walk(-1, idx, -1, segment);
+
+        const cv::Point gap = segment.points.back() - segment.points.front();
+        if (segment.points.size() > 2 && std::abs(gap.x) <= 1 && std::abs(gap.y) <= 1) {
+            segment.length += (gap.x != 0 && gap.y != 0) ? M_SQRT2 : 1.0;
+        }
+        traced.push_back(std::move(segment));
+    }
+
+    std::vector<std::vector<std::pair<int, double>>> adjacency(graph.nodes.size());
+    double longest_segment = 0.0;
+    for (auto& segment : traced) {
+        const cv::Point chord = segment.points.back() - segment.points.front();
+        segment.angle = std::atan2(chord.y, chord.x) * 180.0 / M_PI;
+        longest_segment = std::max(longest_segment, segment.length);
+
+        if (segment.startNode >= 0 && segment.endNode >= 0 && segment.startNode != segment.endNode) {
+            adjacency[segment.startNode].push_back({segment.endNode, segment.length});
+            adjacency[segment.endNode].push_back({segment.startNode, segment.length});
+        }
+
+        if (static_cast<int>(segment.points.size()) >= min_segment_pixels) {
+            graph.totalLength += segment.length;
+            graph.segments.push_back(std::move(segment));
+        }
+    }
+    graph.longestPath = std::max(longest_segment, longestRoute(adjacency));
+
+    return graph;
+}
+
+} // namespace Morphology
+} // namespace PlantVision
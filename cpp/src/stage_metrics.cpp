@@ -0,0 +1,286 @@
+#include "stage_metrics.hpp"
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace {
+
+constexpr int SUBBUCKETS_PER_OCTAVE = 4;
+
+std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+// unique_ptr keeps every histogram at a fixed address while the map grows
+std::map<std::string, std::unique_ptr<LatencyHistogram>>& registry() {
+    static std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms;
+    return histograms;
+}
+
+double bucketLowerMs(int index) {
+    return index == 0 ? 0.0 : LatencyHistogram::bucketUpperMs(index - 1);
+}
+
+double quantileMs(const LatencyHistogram::Snapshot& window, double q) {
+    if (window.count == 0) return 0.0;
+    const double target = std::max(1.0, std::ceil(q * static_cast<double>(window.count)));
+    uint64_t seen = 0;
+    for (int i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+        const uint64_t in_bucket = window.buckets[i];
+        if (in_bucket == 0) continue;
+        if (static_cast<double>(seen + in_bucket) >= target) {
+            // Linear interpolation inside the bucket
+            const double fraction = (target - static_cast<double>(seen)) / static_cast<double>(in_bucket);
+            const double lower = bucketLowerMs(i);
+            return lower + (LatencyHistogram::bucketUpperMs(i) - lower) * fraction;
+        }
+        seen += in_bucket;
+    }
+    return LatencyHistogram::bucketUpperMs(LatencyHistogram::BUCKETS - 1);
+}
+
+std::string formatValue(double value) {
+    std::ostringstream out;
+    out << value;
+    return out.str();
+}
+
+} // namespace
+
+int LatencyHistogram::bucketFor(uint64_t ns) {
+    const double us = static_cast<double>(ns) / 1000.0;
+    if (us <= 1.0) return 0;
+    int exponent = 0;
+    // us = mantissa * 2^exponent with mantissa in [0.5, 1)
+    const double mantissa = std::frexp(us, &exponent);
+    const int octave = exponent - 1;
+    const int sub = std::min(SUBBUCKETS_PER_OCTAVE - 1,
+                             static_cast<int>(std::log2(2.0 * mantissa) * SUBBUCKETS_PER_OCTAVE));
+    return std::min(BUCKETS - 1, 1 + octave * SUBBUCKETS_PER_OCTAVE + sub);
+}
+
+double LatencyHistogram::bucketUpperMs(int index) {
+    return std::pow(2.0, static_cast<double>(index) / SUBBUCKETS_PER_OCTAVE) / 1000.0;
+}
+
+void LatencyHistogram::record(double ms) {
+    const uint64_t ns = ms > 0.0 ? static_cast<uint64_t>(ms * 1e6) : 0;
+    buckets_[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t current = max_ns_.load(std::memory_order_relaxed);
+    while (ns > current && !max_ns_.compare_exchange_weak(current, ns, std::memory_order_relaxed)) {}
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snap;
+    for (int i = 0; i < BUCKETS; ++i) {
+        snap.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    snap.count = count_.load(std::memory_order_relaxed);
+    snap.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+    snap.max_ns = max_ns_.load(std::memory_order_relaxed);
+    return snap;
+}
+
+StageSummary summarizeHistogram(const std::string& stage, const LatencyHistogram::Snapshot& now,
+                                const LatencyHistogram::Snapshot* since) {
+    LatencyHistogram::Snapshot window = now;
+    if (since) {
+        window.count = 0;
+        int highest = -1;
+        for (int i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+            window.buckets[i] = now.buckets[i] - std::min(now.buckets[i], since->buckets[i]);
+            window.count += window.buckets[i];
+            if (window.buckets[i] > 0) highest = i;
+        }
+        window.sum_ns = now.sum_ns - std::min(now.sum_ns, since->sum_ns);
+        // The exact maximum is only known since start; a window reports its highest bucket
+        window.max_ns = highest < 0 ? 0 : static_cast<uint64_t>(
+            std::min(static_cast<double>(now.max_ns), LatencyHistogram::bucketUpperMs(highest) * 1e6));
+    }
+
+    StageSummary summary;
+    summary.stage = stage;
+    summary.count = window.count;
+    summary.sum_ms = static_cast<double>(window.sum_ns) / 1e6;
+    summary.max_ms = static_cast<double>(window.max_ns) / 1e6;
+    if (window.count > 0) {
+        summary.mean_ms = summary.sum_ms / static_cast<double>(window.count);
+        summary.p50_ms = std::min(quantileMs(window, 0.50), summary.max_ms);
+        summary.p95_ms = std::min(quantileMs(window, 0.95), summary.max_ms);
+        summary.p99_ms = std::min(quantileMs(window, 0.99), summary.max_ms);
+    }
+    return summary;
+}
+
+LatencyHistogram& stageHistogram(const std::string& name) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    auto& histogram = registry()[name];
+    if (!histogram) {
+        histogram = std::make_unique<LatencyHistogram>();
+    }
+    return *histogram;
+}
+
+std::map<std::string, LatencyHistogram::Snapshot> snapshotStages() {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    std::map<std::string, LatencyHistogram::Snapshot> snapshots;
+    for (const auto& [name, histogram] : registry()) {
+        snapshots.emplace(name, histogram->snapshot());
+    }
+    return snapshots;
+}
+
+std::string renderPrometheus() {
+    static const char* METRIC = "plantvision_stage_latency_ms";
+    std::ostringstream out;
+    out << "# HELP " << METRIC << " Time spent per pipeline stage since start, in milliseconds.\n";
+    out << "# TYPE " << METRIC << " summary\n";
+    for (const auto& [name, snap] : snapshotStages()) {
+        const StageSummary summary = summarizeHistogram(name, snap);
+        const std::string label = "stage=\"" + name + "\"";
+        out << METRIC << "{" << label << ",quantile=\"0.5\"} " << formatValue(summary.p50_ms) << "\n";
+        out << METRIC << "{" << label << ",quantile=\"0.95\"} " << formatValue(summary.p95_ms) << "\n";
+        out << METRIC << "{" << label << ",quantile=\"0.99\"} " << formatValue(summary.p99_ms) << "\n";
+        out << METRIC << "_sum{" << label << "} " << formatValue(summary.sum_ms) << "\n";
+        out << METRIC << "_count{" << label << "} " << summary.count << "\n";
+    }
+    return out.str();
+}
+
+MetricsReporter::MetricsReporter(std::chrono::milliseconds interval, Callback callback)
+    : interval_(interval), callback_(std::move(callback)) {
+    thread_ = std::thread(&MetricsReporter::run, this);
+}
+
+MetricsReporter::~MetricsReporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void MetricsReporter::run() {
+    std::map<std::string, LatencyHistogram::Snapshot> previous = snapshotStages();
+    auto window_start = std::chrono::steady_clock::now();
+    auto next = window_start + interval_;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (cv_.wait_until(lock, next, [this]() { return stopping_; })) return;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        std::map<std::string, LatencyHistogram::Snapshot> current = snapshotStages();
+        std::vector<StageSummary> stages;
+        stages.reserve(current.size());
+        for (const auto& [name, snap] : current) {
+            auto it = previous.find(name);
+            stages.push_back(summarizeHistogram(name, snap, it != previous.end() ? &it->second : nullptr));
+        }
+        try {
+            callback_(stages, std::chrono::duration<double, std::milli>(now - window_start).count());
+        } catch (const std::exception& e) {
+            std::cerr << "Metrics report failed: " << e.what() << std::endl;
+        }
+        previous = std::move(current);
+        window_start = now;
+        next += interval_;
+        if (next < now) next = now + interval_;
+    }
+}
+
+MetricsHttpServer::~MetricsHttpServer() {
+    stop();
+}
+
+bool MetricsHttpServer::start(int port) {
+    stop();
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) return false;
+    int reuse = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listen_fd_, 8) != 0) {
+        std::cerr << "Metrics endpoint: cannot listen on port " << port << ": " << std::strerror(errno) << std::endl;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&MetricsHttpServer::serveLoop, this);
+    return true;
+}
+
+void MetricsHttpServer::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+void MetricsHttpServer::serveLoop() {
+    while (running_) {
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, 250) <= 0) continue;
+        const int client = ::accept(listen_fd_, nullptr, nullptr);
+        if (client < 0) continue;
+
+        // Scrapers send a small GET; don't let a stalled one hold the thread
+        timeval timeout{1, 0};
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+            const ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            request.append(buffer, static_cast<size_t>(n));
+        }
+
+        std::string status = "200 OK";
+        std::string body;
+        if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0) {
+            body = renderPrometheus();
+        } else {
+            status = "404 Not Found";
+            body = "not found\n";
+        }
+        const std::string response = "HTTP/1.1 " + status + "\r\n"
+                                     "Content-Type: text/plain; version=0.0.4\r\n"
+                                     "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                                     "Connection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            const ssize_t n = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        ::close(client);
+    }
+}
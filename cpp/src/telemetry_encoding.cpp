@@ -0,0 +1,80 @@
+#include "telemetry_encoding.hpp"
+#include "stage_metrics.hpp"
+#include <algorithm>
+#include <cctype>
+
+TelemetryFormat parseTelemetryFormat(const std::string &name) {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (lower == "cbor") return TelemetryFormat::CBOR;
+    if (lower == "msgpack" || lower == "messagepack") return TelemetryFormat::MSGPACK;
+    return TelemetryFormat::JSON;
+}
+
+const char *telemetryFormatName(TelemetryFormat format) {
+    switch (format) {
+        case TelemetryFormat::CBOR: return "cbor";
+        case TelemetryFormat::MSGPACK: return "msgpack";
+        case TelemetryFormat::JSON: break;
+    }
+    return "json";
+}
+
+void encodeTelemetry(const nlohmann::json &value, TelemetryFormat format, std::string &out) {
+    out.clear();
+    switch (format) {
+        case TelemetryFormat::CBOR:
+            nlohmann::json::to_cbor(value, out);
+            return;
+        case TelemetryFormat::MSGPACK:
+            nlohmann::json::to_msgpack(value, out);
+            return;
+        case TelemetryFormat::JSON:
+            break;
+    }
+    out = value.dump();
+}
+
+std::string encodeTelemetry(const nlohmann::json &value, TelemetryFormat format) {
+    std::string out;
+    encodeTelemetry(value, format, out);
+    return out;
+}
+
+SerializedTelemetry serializeTelemetry(const nlohmann::json &value, TelemetryFormat format, bool withJson) {
+    STAGE_TIMER("serialize");
+    SerializedTelemetry serialized;
+    if (format == TelemetryFormat::JSON) {
+        serialized.json = std::make_shared<const std::string>(value.dump());
+        serialized.wire = serialized.json;
+        return serialized;
+    }
+    if (withJson) serialized.json = std::make_shared<const std::string>(value.dump());
+    serialized.wire = std::make_shared<const std::string>(encodeTelemetry(value, format));
+    return serialized;
+}
+
+std::string base64Encode(const unsigned char *data, size_t length) {
+    static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string result(4 * ((length + 2) / 3), '=');
+    char *out = &result[0];
+
+    size_t i = 0;
+    for (; i + 2 < length; i += 3) {
+        const unsigned int v = (static_cast<unsigned int>(data[i]) << 16) |
+                               (static_cast<unsigned int>(data[i + 1]) << 8) | data[i + 2];
+        *out++ = chars[(v >> 18) & 0x3F];
+        *out++ = chars[(v >> 12) & 0x3F];
+        *out++ = chars[(v >> 6) & 0x3F];
+        *out++ = chars[v & 0x3F];
+    }
+    if (i < length) {
+        unsigned int v = static_cast<unsigned int>(data[i]) << 16;
+        if (i + 1 < length) v |= static_cast<unsigned int>(data[i + 1]) << 8;
+        *out++ = chars[(v >> 18) & 0x3F];
+        *out++ = chars[(v >> 12) & 0x3F];
+        if (i + 1 < length) *out = chars[(v >> 6) & 0x3F];
+    }
+    return result;
+}
@@ -0,0 +1,459 @@
+#include "timeseries_store.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint32_t SEGMENT_MAGIC = 0x53545650;  // "PVTS" little-endian
+const uint32_t INDEX_MAGIC = 0x49545650;    // "PVTI"
+const uint16_t SEGMENT_VERSION = 1;
+const uint32_t INDEX_VERSION = 1;
+const size_t SEGMENT_HEADER_BYTES = 64;
+const char* SEGMENT_EXTENSION = ".pvts";
+const char* INDEX_EXTENSION = ".idx";
+
+struct SegmentHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t capacity;
+    uint32_t reserved;
+    uint64_t count;         // records published so far, written last
+    uint32_t sealed;
+};
+
+struct IndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t entries;
+};
+
+struct IndexEntry {
+    int32_t trackId;
+    uint32_t row;
+};
+
+static_assert(sizeof(SegmentHeader) <= SEGMENT_HEADER_BYTES, "segment header outgrew its reserved space");
+static_assert(sizeof(IndexHeader) == 16 && sizeof(IndexEntry) == 8, "index layout is an on-disk format");
+
+SegmentHeader* headerOf(uint8_t* segment) {
+    return reinterpret_cast<SegmentHeader*>(segment);
+}
+
+const SegmentHeader* headerOf(const uint8_t* segment) {
+    return reinterpret_cast<const SegmentHeader*>(segment);
+}
+
+TimeSeriesRecord* recordsOf(uint8_t* segment) {
+    return reinterpret_cast<TimeSeriesRecord*>(segment + SEGMENT_HEADER_BYTES);
+}
+
+const TimeSeriesRecord* recordsOf(const uint8_t* segment) {
+    return reinterpret_cast<const TimeSeriesRecord*>(segment + SEGMENT_HEADER_BYTES);
+}
+
+size_t segmentBytes(uint32_t capacity) {
+    return SEGMENT_HEADER_BYTES + static_cast<size_t>(capacity) * sizeof(TimeSeriesRecord);
+}
+
+bool validHeader(const SegmentHeader& header, size_t fileBytes) {
+    return header.magic == SEGMENT_MAGIC && header.version == SEGMENT_VERSION &&
+           header.record_size == sizeof(TimeSeriesRecord) && header.capacity > 0 &&
+           segmentBytes(header.capacity) <= fileBytes;
+}
+
+std::string indexPath(const std::string& segmentPath) {
+    return segmentPath.substr(0, segmentPath.size() - std::strlen(SEGMENT_EXTENSION)) + INDEX_EXTENSION;
+}
+
+// Zero-padded, so the names sort in time order
+std::string segmentName(int64_t firstTimestampMs) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "segment_%020lld%s", static_cast<long long>(std::max<int64_t>(0, firstTimestampMs)), SEGMENT_EXTENSION);
+    return name;
+}
+
+std::vector<std::string> listSegments(const std::string& directory) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() == SEGMENT_EXTENSION) paths.push_back(it->path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// Read-only mapping of a whole file; the descriptor is not needed once mapped
+const uint8_t* mapReadOnly(const std::string& path, size_t& bytes) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st{};
+    void* mapped = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        bytes = static_cast<size_t>(st.st_size);
+        mapped = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    return mapped == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(mapped);
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Writer
+
+TimeSeriesWriter::TimeSeriesWriter(TimeSeriesOptions options) : options_(std::move(options)) {
+    options_.segmentRecords = std::max<uint32_t>(1, options_.segmentRecords);
+
+    std::error_code ec;
+    fs::create_directories(options_.directory, ec);
+    const std::string lockPath = options_.directory + "/.lock";
+    lock_fd_ = ::open(lockPath.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (lock_fd_ < 0) {
+        std::cerr << "Time series: cannot open " << lockPath << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    if (::flock(lock_fd_, LOCK_EX | LOCK_NB) != 0) {
+        std::cerr << "Time series: " << options_.directory << " is in use by another writer" << std::endl;
+        ::close(lock_fd_);
+        lock_fd_ = -1;
+        return;
+    }
+    max_track_id_ = TimeSeriesReader(options_.directory).maxTrackId();
+    resumeLastSegment();
+}
+
+TimeSeriesWriter::~TimeSeriesWriter() {
+    if (segment_) {
+        ::msync(segment_, segment_bytes_, MS_ASYNC);
+        ::munmap(segment_, segment_bytes_);
+    }
+    if (segment_fd_ >= 0) ::close(segment_fd_);
+    if (lock_fd_ >= 0) ::close(lock_fd_);
+}
+
+// Keeps appending to the newest segment after a restart, sealing it first if it filled up
+bool TimeSeriesWriter::resumeLastSegment() {
+    const std::vector<std::string> segments = listSegments(options_.directory);
+    if (segments.empty()) return false;
+
+    const std::string& path = segments.back();
+    const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < SEGMENT_HEADER_BYTES) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    uint8_t* segment = static_cast<uint8_t*>(mapped);
+    SegmentHeader* header = headerOf(segment);
+    if (!validHeader(*header, static_cast<size_t>(st.st_size))) {
+        // Left alone for inspection; the next append starts a fresh segment
+        std::cerr << "Time series: ignoring unreadable segment " << path << std::endl;
+        ::munmap(mapped, static_cast<size_t>(st.st_size));
+        ::close(fd);
+        return false;
+    }
+
+    segment_ = segment;
+    segment_fd_ = fd;
+    segment_bytes_ = static_cast<size_t>(st.st_size);
+    segment_path_ = path;
+    header->count = std::min<uint64_t>(header->count, header->capacity);
+    if (header->count > 0) {
+        last_timestamp_ = recordsOf(segment_)[header->count - 1].timestampMs;
+    }
+    if (header->sealed || header->count == header->capacity) {
+        sealSegment();
+    }
+    return true;
+}
+
+bool TimeSeriesWriter::createSegment(int64_t firstTimestampMs) {
+    const size_t bytes = segmentBytes(options_.segmentRecords);
+    int fd = -1;
+    std::string path;
+    // Names only need to sort; step past a segment that already claimed this millisecond
+    for (int attempt = 0; attempt < 16 && fd < 0; ++attempt) {
+        path = options_.directory + "/" + segmentName(firstTimestampMs + attempt);
+        fd = ::open(path.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+        if (fd < 0 && errno != EEXIST) break;
+    }
+    if (fd < 0) {
+        std::cerr << "Time series: cannot create " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // Reserve the blocks now: a full disk fails here instead of as SIGBUS on a mapped store
+    const int err = ::posix_fallocate(fd, 0, static_cast<off_t>(bytes));
+    void* mapped = err == 0 ? ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Time series: cannot allocate " << path << ": " << std::strerror(err ? err : errno) << std::endl;
+        ::close(fd);
+        ::unlink(path.c_str());
+        return false;
+    }
+
+    segment_ = static_cast<uint8_t*>(mapped);
+    segment_fd_ = fd;
+    segment_bytes_ = bytes;
+    segment_path_ = path;
+    SegmentHeader* header = headerOf(segment_);
+    header->magic = SEGMENT_MAGIC;
+    header->version = SEGMENT_VERSION;
+    header->record_size = sizeof(TimeSeriesRecord);
+    header->capacity = options_.segmentRecords;
+    header->reserved = 0;
+    header->sealed = 0;
+    __atomic_store_n(&header->count, uint64_t(0), __ATOMIC_RELEASE);
+    return true;
+}
+
+// Writes the track index beside the full segment and lets go of it
+void TimeSeriesWriter::sealSegment() {
+    SegmentHeader* header = headerOf(segment_);
+    const TimeSeriesRecord* records = recordsOf(segment_);
+    const uint64_t count = header->count;
+
+    std::vector<IndexEntry> entries(count);
+    for (uint64_t row = 0; row < count; ++row) {
+        entries[row] = IndexEntry{records[row].trackId, static_cast<uint32_t>(row)};
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const IndexEntry& a, const IndexEntry& b) {
+        return a.trackId < b.trackId;
+    });
+
+    const std::string path = indexPath(segment_path_);
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        const IndexHeader indexHeader{INDEX_MAGIC, INDEX_VERSION, count};
+        out.write(reinterpret_cast<const char*>(&indexHeader), sizeof(indexHeader));
+        out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(IndexEntry)));
+        if (!out) std::cerr << "Time series: cannot write " << tmpPath << std::endl;
+    }
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec) std::cerr << "Time series: cannot write " << path << ": " << ec.message() << std::endl;
+
+    header->sealed = 1;
+    ::msync(segment_, segment_bytes_, MS_ASYNC);
+    ::munmap(segment_, segment_bytes_);
+    ::close(segment_fd_);
+    segment_ = nullptr;
+    segment_fd_ = -1;
+    segment_bytes_ = 0;
+    segment_path_.clear();
+}
+
+bool TimeSeriesWriter::append(const TimeSeriesRecord* records, size_t count) {
+    if (!isOpen()) return false;
+
+    size_t done = 0;
+    while (done < count) {
+        if (!segment_ && !createSegment(std::max(records[done].timestampMs, last_timestamp_))) return false;
+
+        SegmentHeader* header = headerOf(segment_);
+        const uint64_t used = header->count;
+        const size_t chunk = std::min<size_t>(header->capacity - used, count - done);
+        TimeSeriesRecord* out = recordsOf(segment_) + used;
+        for (size_t i = 0; i < chunk; ++i) {
+            out[i] = records[done + i];
+            // Readers binary-search on time, so a clock stepping back must not reorder the store
+            out[i].timestampMs = std::max(out[i].timestampMs, last_timestamp_);
+            last_timestamp_ = out[i].timestampMs;
+            max_track_id_ = std::max(max_track_id_, out[i].trackId);
+        }
+        __atomic_store_n(&header->count, used + chunk, __ATOMIC_RELEASE);
+        done += chunk;
+        records_written_ += chunk;
+
+        if (used + chunk == header->capacity) sealSegment();
+    }
+    return true;
+}
+
+void TimeSeriesWriter::flush() {
+    if (segment_) ::msync(segment_, segment_bytes_, MS_ASYNC);
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+
+struct TimeSeriesReader::Segment {
+    std::string path;
+    const uint8_t* data = nullptr;
+    size_t bytes = 0;
+    const uint8_t* indexData = nullptr;
+    size_t indexBytes = 0;
+
+    ~Segment() {
+        if (data) ::munmap(const_cast<uint8_t*>(data), bytes);
+        if (indexData) ::munmap(const_cast<uint8_t*>(indexData), indexBytes);
+    }
+
+    uint32_t capacity() const { return headerOf(data)->capacity; }
+
+    uint64_t count() const {
+        const uint64_t published = __atomic_load_n(&headerOf(data)->count, __ATOMIC_ACQUIRE);
+        return std::min<uint64_t>(published, capacity());
+    }
+
+    const TimeSeriesRecord* records() const { return recordsOf(data); }
+
+    const IndexEntry* indexBegin() const {
+        return reinterpret_cast<const IndexEntry*>(indexData + sizeof(IndexHeader));
+    }
+
+    const IndexEntry* indexEnd() const {
+        return indexBegin() + reinterpret_cast<const IndexHeader*>(indexData)->entries;
+    }
+
+    // Only trusted when it covers exactly the sealed segment's records
+    void loadIndex() {
+        if (indexData || !headerOf(data)->sealed) return;
+        size_t mappedBytes = 0;
+        const uint8_t* mapped = mapReadOnly(indexPath(path), mappedBytes);
+        if (!mapped) return;
+        const IndexHeader* header = reinterpret_cast<const IndexHeader*>(mapped);
+        if (mappedBytes < sizeof(IndexHeader) || header->magic != INDEX_MAGIC || header->version != INDEX_VERSION ||
+            header->entries != count() || sizeof(IndexHeader) + header->entries * sizeof(IndexEntry) > mappedBytes) {
+            ::munmap(const_cast<uint8_t*>(mapped), mappedBytes);
+            return;
+        }
+        indexData = mapped;
+        indexBytes = mappedBytes;
+    }
+};
+
+TimeSeriesReader::TimeSeriesReader(std::string directory) : directory_(std::move(directory)) {
+    refresh();
+}
+
+TimeSeriesReader::~TimeSeriesReader() = default;
+
+void TimeSeriesReader::refresh() {
+    std::set<std::string> known;
+    for (const auto& segment : segments_) known.insert(segment->path);
+
+    for (const std::string& path : listSegments(directory_)) {
+        if (known.count(path)) continue;
+        auto segment = std::make_unique<Segment>();
+        segment->path = path;
+        segment->data = mapReadOnly(path, segment->bytes);
+        if (!segment->data || segment->bytes < SEGMENT_HEADER_BYTES || !validHeader(*headerOf(segment->data), segment->bytes)) {
+            continue;
+        }
+        segments_.push_back(std::move(segment));
+    }
+    std::sort(segments_.begin(), segments_.end(), [](const auto& a, const auto& b) { return a->path < b->path; });
+
+    // The segment being written when it was mapped may have been sealed since
+    for (auto& segment : segments_) segment->loadIndex();
+}
+
+void TimeSeriesReader::forEach(int32_t trackId, int64_t fromMs, int64_t toMs,
+                               const std::function<void(const TimeSeriesRecord&)>& visit) const {
+    for (const auto& segment : segments_) {
+        const uint64_t count = segment->count();
+        if (count == 0) continue;
+        const TimeSeriesRecord* records = segment->records();
+        if (records[count - 1].timestampMs < fromMs || records[0].timestampMs > toMs) continue;
+
+        if (trackId != ANY_TRACK && segment->indexData) {
+            // A track's rows are ascending, so their timestamps are too
+            auto range = std::equal_range(segment->indexBegin(), segment->indexEnd(), IndexEntry{trackId, 0},
+                                          [](const IndexEntry& a, const IndexEntry& b) { return a.trackId < b.trackId; });
+            auto it = std::partition_point(range.first, range.second,
+                                           [&](const IndexEntry& entry) { return records[entry.row].timestampMs < fromMs; });
+            for (; it != range.second && records[it->row].timestampMs <= toMs; ++it) {
+                visit(records[it->row]);
+            }
+            continue;
+        }
+
+        const TimeSeriesRecord* end = records + count;
+        const TimeSeriesRecord* it = std::partition_point(records, end,
+                                                          [&](const TimeSeriesRecord& record) { return record.timestampMs < fromMs; });
+        for (; it != end && it->timestampMs <= toMs; ++it) {
+            if (trackId == ANY_TRACK || it->trackId == trackId) visit(*it);
+        }
+    }
+}
+
+std::vector<TimeSeriesRecord> TimeSeriesReader::query(int32_t trackId, int64_t fromMs, int64_t toMs) const {
+    std::vector<TimeSeriesRecord> result;
+    forEach(trackId, fromMs, toMs, [&](const TimeSeriesRecord& record) { result.push_back(record); });
+    return result;
+}
+
+std::vector<TimeSeriesReader::TrackSummary> TimeSeriesReader::tracks() const {
+    std::map<int32_t, TrackSummary> summaries;
+    auto add = [&](int32_t trackId, uint64_t records, int64_t firstMs, int64_t lastMs) {
+        auto inserted = summaries.emplace(trackId, TrackSummary{trackId, 0, firstMs, lastMs});
+        TrackSummary& summary = inserted.first->second;
+        summary.records += records;
+        summary.firstMs = std::min(summary.firstMs, firstMs);
+        summary.lastMs = std::max(summary.lastMs, lastMs);
+    };
+
+    for (const auto& segment : segments_) {
+        const uint64_t count = segment->count();
+        const TimeSeriesRecord* records = segment->records();
+        if (segment->indexData) {
+            // One step per track: the first and last row of its run give its span
+            const IndexEntry* it = segment->indexBegin();
+            const IndexEntry* end = segment->indexEnd();
+            while (it != end) {
+                const IndexEntry* runEnd = std::upper_bound(it, end, *it,
+                    [](const IndexEntry& a, const IndexEntry& b) { return a.trackId < b.trackId; });
+                add(it->trackId, static_cast<uint64_t>(runEnd - it),
+                    records[it->row].timestampMs, records[(runEnd - 1)->row].timestampMs);
+                it = runEnd;
+            }
+            continue;
+        }
+        for (uint64_t row = 0; row < count; ++row) {
+            add(records[row].trackId, 1, records[row].timestampMs, records[row].timestampMs);
+        }
+    }
+
+    std::vector<TrackSummary> result;
+    result.reserve(summaries.size());
+    for (const auto& entry : summaries) result.push_back(entry.second);
+    return result;
+}
+
+int32_t TimeSeriesReader::maxTrackId() const {
+    int32_t maxId = -1;
+    for (const auto& segment : segments_) {
+        if (segment->indexData) {
+            if (segment->indexEnd() != segment->indexBegin()) maxId = std::max(maxId, (segment->indexEnd() - 1)->trackId);
+            continue;
+        }
+        const uint64_t count = segment->count();
+        const TimeSeriesRecord* records = segment->records();
+        for (uint64_t row = 0; row < count; ++row) maxId = std::max(maxId, records[row].trackId);
+    }
+    return maxId;
+}
@@ -0,0 +1,179 @@
+#include "vegetation_indices.hpp"
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+struct Accumulator {
+    uint64_t count = 0;
+    uint64_t sum[3] = {0, 0, 0};
+    uint64_t sumSq[3] = {0, 0, 0};
+    double ndviSum = 0.0;
+};
+
+#if CV_SIMD && !CV_SIMD_SCALABLE
+
+// OpenCV 4.9 replaced the intrinsic operators with named functions
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 9)
+template <typename V> inline V simdAdd(const V &a, const V &b) { return cv::v_add(a, b); }
+template <typename V> inline V simdSub(const V &a, const V &b) { return cv::v_sub(a, b); }
+template <typename V> inline V simdDiv(const V &a, const V &b) { return cv::v_div(a, b); }
+template <typename V> inline V simdAnd(const V &a, const V &b) { return cv::v_and(a, b); }
+template <typename V> inline V simdNe(const V &a, const V &b) { return cv::v_ne(a, b); }
+inline int u8Lanes() { return cv::VTraits<cv::v_uint8>::vlanes(); }
+#else
+template <typename V> inline V simdAdd(const V &a, const V &b) { return a + b; }
+template <typename V> inline V simdSub(const V &a, const V &b) { return a - b; }
+template <typename V> inline V simdDiv(const V &a, const V &b) { return a / b; }
+template <typename V> inline V simdAnd(const V &a, const V &b) { return a & b; }
+template <typename V> inline V simdNe(const V &a, const V &b) { return a != b; }
+inline int u8Lanes() { return cv::v_uint8::nlanes; }
+#endif
+
+// Widen two u16 halves and sum them into u32 lanes
+inline cv::v_uint32 widenSum(const cv::v_uint16 &lo, const cv::v_uint16 &hi) {
+    cv::v_uint32 a, b;
+    cv::v_expand(simdAdd(lo, hi), a, b);
+    return simdAdd(a, b);
+}
+
+inline cv::v_int32 squareSum(const cv::v_uint16 &lo, const cv::v_uint16 &hi) {
+    cv::v_int16 l = cv::v_reinterpret_as_s16(lo);
+    cv::v_int16 h = cv::v_reinterpret_as_s16(hi);
+    return simdAdd(cv::v_dotprod(l, l), cv::v_dotprod(h, h));
+}
+
+inline cv::v_float32 ndviLanes(const cv::v_uint16 &g, const cv::v_uint16 &r, const cv::v_float32 &eps) {
+    cv::v_uint32 g0, g1, r0, r1;
+    cv::v_expand(g, g0, g1);
+    cv::v_expand(r, r0, r1);
+    cv::v_float32 fg0 = cv::v_cvt_f32(cv::v_reinterpret_as_s32(g0));
+    cv::v_float32 fg1 = cv::v_cvt_f32(cv::v_reinterpret_as_s32(g1));
+    cv::v_float32 fr0 = cv::v_cvt_f32(cv::v_reinterpret_as_s32(r0));
+    cv::v_float32 fr1 = cv::v_cvt_f32(cv::v_reinterpret_as_s32(r1));
+    return simdAdd(simdDiv(simdSub(fg0, fr0), simdAdd(simdAdd(fg0, fr0), eps)),
+                   simdDiv(simdSub(fg1, fr1), simdAdd(simdAdd(fg1, fr1), eps)));
+}
+
+// Squared sums are kept in 32-bit lanes, so flush to 64-bit at least every
+// BLOCK_PIXELS pixels (4096 * 255^2 stays well inside int32 per lane).
+constexpr int BLOCK_PIXELS = 4096;
+
+template <bool Masked>
+int accumulateSimd(const uchar *src, const uchar *mask, int cols, Accumulator &acc) {
+    const int step = u8Lanes();
+    const cv::v_uint8 zero8 = cv::vx_setzero_u8();
+    const cv::v_uint8 one8 = cv::vx_setall_u8(1);
+    const cv::v_float32 eps = cv::vx_setall_f32(1e-10f);
+
+    int x = 0;
+    while (x <= cols - step) {
+        const int blockEnd = std::min(cols, x + BLOCK_PIXELS);
+        cv::v_uint32 count = cv::vx_setzero_u32();
+        cv::v_uint32 sumB = cv::vx_setzero_u32(), sumG = cv::vx_setzero_u32(), sumR = cv::vx_setzero_u32();
+        cv::v_int32 sqB = cv::vx_setzero_s32(), sqG = cv::vx_setzero_s32(), sqR = cv::vx_setzero_s32();
+        cv::v_float32 ndvi = cv::vx_setzero_f32();
+
+        for (; x <= blockEnd - step; x += step) {
+            cv::v_uint8 b, g, r;
+            cv::v_load_deinterleave(src + 3 * x, b, g, r);
+
+            cv::v_uint8 ones = one8;
+            if (Masked) {
+                cv::v_uint8 m = simdNe(cv::vx_load(mask + x), zero8);
+                b = simdAnd(b, m);
+                g = simdAnd(g, m);
+                r = simdAnd(r, m);
+                ones = simdAnd(ones, m);
+            }
+
+            cv::v_uint16 b0, b1, g0, g1, r0, r1, c0, c1;
+            cv::v_expand(b, b0, b1);
+            cv::v_expand(g, g0, g1);
+            cv::v_expand(r, r0, r1);
+            cv::v_expand(ones, c0, c1);
+
+            count = simdAdd(count, widenSum(c0, c1));
+            sumB = simdAdd(sumB, widenSum(b0, b1));
+            sumG = simdAdd(sumG, widenSum(g0, g1));
+            sumR = simdAdd(sumR, widenSum(r0, r1));
+            sqB = simdAdd(sqB, squareSum(b0, b1));
+            sqG = simdAdd(sqG, squareSum(g0, g1));
+            sqR = simdAdd(sqR, squareSum(r0, r1));
+
+            // Masked-out pixels are zero on every channel and contribute 0 / eps = 0
+            ndvi = simdAdd(ndvi, simdAdd(ndviLanes(g0, r0, eps), ndviLanes(g1, r1, eps)));
+        }
+
+        acc.count += cv::v_reduce_sum(count);
+        acc.sum[0] += cv::v_reduce_sum(sumB);
+        acc.sum[1] += cv::v_reduce_sum(sumG);
+        acc.sum[2] += cv::v_reduce_sum(sumR);
+        acc.sumSq[0] += static_cast<uint64_t>(cv::v_reduce_sum(sqB));
+        acc.sumSq[1] += static_cast<uint64_t>(cv::v_reduce_sum(sqG));
+        acc.sumSq[2] += static_cast<uint64_t>(cv::v_reduce_sum(sqR));
+        acc.ndviSum += cv::v_reduce_sum(ndvi);
+    }
+    return x;
+}
+
+#endif
+
+template <bool Masked>
+void accumulateRow(const uchar *src, const uchar *mask, int cols, Accumulator &acc) {
+    int x = 0;
+#if CV_SIMD && !CV_SIMD_SCALABLE
+    x = accumulateSimd<Masked>(src, mask, cols, acc);
+#endif
+    for (; x < cols; ++x) {
+        if (Masked && mask[x] == 0) continue;
+
+        const unsigned b = src[3 * x], g = src[3 * x + 1], r = src[3 * x + 2];
+        acc.count++;
+        acc.sum[0] += b;
+        acc.sum[1] += g;
+        acc.sum[2] += r;
+        acc.sumSq[0] += b * b;
+        acc.sumSq[1] += g * g;
+        acc.sumSq[2] += r * r;
+        if (g + r > 0) {
+            acc.ndviSum += (static_cast<double>(g) - static_cast<double>(r)) / static_cast<double>(g + r);
+        }
+    }
+}
+
+} // namespace
+
+VegetationStats computeVegetationStats(const cv::Mat &bgr, const cv::Mat &mask) {
+    VegetationStats stats;
+    if (bgr.empty() || bgr.type() != CV_8UC3) return stats;
+
+    const bool masked = !mask.empty();
+    if (masked && (mask.size() != bgr.size() || mask.type() != CV_8UC1)) return stats;
+
+    Accumulator acc;
+    for (int y = 0; y < bgr.rows; ++y) {
+        const uchar *src = bgr.ptr<uchar>(y);
+        if (masked) {
+            accumulateRow<true>(src, mask.ptr<uchar>(y), bgr.cols, acc);
+        } else {
+            accumulateRow<false>(src, nullptr, bgr.cols, acc);
+        }
+    }
+
+    if (acc.count == 0) return stats;
+
+    const double n = static_cast<double>(acc.count);
+    stats.pixelCount = static_cast<int>(acc.count);
+    for (int c = 0; c < 3; ++c) {
+        double mean = acc.sum[c] / n;
+        double variance = acc.sumSq[c] / n - mean * mean;
+        stats.meanBgr[c] = mean;
+        stats.stdBgr[c] = std::sqrt(std::max(0.0, variance));
+    }
+    stats.ndvi = acc.ndviSum / n;
+    stats.exg = (2.0 * acc.sum[1] - static_cast<double>(acc.sum[2]) - static_cast<double>(acc.sum[0])) / (255.0 * n);
+    return stats;
+}
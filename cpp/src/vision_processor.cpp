@@ -1,4 +1,7 @@
 #include "vision_processor.hpp"
+#include "scratch_pool.hpp"
+#include "stage_metrics.hpp"
+#include "vegetation_indices.hpp"
 #include <opencv2/opencv.hpp>
 #include <nlohmann/json.hpp>
 #include <filesystem>
@@ -10,7 +13,7 @@
 using json = nlohmann::json;
 
 VisionProcessor::VisionProcessor() 
-    : frame_counter_(0), baseline_established_(false), debug_mode_(false) {
+    : has_previous_frame_(false), frame_counter_(0), baseline_established_(false), debug_mode_(false) {
     
     // Create necessary directories
     std::filesystem::create_directories(data_dir_);
@@ -27,6 +30,16 @@ VisionProcessor::~VisionProcessor() {
 }
 
 VisionProcessor::BasicMetrics VisionProcessor::processBasicMetrics(const cv::Mat& frame) {
+    FrameContext context(frame);
+    return processBasicMetrics(context);
+}
+
+VisionProcessor::BasicMetrics VisionProcessor::processBasicMetrics(const FrameContext& context) {
+    STAGE_TIMER("basic_metrics");
+    const cv::Mat& frame = context.bgr();
+    // Each pixel of a reduced level stands for scale * scale full-frame pixels
+    const FrameContext& view = context.level(config_.analysis_scale);
+    const double pixel_weight = static_cast<double>(frame.total()) / std::max<size_t>(1, view.bgr().total());
     auto start_time = std::chrono::high_resolution_clock::now();
     
     BasicMetrics metrics;
@@ -42,14 +55,19 @@ VisionProcessor::BasicMetrics VisionProcessor::processBasicMetrics(const cv::Mat
     
     try {
         // Step 1: Create optimized plant mask (consolidates Python duplicate)
-        cv::Mat plant_mask = createPlantMask(frame, false);
+        cv::Mat plant_mask = createPlantMask(view, false);
         
         // Step 2: Comprehensive color analysis (replaces Python cv2 operations)
-        metrics.color_analysis = analyzeColors(frame, plant_mask);
-        
-        // Step 3: Change detection (moved from Python to C++)
-        if (!previous_frame_.empty()) {
-            metrics.change_detection = detectChanges(frame, previous_frame_);
+        metrics.color_analysis = analyzeColors(view, plant_mask);
+        metrics.color_analysis.total_green_pixels = static_cast<int>(metrics.color_analysis.total_green_pixels * pixel_weight + 0.5);
+        
+        // Step 3: Change detection against the cached previous-frame analysis
+        if (has_previous_frame_ && baseline_established_) {
+            metrics.change_detection = compareFrames(metrics.color_analysis, previous_colors_,
+                                                     view.gray(), previous_gray_, pixel_weight);
+        } else if (has_previous_frame_) {
+            metrics.change_detection.significant_change = true;
+            metrics.change_detection.change_reason = "insufficient_data";
         } else {
             metrics.change_detection.significant_change = true; // First frame
             metrics.change_detection.change_reason = "first_frame";
@@ -69,12 +87,14 @@ VisionProcessor::BasicMetrics VisionProcessor::processBasicMetrics(const cv::Mat
         
         // Step 6: Debug output if enabled
         if (debug_mode_) {
-            saveDebugImages(frame, plant_mask, std::to_string(frame_counter_));
+            saveDebugImages(view.bgr(), plant_mask, std::to_string(frame_counter_));
             logMetrics(metrics);
         }
         
         // Update state for next frame
-        frame.copyTo(previous_frame_);
+        view.gray().copyTo(previous_gray_);
+        previous_colors_ = metrics.color_analysis;
+        has_previous_frame_ = true;
         
         auto end_time = std::chrono::high_resolution_clock::now();
         auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -97,10 +117,23 @@ VisionProcessor::BasicMetrics VisionProcessor::processBasicMetrics(const cv::Mat
 }
 
 cv::Mat VisionProcessor::createPlantMask(const cv::Mat& frame, bool enhanced_sensitivity) {
-    cv::Mat hsv, mask;
-    
-    // Convert to HSV color space (consolidating duplicate from Python)
-    cv::cvtColor(frame, hsv, cv::COLOR_BGR2HSV);
+    FrameContext context(frame);
+    return createPlantMask(context, enhanced_sensitivity);
+}
+
+cv::Mat VisionProcessor::createPlantMask(const FrameContext& context, bool enhanced_sensitivity) {
+    // The default configuration matches the context's cached green mask exactly
+    bool default_mask = !enhanced_sensitivity &&
+        config_.enable_morphological_processing &&
+        config_.morph_kernel_size == cv::Size(5, 5) &&
+        config_.hsv_lower_bound == FrameContext::GREEN_HSV_LOWER &&
+        config_.hsv_upper_bound == FrameContext::GREEN_HSV_UPPER;
+    if (default_mask) {
+        return context.greenMask();
+    }
+
+    const cv::Mat& hsv = context.hsv();
+    cv::Mat mask = ScratchPool::shared().acquire(hsv.size(), CV_8UC1);
     
     // Apply green range detection (unified from both C++ and Python implementations)
     cv::Scalar lower_bound = config_.hsv_lower_bound;
@@ -127,10 +160,17 @@ cv::Mat VisionProcessor::createPlantMask(const cv::Mat& frame, bool enhanced_sen
 }
 
 VisionProcessor::ColorAnalysis VisionProcessor::analyzeColors(const cv::Mat& frame, const cv::Mat& mask) {
+    FrameContext context(frame);
+    return analyzeColors(context, mask);
+}
+
+VisionProcessor::ColorAnalysis VisionProcessor::analyzeColors(const FrameContext& context, const cv::Mat& mask) {
+    const cv::Mat& frame = context.bgr();
     ColorAnalysis analysis;
     
-    // Count green pixels
-    analysis.total_green_pixels = cv::countNonZero(mask);
+    // Green pixel count, BGR statistics and vegetation indices in one fused pass
+    VegetationStats stats = computeVegetationStats(frame, mask);
+    analysis.total_green_pixels = stats.pixelCount;
     analysis.green_ratio = static_cast<double>(analysis.total_green_pixels) / 
                           (frame.rows * frame.cols);
     
@@ -140,24 +180,14 @@ VisionProcessor::ColorAnalysis VisionProcessor::analyzeColors(const cv::Mat& fra
         return analysis;
     }
     
-    // Multi-colorspace analysis (consolidating Python duplicate processing)
-    cv::Mat hsv, lab;
-    cv::cvtColor(frame, hsv, cv::COLOR_BGR2HSV);
-    cv::cvtColor(frame, lab, cv::COLOR_BGR2Lab);
+    analysis.mean_bgr = stats.meanBgr;
+    analysis.std_bgr = stats.stdBgr;
+    analysis.ndvi = stats.ndvi;
+    analysis.exg = stats.exg;
     
-    // Calculate mean values for each color space
-    analysis.mean_bgr = cv::mean(frame, mask);
-    analysis.mean_hsv = cv::mean(hsv, mask);
-    analysis.mean_lab = cv::mean(lab, mask);
-    
-    // Calculate standard deviations
-    analysis.std_bgr = calculateColorStd(frame, mask, 0); // BGR
-    analysis.std_hsv = calculateColorStd(hsv, mask, 1);   // HSV  
-    analysis.std_lab = calculateColorStd(lab, mask, 2);   // LAB
-    
-    // Vegetation indices (moving from Python to C++ for performance)
-    analysis.ndvi = calculateNDVI(frame, mask);
-    analysis.exg = calculateEXG(frame, mask);
+    // Multi-colorspace analysis on the shared cached planes
+    calculateColorStats(context.hsv(), mask, analysis.mean_hsv, analysis.std_hsv);
+    calculateColorStats(context.lab(), mask, analysis.mean_lab, analysis.std_lab);
     
     // Health indicator calculation (unified from both implementations)
     double green_bias = analysis.mean_bgr[1] - (analysis.mean_bgr[0] + analysis.mean_bgr[2]) / 2.0;
@@ -181,15 +211,31 @@ VisionProcessor::ChangeDetectionResult VisionProcessor::detectChanges(const cv::
         return result;
     }
     
+    FrameContext current_context(current_frame);
+    FrameContext previous_context(previous_frame);
+    try {
+        ColorAnalysis current_colors = analyzeColors(current_context, createPlantMask(current_context, false));
+        ColorAnalysis previous_colors = analyzeColors(previous_context, createPlantMask(previous_context, false));
+        return compareFrames(current_colors, previous_colors, current_context.gray(), previous_context.gray());
+    } catch (const cv::Exception& e) {
+        std::cerr << "Change detection error: " << e.what() << std::endl;
+        result.significant_change = true; // Fail safe - trigger AI analysis
+        result.change_reason = "detection_error";
+    }
+    
+    return result;
+}
+
+VisionProcessor::ChangeDetectionResult VisionProcessor::compareFrames(const ColorAnalysis& current_colors,
+                                                                      const ColorAnalysis& previous_colors,
+                                                                      const cv::Mat& current_gray,
+                                                                      const cv::Mat& previous_gray,
+                                                                      double pixel_weight) {
+    ChangeDetectionResult result;
+    result.significant_change = false;
+    result.motion_magnitude = 0.0;
+    
     try {
-        // Create masks for both frames
-        cv::Mat current_mask = createPlantMask(current_frame, false);
-        cv::Mat previous_mask = createPlantMask(previous_frame, false);
-        
-        // Color analysis for both frames
-        ColorAnalysis current_colors = analyzeColors(current_frame, current_mask);
-        ColorAnalysis previous_colors = analyzeColors(previous_frame, previous_mask);
-        
         // Calculate changes (replacing Python duplicate logic)
         result.hue_change = std::abs(current_colors.mean_hsv[0] - previous_colors.mean_hsv[0]);
         result.saturation_change = std::abs(current_colors.mean_hsv[1] - previous_colors.mean_hsv[1]);
@@ -199,7 +245,7 @@ VisionProcessor::ChangeDetectionResult VisionProcessor::detectChanges(const cv::
         
         // Motion detection using OpenCV (new addition, was missing in Python)
         if (config_.enable_motion_detection) {
-            result.motion_magnitude = calculateMotionMagnitude(current_frame, previous_frame);
+            result.motion_magnitude = calculateMotionMagnitude(current_gray, previous_gray) * pixel_weight;
         }
         
         // Check thresholds (moved from Python configuration)
@@ -233,23 +279,31 @@ VisionProcessor::ChangeDetectionResult VisionProcessor::detectChanges(const cv::
 }
 
 VisionProcessor::AIRequestData VisionProcessor::generateAIRequest(const cv::Mat& frame, const BasicMetrics& metrics) {
+    FrameContext context(frame);
+    return generateAIRequest(context, metrics);
+}
+
+VisionProcessor::AIRequestData VisionProcessor::generateAIRequest(const FrameContext& context, const BasicMetrics& metrics, bool save_frame) {
+    const cv::Mat& frame = context.bgr();
     AIRequestData request;
     
     // Save frame for AI processing
-    std::string request_id = "frame_" + std::to_string(metrics.frame_number) + "_" + 
-                            std::to_string(static_cast<int>(metrics.timestamp));
-    std::string frame_path = ai_requests_dir_ + "/" + request_id + ".jpg";
-    
-    cv::imwrite(frame_path, frame, {cv::IMWRITE_JPEG_QUALITY, 95});
+    if (save_frame) {
+        std::string request_id = "frame_" + std::to_string(metrics.frame_number) + "_" + 
+                                std::to_string(static_cast<int>(metrics.timestamp));
+        std::string frame_path = ai_requests_dir_ + "/" + request_id + ".jpg";
+        
+        cv::imwrite(frame_path, frame, {cv::IMWRITE_JPEG_QUALITY, 95});
+        request.image_path = frame_path;
+    }
     
-    request.image_path = frame_path;
     request.model_preference = "dpt_swin2"; // Default to best performing model
     request.depth_analysis_required = true;
     request.classification_required = true;
     request.confidence_threshold = 0.7;
     
     // Set ROI based on detected plant regions (optimization for AI processing)
-    cv::Mat mask = createPlantMask(frame, false);
+    cv::Mat mask = createPlantMask(context, false);
     std::vector<std::vector<cv::Point>> contours;
     cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
     
@@ -272,24 +326,28 @@ VisionProcessor::AIRequestData VisionProcessor::generateAIRequest(const cv::Mat&
     return request;
 }
 
+json VisionProcessor::serializeAIRequest(const AIRequestData& request, const std::string& request_id) const {
+    return {
+        {"image_path", request.image_path},
+        {"model_preference", request.model_preference},
+        {"depth_analysis_required", request.depth_analysis_required},
+        {"classification_required", request.classification_required},
+        {"confidence_threshold", request.confidence_threshold},
+        {"roi", {
+            {"x", request.roi.x},
+            {"y", request.roi.y},
+            {"width", request.roi.width},
+            {"height", request.roi.height}
+        }},
+        {"timestamp", std::chrono::duration<double>(
+            std::chrono::system_clock::now().time_since_epoch()).count()},
+        {"request_id", request_id}
+    };
+}
+
 bool VisionProcessor::saveAIRequestData(const AIRequestData& request, const std::string& request_id) {
     try {
-        json request_json = {
-            {"image_path", request.image_path},
-            {"model_preference", request.model_preference},
-            {"depth_analysis_required", request.depth_analysis_required},
-            {"classification_required", request.classification_required},
-            {"confidence_threshold", request.confidence_threshold},
-            {"roi", {
-                {"x", request.roi.x},
-                {"y", request.roi.y},
-                {"width", request.roi.width},
-                {"height", request.roi.height}
-            }},
-            {"timestamp", std::chrono::duration<double>(
-                std::chrono::system_clock::now().time_since_epoch()).count()},
-            {"request_id", request_id}
-        };
+        json request_json = serializeAIRequest(request, request_id);
         
         std::string request_file = ai_requests_dir_ + "/" + request_id + ".json";
         std::ofstream file(request_file);
@@ -336,6 +394,10 @@ json VisionProcessor::loadAIResults(const std::string& request_id) {
     }
 }
 
+void VisionProcessor::setAnalysisScale(int factor) {
+    config_.analysis_scale = std::max(1, factor);
+}
+
 void VisionProcessor::configureChangeDetection(double hue_threshold, double saturation_threshold, 
                                               double green_ratio_threshold, double area_change_threshold) {
     config_.hue_threshold = hue_threshold;
@@ -369,54 +431,21 @@ cv::Mat VisionProcessor::preprocessFrame(const cv::Mat& frame) {
     return processed;
 }
 
-double VisionProcessor::calculateMotionMagnitude(const cv::Mat& current, const cv::Mat& previous) {
-    cv::Mat diff, gray_current, gray_previous;
-    
-    cv::cvtColor(current, gray_current, cv::COLOR_BGR2GRAY);
-    cv::cvtColor(previous, gray_previous, cv::COLOR_BGR2GRAY);
-    
-    cv::absdiff(gray_current, gray_previous, diff);
+double VisionProcessor::calculateMotionMagnitude(const cv::Mat& current_gray, const cv::Mat& previous_gray) {
+    if (current_gray.size() != previous_gray.size()) return 0.0;
+
+    cv::Mat diff = ScratchPool::local().acquire(current_gray.size(), current_gray.type());
+    cv::absdiff(current_gray, previous_gray, diff);
     
     cv::Scalar motion_sum = cv::sum(diff);
     return motion_sum[0];
 }
 
-cv::Scalar VisionProcessor::calculateColorStd(const cv::Mat& frame, const cv::Mat& mask, int color_space) {
-    cv::Mat mean, stddev;
-    cv::meanStdDev(frame, mean, stddev, mask);
-    return cv::Scalar(stddev.at<double>(0), stddev.at<double>(1), stddev.at<double>(2));
-}
-
-double VisionProcessor::calculateNDVI(const cv::Mat& frame, const cv::Mat& mask) {
-    std::vector<cv::Mat> bgr;
-    cv::split(frame, bgr);
-    
-    cv::Mat nir = bgr[1]; // Use green channel as proxy for NIR
-    cv::Mat red = bgr[2];
-    
-    cv::Mat nir_f, red_f;
-    nir.convertTo(nir_f, CV_32F);
-    red.convertTo(red_f, CV_32F);
-    
-    cv::Mat ndvi = (nir_f - red_f) / (nir_f + red_f + 1e-10);
-    cv::Scalar mean_ndvi = cv::mean(ndvi, mask);
-    
-    return mean_ndvi[0];
-}
-
-double VisionProcessor::calculateEXG(const cv::Mat& frame, const cv::Mat& mask) {
-    std::vector<cv::Mat> bgr;
-    cv::split(frame, bgr);
-    
-    cv::Mat b_f, g_f, r_f;
-    bgr[0].convertTo(b_f, CV_32F, 1.0/255.0);
-    bgr[1].convertTo(g_f, CV_32F, 1.0/255.0);
-    bgr[2].convertTo(r_f, CV_32F, 1.0/255.0);
-    
-    cv::Mat exg = 2.0 * g_f - r_f - b_f;
-    cv::Scalar mean_exg = cv::mean(exg, mask);
-    
-    return mean_exg[0];
+void VisionProcessor::calculateColorStats(const cv::Mat& planes, const cv::Mat& mask, cv::Scalar& mean, cv::Scalar& stddev) {
+    cv::Mat mean_mat, stddev_mat;
+    cv::meanStdDev(planes, mean_mat, stddev_mat, mask);
+    mean = cv::Scalar(mean_mat.at<double>(0), mean_mat.at<double>(1), mean_mat.at<double>(2));
+    stddev = cv::Scalar(stddev_mat.at<double>(0), stddev_mat.at<double>(1), stddev_mat.at<double>(2));
 }
 
 bool VisionProcessor::establishBaseline(const cv::Mat& frame) {
@@ -0,0 +1,526 @@
+// Drives MqttClient against a scripted broker on the loopback interface and
+// checks what actually crosses the socket: CONNECT/CONNACK, PUBACK handling,
+// PINGREQ keep-alive, reconnect with DUP re-sends, malformed input, and the
+// packet boundaries and QoS 1 packet ids of batched publishes.
+//
+//   mqtt_client_test [test name ...]
+//
+// Without arguments every test runs. Exits with status 1 when any check fails.
+
+#include "mqtt_client.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<int> g_failures{0};
+
+#define CHECK(cond)                                                                      \
+    do {                                                                                 \
+        if (!(cond)) {                                                                   \
+            std::cerr << "  " << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+            g_failures++;                                                                \
+        }                                                                                \
+    } while (0)
+
+using Clock = std::chrono::steady_clock;
+
+// One control packet as the broker received it
+struct Packet {
+    uint8_t header = 0;     // type in the high nibble, flags in the low one
+    std::string body;
+
+    uint8_t type() const { return header & 0xF0; }
+};
+
+// A PUBLISH split into its fields
+struct Publish {
+    std::string topic;
+    std::string payload;
+    int qos = 0;
+    bool dup = false;
+    uint16_t packetId = 0;
+};
+
+Publish decodePublish(const Packet &packet) {
+    Publish publish;
+    publish.qos = (packet.header >> 1) & 0x03;
+    publish.dup = (packet.header & 0x08) != 0;
+    const std::string &body = packet.body;
+    if (body.size() < 2) return publish;
+    const size_t topicLength = (static_cast<uint8_t>(body[0]) << 8) | static_cast<uint8_t>(body[1]);
+    size_t pos = 2 + topicLength;
+    publish.topic = body.substr(2, topicLength);
+    if (publish.qos > 0 && pos + 2 <= body.size()) {
+        publish.packetId = static_cast<uint16_t>((static_cast<uint8_t>(body[pos]) << 8) | static_cast<uint8_t>(body[pos + 1]));
+        pos += 2;
+    }
+    publish.payload = pos <= body.size() ? body.substr(pos) : std::string();
+    return publish;
+}
+
+std::string puback(uint16_t packetId) {
+    return std::string{'\x40', '\x02', static_cast<char>(packetId >> 8), static_cast<char>(packetId & 0xFF)};
+}
+
+// One accepted client connection, read packet by packet
+class BrokerConnection {
+public:
+    explicit BrokerConnection(int fd) : fd_(fd) {}
+    ~BrokerConnection() { close(); }
+
+    BrokerConnection(const BrokerConnection &) = delete;
+    BrokerConnection &operator=(const BrokerConnection &) = delete;
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    // False on timeout or when the client closed the connection
+    bool read(Packet &packet, int timeoutMs) {
+        const auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (true) {
+            if (parse(packet)) return true;
+            const int waitMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+            if (fd_ < 0 || waitMs <= 0) return false;
+            struct pollfd pfd{fd_, POLLIN, 0};
+            if (::poll(&pfd, 1, waitMs) <= 0) continue;
+            char buf[4096];
+            const ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                closed_ = true;
+                return false;
+            }
+            buffer_.append(buf, static_cast<size_t>(n));
+        }
+    }
+
+    // Reads packets until one of the given type arrives, skipping e.g. PINGREQs in between
+    bool readType(uint8_t type, Packet &packet, int timeoutMs) {
+        const auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (Clock::now() < deadline) {
+            const int waitMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+            if (!read(packet, std::max(1, waitMs))) return false;
+            if (packet.type() == type) return true;
+        }
+        return false;
+    }
+
+    // CONNECT followed by an accepting CONNACK
+    bool handshake(int timeoutMs = 2000) {
+        Packet connect;
+        if (!read(connect, timeoutMs) || connect.type() != 0x10) return false;
+        return send(std::string("\x20\x02\x00\x00", 4));
+    }
+
+    bool send(const std::string &bytes) {
+        return fd_ >= 0 && ::send(fd_, bytes.data(), bytes.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(bytes.size());
+    }
+
+    // True once the client has closed its end, waiting up to timeoutMs for it
+    bool waitClosed(int timeoutMs) {
+        Packet ignored;
+        const auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (!closed_ && Clock::now() < deadline) {
+            const int waitMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+            read(ignored, std::max(1, waitMs));
+        }
+        return closed_;
+    }
+
+    void close() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+private:
+    bool parse(Packet &packet) {
+        if (buffer_.size() < 2) return false;
+        uint32_t remaining = 0;
+        uint32_t multiplier = 1;
+        size_t pos = 1;
+        while (true) {
+            if (pos >= buffer_.size()) return false;
+            const uint8_t byte = static_cast<uint8_t>(buffer_[pos++]);
+            remaining += (byte & 0x7F) * multiplier;
+            multiplier *= 128;
+            if (!(byte & 0x80)) break;
+        }
+        if (buffer_.size() < pos + remaining) return false;
+        packet.header = static_cast<uint8_t>(buffer_[0]);
+        packet.body.assign(buffer_, pos, remaining);
+        buffer_.erase(0, pos + remaining);
+        return true;
+    }
+
+    int fd_;
+    std::string buffer_;
+    bool closed_ = false;
+};
+
+// Listening socket on 127.0.0.1 with a kernel-chosen port
+class ScriptedBroker {
+public:
+    ScriptedBroker() {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        const int one = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t length = sizeof(addr);
+        if (::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(fd_, 4) != 0 ||
+            ::getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &length) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return;
+        }
+        port_ = ntohs(addr.sin_port);
+    }
+    ~ScriptedBroker() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    int port() const { return port_; }
+
+    // The next client connection; not open on timeout
+    std::unique_ptr<BrokerConnection> accept(int timeoutMs = 3000) {
+        struct pollfd pfd{fd_, POLLIN, 0};
+        int client = -1;
+        if (fd_ >= 0 && ::poll(&pfd, 1, timeoutMs) > 0) client = ::accept(fd_, nullptr, nullptr);
+        return std::unique_ptr<BrokerConnection>(new BrokerConnection(client));
+    }
+
+private:
+    int fd_ = -1;
+    int port_ = 0;
+};
+
+MqttClientOptions testOptions() {
+    MqttClientOptions options;
+    options.client_id = "mqtt-client-test";
+    options.reconnect_min_ms = 20;
+    options.reconnect_max_ms = 100;
+    options.connect_timeout_ms = 2000;
+    return options;
+}
+
+// Polls the client's stats until ready() holds or timeoutMs passes
+bool waitFor(const MqttClient &client, const std::function<bool(const MqttClient::Stats &)> &ready, int timeoutMs = 3000) {
+    const auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (Clock::now() < deadline) {
+        if (ready(client.stats())) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return ready(client.stats());
+}
+
+void testPubackReleasesInflight() {
+    ScriptedBroker broker;
+    std::thread script([&broker]() {
+        auto connection = broker.accept();
+        CHECK(connection->handshake());
+        for (int i = 0; i < 3; ++i) {
+            Packet packet;
+            CHECK(connection->readType(0x30, packet, 2000));
+            const Publish publish = decodePublish(packet);
+            CHECK(publish.qos == 1);
+            CHECK(publish.packetId != 0);
+            CHECK(publish.topic == "plants/" + std::to_string(i));
+            CHECK(connection->send(puback(publish.packetId)));
+        }
+        connection->waitClosed(3000);
+    });
+
+    MqttClient client("127.0.0.1", broker.port(), testOptions());
+    CHECK(client.connect());
+    for (int i = 0; i < 3; ++i) client.publish("plants/" + std::to_string(i), "{}", 1);
+    CHECK(waitFor(client, [](const MqttClient::Stats &stats) { return stats.acked == 3; }));
+    const MqttClient::Stats stats = client.stats();
+    CHECK(stats.sent == 3);
+    CHECK(stats.inflight == 0);
+    CHECK(stats.queued == 0);
+    client.disconnect();
+    script.join();
+}
+
+void testKeepalivePing() {
+    ScriptedBroker broker;
+    std::thread script([&broker]() {
+        auto connection = broker.accept();
+        CHECK(connection->handshake());
+        // keepalive 1 s: an idle client pings after half of it, and keeps pinging once answered
+        int pings = 0;
+        Packet packet;
+        while (connection->read(packet, 3000) && packet.type() != 0xE0) {
+            CHECK(packet.header == 0xC0);
+            CHECK(packet.body.empty());
+            CHECK(connection->send(std::string("\xD0\x00", 2)));
+            pings++;
+        }
+        // About one ping per second of the 3.5 s run, not one per loop iteration
+        CHECK(pings >= 2);
+        CHECK(pings <= 5);
+    });
+
+    MqttClientOptions options = testOptions();
+    options.keepalive_sec = 1;
+    MqttClient client("127.0.0.1", broker.port(), options);
+    CHECK(client.connect());
+    std::this_thread::sleep_for(std::chrono::milliseconds(3500));
+    const MqttClient::Stats stats = client.stats();
+    CHECK(stats.connected);
+    CHECK(stats.reconnects == 0);
+    client.disconnect();
+    script.join();
+}
+
+void testKeepaliveTimeoutReconnects() {
+    ScriptedBroker broker;
+    std::thread script([&broker]() {
+        auto first = broker.accept();
+        CHECK(first->handshake());
+        Packet packet;
+        CHECK(first->read(packet, 3000));
+        CHECK(packet.header == 0xC0);
+        // No PINGRESP: the client gives up on the session and dials again
+        auto second = broker.accept(5000);
+        CHECK(second->isOpen());
+        CHECK(second->handshake());
+        second->waitClosed(3000);
+    });
+
+    MqttClientOptions options = testOptions();
+    options.keepalive_sec = 1;
+    MqttClient client("127.0.0.1", broker.port(), options);
+    CHECK(client.connect());
+    CHECK(waitFor(client, [](const MqttClient::Stats &stats) { return stats.reconnects == 1 && stats.connected; }, 6000));
+    client.disconnect();
+    script.join();
+}
+
+void testReconnectResendsUnacked() {
+    ScriptedBroker broker;
+    std::thread script([&broker]() {
+        auto first = broker.accept();
+        CHECK(first->handshake());
+        Packet packet;
+        CHECK(first->readType(0x30, packet, 2000));
+        const Publish original = decodePublish(packet);
+        CHECK(!original.dup);
+        // Drop the link before acknowledging
+        first->close();
+
+        auto second = broker.accept();
+        CHECK(second->isOpen());
+        CHECK(second->handshake());
+        CHECK(second->readType(0x30, packet, 2000));
+        const Publish resent = decodePublish(packet);
+        CHECK(resent.dup);
+        CHECK(resent.qos == 1);
+        CHECK(resent.topic == original.topic);
+        CHECK(resent.payload == original.payload);
+        CHECK(second->send(puback(resent.packetId)));
+        second->waitClosed(3000);
+    });
+
+    MqttClient client("127.0.0.1", broker.port(), testOptions());
+    CHECK(client.connect());
+    client.publish("plants/1/telemetry", "{\"area\":1}", 1);
+    CHECK(waitFor(client, [](const MqttClient::Stats &stats) { return stats.acked == 1; }));
+    const MqttClient::Stats stats = client.stats();
+    CHECK(stats.reconnects == 1);
+    CHECK(stats.inflight == 0);
+    client.disconnect();
+    script.join();
+}
+
+void testMalformedLengthReconnects() {
+    ScriptedBroker broker;
+    std::thread script([&broker]() {
+        auto first = broker.accept();
+        CHECK(first->handshake());
+        // After the CONNACK has been read, so the packet takes the session's read path
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Remaining length with a fifth continuation byte: no such packet exists
+        CHECK(first->send(std::string("\x40\xFF\xFF\xFF\xFF\x01", 6)));
+        CHECK(first->waitClosed(3000));
+
+        auto second = broker.accept();
+        CHECK(second->isOpen());
+        CHECK(second->handshake());
+        second->waitClosed(3000);
+    });
+
+    MqttClient client("127.0.0.1", broker.port(), testOptions());
+    CHECK(client.connect());
+    CHECK(waitFor(client, [](const MqttClient::Stats &stats) { return stats.reconnects == 1 && stats.connected; }));
+    client.disconnect();
+    script.join();
+}
+
+// Distinct sizes around the 1-, 2- and 3-byte remaining-length encodings, and an empty payload
+std::string batchPayload(int i) {
+    const size_t size = i == 0 ? 0 : (i % 50 == 7 ? 20000 : static_cast<size_t>(i * 37 % 300));
+    std::string payload(size, '\0');
+    for (size_t k = 0; k < size; ++k) payload[k] = static_cast<char>('a' + (i + k) % 26);
+    return payload;
+}
+
+void testBatchPacketBoundaries() {
+    // More than one sendBatch worth (256), QoS 0 and 1 interleaved
+    static constexpr int COUNT = 300;
+    std::vector<MqttMessage> messages;
+    int qos1Count = 0;
+    for (int i = 0; i < COUNT; ++i) {
+        const int qos = i % 3 == 0 ? 0 : 1;
+        qos1Count += qos;
+        messages.push_back(MqttMessage::make("batch/" + std::to_string(i), batchPayload(i), qos, i % 10 == 0));
+    }
+
+    ScriptedBroker broker;
+    std::thread script([&broker]() {
+        auto connection = broker.accept();
+        CHECK(connection->handshake());
+        std::vector<uint16_t> ids;
+        for (int i = 0; i < COUNT; ++i) {
+            Packet packet;
+            if (!connection->readType(0x30, packet, 3000)) {
+                CHECK(!"batch truncated");
+                break;
+            }
+            const Publish publish = decodePublish(packet);
+            // Every packet parses on its own and arrives in queue order
+            CHECK(publish.topic == "batch/" + std::to_string(i));
+            CHECK(publish.payload == batchPayload(i));
+            CHECK(publish.qos == (i % 3 == 0 ? 0 : 1));
+            CHECK(((packet.header & 0x01) != 0) == (i % 10 == 0));
+            CHECK(!publish.dup);
+            if (publish.qos > 0) {
+                CHECK(publish.packetId != 0);
+                CHECK(std::find(ids.begin(), ids.end(), publish.packetId) == ids.end());
+                ids.push_back(publish.packetId);
+            }
+        }
+        for (uint16_t id : ids) CHECK(connection->send(puback(id)));
+        connection->waitClosed(3000);
+    });
+
+    MqttClientOptions options = testOptions();
+    options.max_inflight = COUNT;
+    MqttClient client("127.0.0.1", broker.port(), options);
+    CHECK(client.connect());
+    CHECK(client.publishBatch(messages));
+    CHECK(waitFor(client, [qos1Count](const MqttClient::Stats &stats) {
+        return stats.acked == static_cast<uint64_t>(qos1Count);
+    }));
+    const MqttClient::Stats stats = client.stats();
+    CHECK(stats.sent == COUNT);
+    CHECK(stats.inflight == 0);
+    CHECK(stats.dropped == 0);
+    client.disconnect();
+    script.join();
+}
+
+void testBatchInflightWindow() {
+    // A batch larger than the window goes out window by window as PUBACKs come back
+    static constexpr int COUNT = 10;
+    static constexpr int WINDOW = 4;
+    std::vector<MqttMessage> messages;
+    for (int i = 0; i < COUNT; ++i) messages.push_back(MqttMessage::make("window/" + std::to_string(i), "{}", 1));
+
+    ScriptedBroker broker;
+    std::thread script([&broker]() {
+        auto connection = broker.accept();
+        CHECK(connection->handshake());
+        int next = 0;
+        while (next < COUNT) {
+            std::vector<uint16_t> ids;
+            const int expected = std::min(WINDOW, COUNT - next);
+            for (int k = 0; k < expected; ++k, ++next) {
+                Packet packet;
+                if (!connection->readType(0x30, packet, 3000)) {
+                    CHECK(!"window not filled");
+                    return;
+                }
+                const Publish publish = decodePublish(packet);
+                CHECK(publish.topic == "window/" + std::to_string(next));
+                CHECK(publish.packetId != 0);
+                CHECK(std::find(ids.begin(), ids.end(), publish.packetId) == ids.end());
+                ids.push_back(publish.packetId);
+            }
+            // Nothing beyond the window until it is acknowledged
+            Packet extra;
+            CHECK(!connection->readType(0x30, extra, 200));
+            // Out of order, which MQTT allows
+            for (auto it = ids.rbegin(); it != ids.rend(); ++it) CHECK(connection->send(puback(*it)));
+        }
+        connection->waitClosed(3000);
+    });
+
+    MqttClientOptions options = testOptions();
+    options.max_inflight = WINDOW;
+    MqttClient client("127.0.0.1", broker.port(), options);
+    CHECK(client.connect());
+    CHECK(client.publishBatch(messages));
+    CHECK(waitFor(client, [](const MqttClient::Stats &stats) { return stats.acked == COUNT; }));
+    const MqttClient::Stats stats = client.stats();
+    CHECK(stats.sent == COUNT);
+    CHECK(stats.inflight == 0);
+    client.disconnect();
+    script.join();
+}
+
+struct TestCase {
+    const char *name;
+    void (*run)();
+};
+
+const TestCase TESTS[] = {
+    {"puback", testPubackReleasesInflight},
+    {"keepalive", testKeepalivePing},
+    {"keepalive_timeout", testKeepaliveTimeoutReconnects},
+    {"reconnect", testReconnectResendsUnacked},
+    {"malformed_length", testMalformedLengthReconnects},
+    {"batch_boundaries", testBatchPacketBoundaries},
+    {"batch_inflight_window", testBatchInflightWindow},
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int run = 0;
+    for (const auto &test : TESTS) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) selected = selected || test.name == std::string(argv[i]);
+        if (!selected) continue;
+
+        const int before = g_failures.load();
+        const auto started = Clock::now();
+        test.run();
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+        std::cerr << (g_failures.load() == before ? "[ OK ] " : "[FAIL] ") << test.name
+                  << " (" << static_cast<int>(ms) << " ms)" << std::endl;
+        run++;
+    }
+    if (run == 0) {
+        std::cerr << "No test matched" << std::endl;
+        return 1;
+    }
+    return g_failures.load() == 0 ? 0 : 1;
+}
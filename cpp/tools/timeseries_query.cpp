@@ -0,0 +1,180 @@
+// Range queries over the per-instance time-series store that plantvision_cpp
+// writes to <data dir>/timeseries (TIMESERIES=1, the default).
+//
+//   plantvision_tsq <directory> [--track ID] [--from MS] [--to MS]
+//                   [--since SECONDS] [--bucket MS] [--format csv|json]
+//   plantvision_tsq <directory> --tracks
+//
+// Timestamps are milliseconds since the epoch; --since is relative to now.
+// --bucket keeps the newest record of each track per bucket, which is what a
+// growth curve over months needs. Records go to stdout as CSV (default) or
+// one JSON array; the record count and query time are printed on stderr.
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "timeseries_store.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+
+struct QueryOptions {
+    std::string directory;
+    int32_t trackId = TimeSeriesReader::ANY_TRACK;
+    int64_t fromMs = std::numeric_limits<int64_t>::min();
+    int64_t toMs = std::numeric_limits<int64_t>::max();
+    int64_t bucketMs = 0;
+    std::string format = "csv";
+    bool listTracks = false;
+};
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool parseArgs(int argc, char **argv, QueryOptions &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&]() -> const char * { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char *value = nullptr;
+        if (arg == "--track" && (value = next())) options.trackId = std::atoi(value);
+        else if (arg == "--from" && (value = next())) options.fromMs = std::atoll(value);
+        else if (arg == "--to" && (value = next())) options.toMs = std::atoll(value);
+        else if (arg == "--since" && (value = next())) options.fromMs = nowMs() - std::atoll(value) * 1000;
+        else if (arg == "--bucket" && (value = next())) options.bucketMs = std::max<long long>(0, std::atoll(value));
+        else if (arg == "--format" && (value = next())) options.format = value;
+        else if (arg == "--tracks") options.listTracks = true;
+        else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown or incomplete option " << arg << std::endl;
+            return false;
+        } else if (options.directory.empty()) {
+            options.directory = arg;
+        } else {
+            std::cerr << "Unexpected argument " << arg << std::endl;
+            return false;
+        }
+    }
+    if (options.directory.empty()) {
+        std::cerr << "Usage: plantvision_tsq <directory> [--track ID] [--from MS] [--to MS] [--since SECONDS]\n"
+                     "                       [--bucket MS] [--format csv|json] [--tracks]" << std::endl;
+        return false;
+    }
+    if (options.format != "csv" && options.format != "json") {
+        std::cerr << "--format must be csv or json" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+json toJson(const TimeSeriesRecord &record) {
+    return {
+        {"timestamp_ms", record.timestampMs},
+        {"frame", record.frameNumber},
+        {"track_id", record.trackId},
+        {"type", record.type},
+        {"stage", record.stage},
+        {"reused", (record.flags & TimeSeriesRecord::FLAG_REUSED) != 0},
+        {"area_pixels", record.areaPixels},
+        {"area_cm2", record.areaCm2},
+        {"height_cm", record.heightCm},
+        {"width_cm", record.widthCm},
+        {"leaf_count", record.leafCount},
+        {"health_score", record.healthScore},
+        {"solidity", record.solidity},
+        {"circularity", record.circularity},
+        {"eccentricity", record.eccentricity},
+        {"compactness", record.compactness},
+        {"ndvi", record.ndvi},
+        {"exg", record.exg},
+        {"brown_spot_count", record.brownSpotCount},
+        {"yellow_area_count", record.yellowAreaCount},
+        {"mean_bgr", {record.meanB, record.meanG, record.meanR}}
+    };
+}
+
+void writeCsvHeader() {
+    std::cout << "timestamp_ms,frame,track_id,type,stage,reused,area_pixels,area_cm2,height_cm,width_cm,"
+                 "leaf_count,health_score,solidity,circularity,eccentricity,compactness,ndvi,exg,"
+                 "brown_spot_count,yellow_area_count,mean_b,mean_g,mean_r\n";
+}
+
+void writeCsv(const TimeSeriesRecord &record) {
+    std::cout << record.timestampMs << ',' << record.frameNumber << ',' << record.trackId << ','
+              << int(record.type) << ',' << int(record.stage) << ','
+              << ((record.flags & TimeSeriesRecord::FLAG_REUSED) ? 1 : 0) << ','
+              << record.areaPixels << ',' << record.areaCm2 << ',' << record.heightCm << ',' << record.widthCm << ','
+              << record.leafCount << ',' << record.healthScore << ',' << record.solidity << ','
+              << record.circularity << ',' << record.eccentricity << ',' << record.compactness << ','
+              << record.ndvi << ',' << record.exg << ',' << record.brownSpotCount << ',' << record.yellowAreaCount << ','
+              << record.meanB << ',' << record.meanG << ',' << record.meanR << '\n';
+}
+
+int listTracks(const TimeSeriesReader &reader, const QueryOptions &options) {
+    const auto tracks = reader.tracks();
+    if (options.format == "json") {
+        json out = json::array();
+        for (const auto &track : tracks) {
+            out.push_back({{"track_id", track.trackId}, {"records", track.records},
+                           {"first_ms", track.firstMs}, {"last_ms", track.lastMs}});
+        }
+        std::cout << out.dump() << std::endl;
+    } else {
+        std::cout << "track_id,records,first_ms,last_ms\n";
+        for (const auto &track : tracks) {
+            std::cout << track.trackId << ',' << track.records << ',' << track.firstMs << ',' << track.lastMs << '\n';
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    QueryOptions options;
+    if (!parseArgs(argc, argv, options)) return 1;
+
+    const auto started = std::chrono::steady_clock::now();
+    TimeSeriesReader reader(options.directory);
+    if (reader.segmentCount() == 0) {
+        std::cerr << "No time-series segments in " << options.directory << std::endl;
+        return 1;
+    }
+    if (options.listTracks) return listTracks(reader, options);
+
+    std::vector<TimeSeriesRecord> records;
+    if (options.bucketMs > 0) {
+        // Newest record per (track, bucket); map order gives track, then time
+        std::map<std::pair<int32_t, int64_t>, TimeSeriesRecord> buckets;
+        reader.forEach(options.trackId, options.fromMs, options.toMs, [&](const TimeSeriesRecord &record) {
+            const int64_t bucket = record.timestampMs / options.bucketMs - (record.timestampMs % options.bucketMs < 0 ? 1 : 0);
+            buckets[{record.trackId, bucket}] = record;
+        });
+        records.reserve(buckets.size());
+        for (const auto &entry : buckets) records.push_back(entry.second);
+    } else {
+        records = reader.query(options.trackId, options.fromMs, options.toMs);
+    }
+    const double queryMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+    if (options.format == "json") {
+        json out = json::array();
+        for (const auto &record : records) out.push_back(toJson(record));
+        std::cout << out.dump() << std::endl;
+    } else {
+        writeCsvHeader();
+        for (const auto &record : records) writeCsv(record);
+    }
+    std::cerr << records.size() << " records from " << reader.segmentCount() << " segments in "
+              << queryMs << " ms" << std::endl;
+    return 0;
+}